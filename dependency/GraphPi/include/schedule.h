@@ -4,6 +4,7 @@
 #include "prefix.h"
 #include "disjoint_set_union.h"
 
+#include <set>
 #include <vector>
 #include "string"
 enum class PerfModelType {
@@ -69,7 +70,8 @@ public:
     void aggressive_optimize_dfs(Pattern base_dag, std::vector<std::vector<int> > isomorphism_vec,
                                  std::vector<std::vector<std::vector<int> > > permutation_groups,
                                  std::vector<std::pair<int, int> > ordered_pairs,
-                                 std::vector<std::vector<std::pair<int, int> > > &ordered_pairs_vector);
+                                 std::vector<std::vector<std::pair<int, int> > > &ordered_pairs_vector,
+                                 std::set<std::pair<std::vector<std::pair<int, int> >, std::vector<std::vector<int> > > > *explored = nullptr);
 
     void restrict_selection(int v_cnt, unsigned int e_cnt, long long tri_cnt,
                             std::vector<std::vector<std::pair<int, int> > > ordered_pairs_vector,
@@ -90,14 +92,16 @@ public:
 
     void print_schedule() const;
 
+    // order_rank: use the order_rank-th cheapest matching order instead of the cheapest (the last one if there are fewer)
     void get_schedule(const char *_adj_mat, int _size, uint64_t _v_num, uint64_t _e_num, uint64_t _tri_num,
-                      PerfModelType model_type = PerfModelType::graphpi);
+                      PerfModelType model_type = PerfModelType::graphpi, int order_rank = 0);
 
     void get_greedy_schedule(const char *_adj_mat, int _size);
 
     std::vector<std::vector<std::vector<int> > > in_exclusion_optimize_group;
     std::vector<int> in_exclusion_optimize_val;
     std::vector<std::pair<int, int> > restrict_pair;
+    std::vector<int> order; // order[i] = vertex of the input pattern matched at the i-th loop (set by get_schedule)
 
     std::string get_adj_mat_str();
 
@@ -143,6 +147,9 @@ private:
     GraphZero_estimate_schedule_restrict(const std::vector<int> &order, const std::vector<std::pair<int, int> > &pairs,
                                          uint64_t v_cnt, uint64_t e_cnt);
 
+    double estimate_schedule_restrict(const std::vector<int> &order, const std::vector<std::pair<int, int> > &pairs,
+                                      uint64_t v_cnt, uint64_t e_cnt, uint64_t tri_cnt, PerfModelType model_type);
+
     double
     Naive_estimate_schedule_restrict(const std::vector<int> &order, const std::vector<std::pair<int, int> > &paris,
                                      int v_cnt, unsigned int e_cnt);
@@ -65,9 +65,10 @@ Graphmpi& Graphmpi::getinstance() {
     return instance;
 }
 
-void Graphmpi::get_loop(int*& ptr, int& size) { 
-    ptr = nullptr; 
-    size = 0; 
+void Graphmpi::get_loop(int*& ptr, int& size) {
+    // Without MPI no loop is ever handed over (loop_flag is never set), so keep the caller's loop untouched,
+    // same as Graphmpi::get_loop. Clearing it makes Graph::pattern_matching return 0, which breaks
+    // Schedule::restricts_generate and the IEP redundancy computation in Schedule::get_schedule.
 }
 
 void Graphmpi::set_loop_flag() {}
@@ -5,6 +5,14 @@
 #include <cstring>
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <oneapi/tbb/parallel_for.h>
 
 void print(std::vector<int> vec) {
     for (auto i: vec) {
@@ -375,36 +383,109 @@ std::string Schedule::get_adj_mat_str() {
     return adj_mat_str;
 }
 
-std::vector<std::vector<int>> remove_automorphisms(const char * adj_mat, int size, std::vector<std::vector<int>> orders){
-    std::vector<std::string> all_mat;
-    for (auto &order: orders) {
-        int rank[size];
-        for (int i = 0; i < size; ++i) rank[order[i]] = i;
-        std::string loc_adj_mat_str;
-        loc_adj_mat_str.resize(size * size);
-        for (int i = 0; i < size; ++i)
-            for (int j = 0; j < size; ++j)
-                loc_adj_mat_str.at(rank[i] * size + rank[j]) = adj_mat[i * size + j];
-        all_mat.push_back(loc_adj_mat_str);
-    }
-    std::vector<std::string> org_all_mat = all_mat;
-    // remove identical pattern matrix caused by automorphisms
-    std::sort(all_mat.begin(), all_mat.end(), std::greater<std::string>());
-    all_mat.erase(std::unique(all_mat.begin(), all_mat.end()), all_mat.end());
-
-    std::vector<std::vector<int>> res;
-    for (auto & unique_mat: all_mat){
-        auto itr = std::find(org_all_mat.begin(), org_all_mat.end(), unique_mat);
-        assert(itr != org_all_mat.end() && "org_all_mat does not contain unique_mat");
-        auto idx = std::distance(org_all_mat.begin(), itr);
-        res.push_back(orders.at(idx));
-    }
-    return res;
+// matching orders worth costing, found in one pass over all permutations of the pattern vertices
+struct OrderSearch {
+    uint64_t canonical_key = 0; // largest relabelled pattern over all orders, identical for isomorphic patterns
+    std::vector<int> canonical_order; // the first order producing it
+    uint64_t num_automorphisms = 0;
+    int max_optimize_num = -1;
+    // (relabelled pattern, packed order) of the valid orders with the most inclusion-exclusion vertices, one order per
+    // relabelled pattern, by descending relabelled pattern
+    std::vector<std::pair<uint64_t, uint64_t> > candidates;
 };
 
+// upper triangle of the pattern relabelled by order, row by row; comparing keys compares the relabelled matrices
+static uint64_t order_key(const int *adj_mat, int size, const std::vector<int> &order) {
+    uint64_t key = 0;
+    for (int i = 0; i < size; ++i)
+        for (int j = i + 1; j < size; ++j)
+            key = key << 1 | (adj_mat[INDEX(order[i], order[j], size)] ? 1 : 0);
+    return key;
+}
+
+static uint64_t pack_order(const std::vector<int> &order) {
+    uint64_t packed = 0;
+    for (size_t i = 0; i < order.size(); ++i) packed |= (uint64_t) order[i] << (4 * i);
+    return packed;
+}
+
+static std::vector<int> unpack_order(uint64_t packed, int size) {
+    std::vector<int> order(size);
+    for (int i = 0; i < size; ++i) order[i] = (packed >> (4 * i)) & 15;
+    return order;
+}
+
+/* Enumerates the permutations in parallel, one task per choice of the first two vertices. Tasks are merged in
+ * lexicographic order so the candidates are the ones the serial search kept: the first order of every relabelled
+ * pattern (automorphic orders relabel the pattern identically and cost the same).
+ */
+static OrderSearch search_orders(int size, const int *adj_mat, const std::function<int(const std::vector<int> &)> &optimize_num) {
+    assert(size * (size - 1) / 2 <= 64 && "Pattern too large for the schedule search");
+    std::vector<int> identity(size);
+    for (int i = 0; i < size; ++i) identity[i] = i;
+    const uint64_t identity_key = order_key(adj_mat, size, identity);
+
+    std::vector<std::vector<int> > prefixes;
+    for (int first = 0; first < size; ++first) {
+        if (size == 1) prefixes.push_back({first});
+        for (int second = 0; second < size && size > 1; ++second)
+            if (second != first) prefixes.push_back({first, second});
+    }
+    std::vector<OrderSearch> parts(prefixes.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, prefixes.size(), 1), [&](const tbb::blocked_range<size_t> &r) {
+        for (size_t t = r.begin(); t < r.end(); ++t) {
+            OrderSearch &part = parts[t];
+            std::vector<int> vec = prefixes[t];
+            for (int v = 0; v < size; ++v)
+                if (std::find(prefixes[t].begin(), prefixes[t].end(), v) == prefixes[t].end()) vec.push_back(v);
+            do {
+                uint64_t key = order_key(adj_mat, size, vec);
+                if (part.canonical_order.empty() || key > part.canonical_key) {
+                    part.canonical_key = key;
+                    part.canonical_order = vec;
+                }
+                if (key == identity_key) part.num_automorphisms++;
+                int opt = optimize_num(vec);
+                if (opt < 0 || opt < part.max_optimize_num) continue;
+                if (opt > part.max_optimize_num) {
+                    part.max_optimize_num = opt;
+                    part.candidates.clear();
+                }
+                part.candidates.emplace_back(key, pack_order(vec));
+            } while (std::next_permutation(vec.begin() + prefixes[t].size(), vec.end()));
+        }
+    });
+
+    OrderSearch out;
+    for (const OrderSearch &part: parts) {
+        if (out.canonical_order.empty() || part.canonical_key > out.canonical_key) {
+            out.canonical_key = part.canonical_key;
+            out.canonical_order = part.canonical_order;
+        }
+        out.num_automorphisms += part.num_automorphisms;
+        out.max_optimize_num = std::max(out.max_optimize_num, part.max_optimize_num);
+    }
+    for (const OrderSearch &part: parts)
+        if (part.max_optimize_num == out.max_optimize_num)
+            out.candidates.insert(out.candidates.end(), part.candidates.begin(), part.candidates.end());
+    std::stable_sort(out.candidates.begin(), out.candidates.end(),
+                     [](const std::pair<uint64_t, uint64_t> &l, const std::pair<uint64_t, uint64_t> &r) {
+                         return l.first > r.first;
+                     });
+    out.candidates.erase(std::unique(out.candidates.begin(), out.candidates.end(),
+                                     [](const std::pair<uint64_t, uint64_t> &l, const std::pair<uint64_t, uint64_t> &r) {
+                                         return l.first == r.first;
+                                     }), out.candidates.end());
+    return out;
+}
+
+// best order and restrictions per canonical pattern, counts and cost model, with vertices in canonical labels
+static std::map<std::string, std::pair<std::vector<int>, std::vector<std::pair<int, int> > > > schedule_memo;
+static std::mutex schedule_memo_mutex;
+
 // GraphPi's algorithm for generating schedule in for edge-induced pattern
 // This implementation additionally removes automorphisms before computing the scores for each iteration
-void Schedule::get_schedule(const char *_adj_mat, int _size, uint64_t v_cnt, uint64_t e_cnt, uint64_t tri_cnt, PerfModelType model_type) {
+void Schedule::get_schedule(const char *_adj_mat, int _size, uint64_t v_cnt, uint64_t e_cnt, uint64_t tri_cnt, PerfModelType model_type, int order_rank) {
     size = _size;
     adj_mat = new int[size * size];
     int org_adj_mat[size * size];
@@ -417,85 +498,99 @@ void Schedule::get_schedule(const char *_adj_mat, int _size, uint64_t v_cnt, uin
             org_adj_mat[i] = 0;
         }
     }
+    std::vector<int> best_order;
     std::vector<std::pair<int, int> > best_pairs;
-    best_pairs.clear();
-    unsigned int pow = 1;
-    for (int i = 2; i <= size; ++i) pow *= i;
-
-    std::vector<std::vector<int> > candidate_permutations;
-    candidate_permutations.clear();
-
-    bool use[size];
-    for (int i = 0; i < size; ++i) use[i] = false;
-    std::vector<int> tmp_vec;
-
-    get_full_permutation(candidate_permutations, use, tmp_vec, 0);
-    assert(candidate_permutations.size() == pow);
-    // remove automorphism
-    candidate_permutations = remove_automorphisms(_adj_mat, size, candidate_permutations);
-    remove_invalid_permutation(candidate_permutations);
-    int max_val = 0;
-    for (const auto &vec: candidate_permutations) {
-        max_val = std::max(max_val, get_vec_optimize_num(vec));
-    }
-    std::vector<std::vector<int> > tmp_candidate;
-    tmp_candidate.clear();
-    for (const auto &vec: candidate_permutations) {
-        if (get_vec_optimize_num(vec) == max_val) {
-            tmp_candidate.push_back(vec);
-        }
-    }
-
-    candidate_permutations = tmp_candidate;
-
-    int *best_order = new int[size];
-    double min_val = 0.0;
-    bool have_best = false;
-
-    // brute force search
-    for (const auto &vec: candidate_permutations) {
-        int rank[size];
-        for (int i = 0; i < size; ++i) rank[vec[i]] = i;
-
-        int cur_adj_mat[size * size];
-        for (int i = 0; i < size; ++i)
-            for (int j = 0; j < size; ++j)
-                cur_adj_mat[INDEX(rank[i], rank[j], size)] = adj_mat[INDEX(i, j, size)];
-
-        std::vector<std::vector<std::pair<int, int> > > restricts_vector;
-
-        restricts_vector.clear();
-
-        restricts_generate(cur_adj_mat, restricts_vector);
-
-        if (restricts_vector.size() == 0) {
-            std::vector<std::pair<int, int> > Empty;
-            Empty.clear();
-
-            double val;
-            if (model_type == PerfModelType::graphpi) val = our_estimate_schedule_restrict(vec, Empty, v_cnt, e_cnt, tri_cnt);
-            else val = GraphZero_estimate_schedule_restrict(vec, Empty, v_cnt, e_cnt);
-            if (have_best == false || val < min_val) {
-                have_best = true;
-                min_val = val;
-                for (int i = 0; i < size; ++i) best_order[i] = vec[i];
-                best_pairs = Empty;
+    OrderSearch search = search_orders(size, adj_mat, [this](const std::vector<int> &vec) {
+        return get_vec_optimize_num(vec);
+    });
+    std::string memo_key = std::to_string(size) + ":" + std::to_string(search.canonical_key) + ":" +
+                           std::to_string(v_cnt) + ":" + std::to_string(e_cnt) + ":" + std::to_string(tri_cnt) + ":" +
+                           std::to_string(static_cast<int>(model_type)) + ":" + std::to_string(order_rank);
+    bool memo_hit = false;
+    {
+        std::lock_guard<std::mutex> lock(schedule_memo_mutex);
+        auto itr = schedule_memo.find(memo_key);
+        if (itr != schedule_memo.end()) {
+            // the memo stores vertices by their canonical labels
+            memo_hit = true;
+            for (int v: itr->second.first) best_order.push_back(search.canonical_order[v]);
+            best_pairs = itr->second.second;
+        }
+    }
+
+    if (!memo_hit) {
+        const std::vector<std::pair<uint64_t, uint64_t> > &candidates = search.candidates;
+        std::vector<std::pair<int, int> > Empty;
+        // restrictions cut the cost of an order by at most the number of automorphisms, so the unrestricted cost
+        // divided by it bounds every restricted cost of the order from below
+        std::vector<double> lower_bound(candidates.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, candidates.size()), [&](const tbb::blocked_range<size_t> &r) {
+            for (size_t c = r.begin(); c < r.end(); c++) {
+                std::vector<int> vec = unpack_order(candidates[c].second, size);
+                lower_bound[c] = estimate_schedule_restrict(vec, Empty, v_cnt, e_cnt, tri_cnt, model_type) /
+                                 search.num_automorphisms;
             }
-        }
-
-        for (const auto &pairs: restricts_vector) {
-            double val;
-            if (model_type == PerfModelType::graphpi) val = our_estimate_schedule_restrict(vec, pairs, v_cnt, e_cnt, tri_cnt);
-            else val = GraphZero_estimate_schedule_restrict(vec, pairs, v_cnt, e_cnt);
-            if (have_best == false || val < min_val) {
-//                printf("cost=%.1f\n", val);
-                have_best = true;
-                min_val = val;
-                for (int i = 0; i < size; ++i) best_order[i] = vec[i];
-                best_pairs = pairs;
+        });
+        std::vector<size_t> visit(candidates.size());
+        for (size_t c = 0; c < visit.size(); ++c) visit[c] = c;
+        std::sort(visit.begin(), visit.end(), [&lower_bound](size_t l, size_t r) {
+            return lower_bound[l] < lower_bound[r] || (lower_bound[l] == lower_bound[r] && l < r);
+        });
+
+        // ties are broken towards the earliest candidate and restriction set, as the serial search did;
+        // top holds the cheapest (cost, candidate, restriction set) of each of the order_rank + 1 cheapest candidates so far
+        typedef std::tuple<double, size_t, size_t, std::vector<std::pair<int, int> > > Entry;
+        std::vector<Entry> top;
+        const size_t num_top = std::max(order_rank, 0) + 1;
+        std::atomic<double> best_val{std::numeric_limits<double>::infinity()};
+        std::mutex best_mutex;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, visit.size(), 1), [&](const tbb::blocked_range<size_t> &r) {
+            for (size_t pos = r.begin(); pos < r.end(); pos++) {
+                size_t c = visit[pos];
+                if (lower_bound[c] > best_val.load() * (1 + 1e-9)) continue;
+                std::vector<int> vec = unpack_order(candidates[c].second, size);
+                std::vector<std::vector<std::pair<int, int> > > restricts_vector;
+                if (search.num_automorphisms == 1) {
+                    // without automorphisms the only restriction set is the empty one
+                    restricts_vector.push_back(Empty);
+                } else {
+                    int rank[size];
+                    for (int i = 0; i < size; ++i) rank[vec[i]] = i;
+                    int cur_adj_mat[size * size];
+                    for (int i = 0; i < size; ++i)
+                        for (int j = 0; j < size; ++j)
+                            cur_adj_mat[INDEX(rank[i], rank[j], size)] = adj_mat[INDEX(i, j, size)];
+                    restricts_generate(cur_adj_mat, restricts_vector);
+                    if (restricts_vector.size() == 0) restricts_vector.push_back(Empty);
+                }
+                size_t best_p = 0;
+                double val = 0;
+                for (size_t p = 0; p < restricts_vector.size(); ++p) {
+                    double cur = estimate_schedule_restrict(vec, restricts_vector[p], v_cnt, e_cnt, tri_cnt, model_type);
+                    if (p == 0 || cur < val) {
+                        val = cur;
+                        best_p = p;
+                    }
+                }
+                Entry entry{val, c, best_p, restricts_vector[best_p]};
+                std::lock_guard<std::mutex> lock(best_mutex);
+                top.insert(std::upper_bound(top.begin(), top.end(), entry, [](const Entry &l, const Entry &r) {
+                    return std::tie(std::get<0>(l), std::get<1>(l)) < std::tie(std::get<0>(r), std::get<1>(r));
+                }), entry);
+                if (top.size() > num_top) top.pop_back();
+                if (top.size() == num_top) best_val.store(std::get<0>(top.back()));
             }
-        }
+        });
+        const Entry &chosen = top.at(std::min(top.size(), num_top) - 1);
+        best_order = unpack_order(candidates[std::get<1>(chosen)].second, size);
+        best_pairs = std::get<3>(chosen);
 
+        std::vector<int> canonical_rank(size);
+        for (int i = 0; i < size; ++i) canonical_rank[search.canonical_order[i]] = i;
+        std::vector<int> canonical_best_order;
+        for (int v: best_order) canonical_best_order.push_back(canonical_rank[v]);
+        std::lock_guard<std::mutex> lock(schedule_memo_mutex);
+        schedule_memo.emplace(memo_key, std::make_pair(canonical_best_order, best_pairs));
     }
 
     int rank[size];
@@ -505,7 +600,7 @@ void Schedule::get_schedule(const char *_adj_mat, int _size, uint64_t v_cnt, uin
     for (int i = 0; i < size; ++i)
         for (int j = 0; j < size; ++j)
             adj_mat[INDEX(rank[i], rank[j], size)] = org_adj_mat[INDEX(i, j, size)];
-    delete[] best_order;
+    order = best_order;
 
     restrict_pair = best_pairs;
 
@@ -630,7 +725,7 @@ Schedule::Schedule(const Pattern &pattern, bool &is_pattern_valid, int performan
         }
 
         int *best_order = new int[size];
-        double min_val;
+        double min_val = std::numeric_limits<double>::max();
         bool have_best = false;
 
 
@@ -736,7 +831,7 @@ Schedule::Schedule(const Pattern &pattern, bool &is_pattern_valid, int performan
         }
 
         bool have_best = false;
-        double min_val;
+        double min_val = std::numeric_limits<double>::max();
 
         for (const auto &pairs: restricts_vector) {
             double val;
@@ -1070,14 +1165,17 @@ Schedule::aggressive_optimize_get_all_pairs(std::vector<std::vector<std::pair<in
     for (const std::pair<int, int> &pair: ordered_pairs)
         base_dag.add_ordered_edge(pair.first, pair.second);
 
-    aggressive_optimize_dfs(base_dag, isomorphism_vec, permutation_groups, ordered_pairs, ordered_pairs_vector);
+    std::set<std::pair<std::vector<std::pair<int, int> >, std::vector<std::vector<int> > > > explored;
+    aggressive_optimize_dfs(base_dag, isomorphism_vec, permutation_groups, ordered_pairs, ordered_pairs_vector,
+                            &explored);
 
 }
 
 void Schedule::aggressive_optimize_dfs(Pattern base_dag, std::vector<std::vector<int> > isomorphism_vec,
                                        std::vector<std::vector<std::vector<int> > > permutation_groups,
                                        std::vector<std::pair<int, int> > ordered_pairs,
-                                       std::vector<std::vector<std::pair<int, int> > > &ordered_pairs_vector) {
+                                       std::vector<std::vector<std::pair<int, int> > > &ordered_pairs_vector,
+                                       std::set<std::pair<std::vector<std::pair<int, int> >, std::vector<std::vector<int> > > > *explored) {
 
     for (unsigned int i = 0; i < isomorphism_vec.size();) {
         Pattern test_dag(base_dag);
@@ -1097,6 +1195,14 @@ void Schedule::aggressive_optimize_dfs(Pattern base_dag, std::vector<std::vector
         return;
     }
 
+    // The restriction sets below a node depend only on its pairs and remaining isomorphisms, so a node reached again
+    // through another order of the same pairs would only repeat restriction sets already found
+    if (explored != nullptr) {
+        std::vector<std::pair<int, int> > pair_set = ordered_pairs;
+        std::sort(pair_set.begin(), pair_set.end());
+        if (!explored->emplace(pair_set, isomorphism_vec).second) return;
+    }
+
 
     std::pair<int, int> found_pair;
     for (unsigned int i = 0; i < permutation_groups.size();) {
@@ -1117,7 +1223,7 @@ void Schedule::aggressive_optimize_dfs(Pattern base_dag, std::vector<std::vector
                 next_base_dag.add_ordered_edge(found_pair.first, found_pair.second);
 
                 aggressive_optimize_dfs(next_base_dag, next_isomorphism_vec, next_permutation_groups,
-                                        next_ordered_pairs, ordered_pairs_vector);
+                                        next_ordered_pairs, ordered_pairs_vector, explored);
             }
         if (two_element_number >= 1) {
             break;
@@ -1204,32 +1310,30 @@ void Schedule::GraphZero_get_automorphisms(std::vector<std::vector<int> > &Aut)
 }
 
 std::vector<std::vector<int> > Schedule::get_isomorphism_vec() const {
-    unsigned int pow = 1;
-    for (int i = 2; i <= size; ++i)
-        pow *= i;
-    std::vector<std::vector<int> > vec;
-    vec.clear();
-    bool use[size];
-    for (int i = 0; i < size; ++i)
-        use[i] = false;
-    std::vector<int> tmp_vec;
-    get_full_permutation(vec, use, tmp_vec, 0);
-    assert(vec.size() == pow);
+    // depth-first over the permutations in lexicographic order, dropping a prefix as soon as it maps an edge to a
+    // non-edge
     std::vector<std::vector<int> > isomorphism_vec;
-    isomorphism_vec.clear();
-    for (const std::vector<int> &v: vec) {
-        bool flag = true;
-        for (int i = 0; i < size; ++i)
-            for (int j = i + 1; j < size; ++j)
-                if (adj_mat[INDEX(i, j, size)] != 0)
-                    if (adj_mat[INDEX(v[i], v[j], size)] == 0) // not isomorphism
-                    {
-                        flag = false;
-                        break;
-                    }
-        if (flag == true)
+    std::vector<int> v(size, -1);
+    std::vector<bool> use(size, false);
+    std::function<void(int)> extend = [&](int depth) {
+        if (depth == size) {
             isomorphism_vec.push_back(v);
-    }
+            return;
+        }
+        for (int x = 0; x < size; ++x) {
+            if (use[x]) continue;
+            bool flag = true;
+            for (int i = 0; i < depth && flag; ++i)
+                if (adj_mat[INDEX(i, depth, size)] != 0 && adj_mat[INDEX(v[i], x, size)] == 0) // not isomorphism
+                    flag = false;
+            if (!flag) continue;
+            use[x] = true;
+            v[depth] = x;
+            extend(depth + 1);
+            use[x] = false;
+        }
+    };
+    extend(0);
     return isomorphism_vec;
 }
 
@@ -1291,7 +1395,7 @@ void Schedule::performance_modeling(int *best_order, std::vector<std::vector<int
     order = new int[size];
     rank = new int[size];
 
-    double min_val;
+    double min_val = std::numeric_limits<double>::max();
     bool have_best = false;
     std::vector<int> invariant_size[size];
     for (const std::vector<int> &vec: candidates) {
@@ -1406,7 +1510,7 @@ void Schedule::bug_performance_modeling(int *best_order, std::vector<std::vector
     order = new int[size];
     rank = new int[size];
 
-    double min_val;
+    double min_val = std::numeric_limits<double>::max();
     bool have_best = false;
     std::vector<int> invariant_size[size];
     for (const std::vector<int> &vec: candidates) {
@@ -1530,7 +1634,7 @@ void Schedule::new_performance_modeling(int *best_order, std::vector<std::vector
     order = new int[size];
     rank = new int[size];
 
-    double min_val;
+    double min_val = std::numeric_limits<double>::max();
     bool have_best = false;
     std::vector<int> invariant_size[size];
     for (const std::vector<int> &vec: candidates) {
@@ -1809,7 +1913,7 @@ void Schedule::GraphZero_performance_modeling(int *best_order, int v_cnt, unsign
     rank = new int[size];
 
     for (int i = 0; i < size; ++i) order[i] = i;
-    double min_val;
+    double min_val = std::numeric_limits<double>::max();
     bool have_best = false;
     do {
         // check whether it is valid schedule
@@ -1918,7 +2022,7 @@ void Schedule::restrict_selection(int v_cnt, unsigned int e_cnt, long long tri_c
         pp_size[i] = pp_size[i - 1] * p1;
     }
 
-    double min_val;
+    double min_val = std::numeric_limits<double>::max();
     bool have_best = false;
     std::vector<int> invariant_size[size];
 
@@ -1994,28 +2098,38 @@ void Schedule::restrict_selection(int v_cnt, unsigned int e_cnt, long long tri_c
     assert(have_best);
 }
 
+// number of orders of the pattern vertices in which the first vertex of every pair comes after the second one
+static long long count_restricted_orders(int size, const std::vector<std::pair<int, int> > &pairs) {
+    std::vector<int> before(size, 0);
+    for (const auto &pair: pairs) before[pair.first] |= 1 << pair.second;
+    std::vector<long long> num_orders(1 << size, 0);
+    num_orders[0] = 1;
+    for (int placed = 0; placed < (1 << size); ++placed) {
+        if (num_orders[placed] == 0) continue;
+        for (int v = 0; v < size; ++v)
+            if (!(placed >> v & 1) && (before[v] & placed) == before[v])
+                num_orders[placed | 1 << v] += num_orders[placed];
+    }
+    return num_orders[(1 << size) - 1];
+}
+
 void Schedule::restricts_generate(const int *cur_adj_mat, std::vector<std::vector<std::pair<int, int> > > &restricts) {
     Schedule schedule(cur_adj_mat, get_size());
     schedule.aggressive_optimize_get_all_pairs(restricts);
     int size = schedule.get_size();
-    Graph *complete;
-    DataLoader *D = new DataLoader();
-    assert(D->load_complete(complete, size + 1));
-    int thread_num = 1;
-    long long ans = complete->pattern_matching(schedule, thread_num) / schedule.get_multiplicity();
+    // A restriction set is kept if it leaves exactly one of the automorphic matches of every subgraph. Matching on a
+    // complete graph tells the same as counting the vertex orders that satisfy the restrictions, which is cheaper.
+    long long ans = 1;
+    for (int i = 2; i <= size; ++i) ans *= i;
+    ans /= schedule.get_multiplicity();
     for (int i = 0; i < restricts.size();) {
-        Schedule cur_schedule(schedule.get_adj_mat_ptr(), schedule.get_size());
-        cur_schedule.add_restrict(restricts[i]);
-        long long cur_ans = complete->pattern_matching(cur_schedule, thread_num);
+        long long cur_ans = count_restricted_orders(size, restricts[i]);
         if (cur_ans != ans) {
             restricts.erase(restricts.begin() + i);
         } else {
             ++i;
         }
     }
-
-    delete complete;
-    delete D;
 }
 
 int Schedule::get_vec_optimize_num(const std::vector<int> &vec) {
@@ -2087,14 +2201,12 @@ Schedule::our_estimate_schedule_restrict(const std::vector<int> &order, const st
     double sum[restricts_size];
     for (int i = 0; i < restricts_size; ++i) sum[i] = 0;
 
-    int tmp[size];
-    for (int i = 0; i < size; ++i) tmp[i] = i;
-    do {
-        for (int i = 0; i < restricts_size; ++i)
-            if (tmp[restricts[i].first] > tmp[restricts[i].second]) {
-                sum[i] += 1;
-            } else break;
-    } while (std::next_permutation(tmp, tmp + size));
+    // orders of the vertices satisfying the first i + 1 restrictions
+    std::vector<std::pair<int, int> > prefix_restricts;
+    for (int i = 0; i < restricts_size; ++i) {
+        prefix_restricts.push_back(restricts[i]);
+        sum[i] = count_restricted_orders(size, prefix_restricts);
+    }
 
     double total = 1;
     for (int i = 2; i <= size; ++i) total *= i;
@@ -2139,6 +2251,13 @@ Schedule::our_estimate_schedule_restrict(const std::vector<int> &order, const st
     return val;
 }
 
+double Schedule::estimate_schedule_restrict(const std::vector<int> &order,
+                                            const std::vector<std::pair<int, int> > &pairs, uint64_t v_cnt,
+                                            uint64_t e_cnt, uint64_t tri_cnt, PerfModelType model_type) {
+    if (model_type == PerfModelType::graphpi) return our_estimate_schedule_restrict(order, pairs, v_cnt, e_cnt, tri_cnt);
+    return GraphZero_estimate_schedule_restrict(order, pairs, v_cnt, e_cnt);
+}
+
 double Schedule::GraphZero_estimate_schedule_restrict(const std::vector<int> &order,
                                                       const std::vector<std::pair<int, int> > &pairs, uint64_t v_cnt,
                                                       uint64_t e_cnt) {
@@ -2168,15 +2287,12 @@ double Schedule::GraphZero_estimate_schedule_restrict(const std::vector<int> &or
     double sum[restricts_size];
     for (int i = 0; i < restricts_size; ++i) sum[i] = 0;
 
-    int tmp[size];
-    for (int i = 0; i < size; ++i) tmp[i] = i;
-    do {
-        for (int i = 0; i < restricts_size; ++i) {
-            if (tmp[restricts[i].first] > tmp[restricts[i].second]) {
-                sum[i] += 1;
-            } else break;
-        }
-    } while (std::next_permutation(tmp, tmp + size));
+    // orders of the vertices satisfying the first i + 1 restrictions
+    std::vector<std::pair<int, int> > prefix_restricts;
+    for (int i = 0; i < restricts_size; ++i) {
+        prefix_restricts.push_back(restricts[i]);
+        sum[i] = count_restricted_orders(size, prefix_restricts);
+    }
 
     double total = 1;
     for (int i = 2; i <= size; ++i) total *= i;
@@ -6,6 +6,7 @@
 #define MINIGRAPH_CODEGEN_H
 
 #include "common.h"
+#include <vector>
 namespace minigraph
 {
 
@@ -19,6 +20,36 @@ namespace minigraph
      * meta: metadata of the target graph
      * */
     std::string gen_code(const std::string& adj_mat, CodeGenConfig config, MetaData meta);
+
+    /* brief Single Labeled Pattern Scheduling
+     * labels: vertex label of every pattern vertex (empty = unlabeled); requires a graph preprocessed with labels
+     * */
+    std::string gen_code(const std::string& adj_mat, const std::vector<int>& labels, CodeGenConfig config, MetaData meta);
+
+    /* brief Multi-Pattern Scheduling
+     * Every pattern is scheduled on its own; the plans are merged over their common loop prefixes so that the
+     * shared loops and set operations are computed once and all counts come out of a single traversal.
+     * The count of adj_mats[k] is Context::get_pattern_results()[k]. Counting only, without pruning, OpenMP.
+     * */
+    std::string gen_code(const std::vector<std::string>& adj_mats, CodeGenConfig config, MetaData meta);
+
+    // accumulated statistics of one probe of a plan generated with RunnerType::Analyze
+    struct ProbeStats {
+        uint64_t calls{0}, input{0}, output{0};
+        double seconds{0};
+    };
+
+    /* brief Human-readable view of the plan gen_code would schedule for a pattern
+     * Prints the loops, set operations, MiniGraphs and IEP groups as a tree with their estimated sizes and costs.
+     * analyzed: the statistics of an Analyze run of the same plan, printed next to the estimates if not empty
+     * */
+    std::string explain_plan(const std::string& adj_mat, const std::vector<int>& labels, CodeGenConfig config,
+                             MetaData meta, const std::vector<ProbeStats>& analyzed = {});
+
+    /* brief Read a pattern file (queries/...*.graph)
+     * Returns the adjacency matrix; labels are filled for the labeled "t/v/e" format and left empty otherwise.
+     * */
+    std::string read_pattern(const std::string& path, std::vector<int>& labels);
 }
 
 #endif //MINIGRAPH_CODEGEN_H
\ No newline at end of file
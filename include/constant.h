@@ -32,6 +32,22 @@ namespace minigraph
         inline static const std::string kMetaMaxDegree = "MAX_DEGREE";
         inline static const std::string kMetaMaxOffset = "MAX_OFFSET";
         inline static const std::string kMetaMaxTriangle = "MAX_TRIANGLE";
+        inline static const std::string kMetaNumLabel = "NUM_LABEL"; // optional, 0 = unlabeled graph
+        // Cost Model (optional, written by calibrate)
+        inline static const std::string kCostModelFile = "cost_model.txt";
+        inline static const std::string kCostBuildNs = "BUILD_NS";
+        inline static const std::string kCostScanNs = "SCAN_NS";
+        inline static const std::string kCostReuseScale = "REUSE_SCALE";
+        inline static const std::string kCostLargeDegreeFactor = "LARGE_DEGREE_FACTOR";
+        // Graph Statistics (optional, written by prep)
+        inline static const std::string kStatsFile = "stats.txt";
+        inline static const std::string kStatsBucket = "DEGREE_BUCKET";
+        inline static const std::string kStatsEdgeCommon = "EDGE_COMMON";
+        inline static const std::string kStatsWedgeCommon = "WEDGE_COMMON";
+        inline static const std::string kStatsTwoHop = "TWO_HOP";
+        // Tuned Configurations (optional, written by autotune)
+        inline static const std::string kTuneFile = "autotune.txt";
+        inline static const std::string kTuneDecision = "DECISION";
         // Graph Data
         inline static const std::string kDataFile = "snap.txt";
         inline static const std::string kIndptrU64File = "indptr_u64.bin";
@@ -46,6 +62,17 @@ namespace minigraph
         inline static const std::string kOffsetU32File = "offset_u32.bin";
         inline static const std::string kDegreeU32File = "degree_u32.bin";
 
+        // Vertex Labels (optional)
+        inline static const std::string kLabelFile = "labels.txt";
+        inline static const std::string kLabelU32File = "label_u32.bin";
+        inline static const std::string kLabelOffsetU32File = "label_offset_u32.bin";
+        inline static const std::string kLabelIndicesU64File = "label_indices_u64.bin";
+        inline static const std::string kLabelIndicesU32File = "label_indices_u32.bin";
+
+        // Cached k-cores (written by runner to <graph_dir>/core_<k>, in the layout above)
+        inline static const std::string kCoreDirPrefix = "core_";
+        inline static const std::string kCoreIdsU64File = "core_ids_u64.bin";
+
         // Profiling Files
         inline static const std::string kExpCompileFile = "compile_log.csv";
         inline static const std::string kExpRunnerFile = "run_log.csv";
@@ -0,0 +1,47 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_DECOMPOSE_H
+#define MINIGRAPH_DECOMPOSE_H
+#include <array>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace minigraph
+{
+    // a pattern counted as a correction term of a decomposition
+    struct QuotientPattern {
+        std::string adj_mat;
+        std::vector<int> labels; // empty if unlabeled
+        uint64_t num_automorphisms{1};
+        uint64_t multiplicity{0}; // number of vertex identifications producing an isomorphic pattern
+    };
+
+    /* brief Edge-induced pattern split at a cut vertex c into two sides sharing c
+     * With e_s(v) the number of embeddings of side s that map c to v, every pair of side embeddings agreeing on c is
+     * an embedding of the pattern unless vertices of the two sides collide. The pairs whose collisions identify the
+     * matching M of side-0 and side-1 vertices are exactly the embeddings of the quotient pattern P/M, so
+     *   embeddings(P) = sum_v e_0(v) * e_1(v) - sum_{M != {}} embeddings(P/M)
+     * and the count of P is embeddings(P) / num_automorphisms. c is vertex 0 of both sides; a side of two vertices
+     * is the edge (c, leaf) with e(v) = degree(v). Quotients are grouped by isomorphism.
+     * */
+    struct PatternDecomposition {
+        int cut{-1}; // the cut vertex in the input pattern
+        std::array<std::string, 2> side_mats;
+        std::array<std::vector<int>, 2> side_labels;
+        // automorphisms of the side fixing c: e(v) = side_stabilizer * (subgraphs where v is matched to the orbit of c)
+        std::array<uint64_t, 2> side_stabilizer{1, 1};
+        uint64_t num_automorphisms{1};
+        std::vector<QuotientPattern> quotients;
+    };
+
+    /* brief Split a connected pattern at the cut vertex giving the smallest sides (ties: fewest quotients)
+     * Returns false if the pattern has no cut vertex or every split needs more than max_matchings quotients.
+     * Labeled patterns only identify vertices of the same label and need sides of at least three vertices.
+     * */
+    bool decompose_pattern(const std::string &adj_mat, const std::vector<int> &labels, PatternDecomposition &out,
+                           uint64_t max_matchings = 4096);
+}
+#endif //MINIGRAPH_DECOMPOSE_H
@@ -0,0 +1,24 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_FRONTEND_H
+#define MINIGRAPH_FRONTEND_H
+#include <string>
+#include <filesystem>
+
+// shared by the frontends (run, census, autotune, explain) that write a plan, build the runner and run it
+namespace minigraph
+{
+    // stdout of a shell command
+    std::string exec(const char *cmd);
+
+    // the generated plan compiled into the runner
+    std::filesystem::path code_path();
+
+    std::filesystem::path runner_path();
+
+    // builds the runner target with the plan at code_path(), output discarded
+    std::string compile_runner_cmd();
+}
+#endif //MINIGRAPH_FRONTEND_H
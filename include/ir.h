@@ -10,6 +10,7 @@
 #include <optional>
 #include <vector>
 #include <cassert>
+#include <algorithm>
 namespace minigraph {
     /*! \brief Maximum pattern size supported for generating pattern matching plan*/
     static const int MAX_PATTERN_SIZE = 64;
@@ -42,11 +43,12 @@ namespace minigraph {
         EdgeIR m_edges;
         EdgeRestrictIR m_restricts;
         int m_loop_depth{-1}; // VertexIR should include all incoming-edges matched in [0, m_loop_depth]^th vertices
+        int m_label{-1}; // candidates must carry this vertex label (-1 = unlabeled)
     public:
         int id{-1};
         inline static AdjMatType adjMatType{AdjMatType::VertexInduced};
         VertexSetIR() = default;
-        VertexSetIR(const EdgeIR &edges, const EdgeRestrictIR restricts, int loop_depth);
+        VertexSetIR(const EdgeIR &edges, const EdgeRestrictIR restricts, int loop_depth, int label = -1);
 
         // true if exactly the same
         bool operator==(const VertexSetIR &rhs) const;
@@ -55,6 +57,8 @@ namespace minigraph {
         bool
         operator<(const VertexSetIR &rhs) const;; // for sorting VertexSetIR in the order of 1) edge_num 2) restrict_num
         int loop_depth() const { return m_loop_depth; }; // m_loop_depth
+        int label() const { return m_label; };
+        bool is_labeled() const { return m_label != -1; };
         int edge_num() const { return m_edges.count(); }; // number of 1s in m_edges in the range of [0, loop_depth]
         int restrict_num() const { return m_restricts.count(); }; // number of 1s in m_restricts in the range of [0, loop_depth]
         bool share_at_least_one_parent_node(const VertexSetIR& other) const;
@@ -108,6 +112,12 @@ namespace minigraph {
         std::vector<bool> mg_bounded; // id to is_clique
         std::vector<VertexSetIR> iter_set;
         std::vector<VertexSetIR> iep_set;
+        std::vector<int> labels; // label of the vertex matched at each loop; empty for unlabeled patterns
+        std::vector<int> orbits; // local count column of the vertex matched at each loop; empty unless counting per vertex
+        std::vector<int> degrees; // pattern degree of the vertex matched at each loop
+        std::vector<int> triangles; // closed wedges (twice the triangles) at the vertex matched at each loop
+        int num_orbits() const { return orbits.empty() ? 0 : *std::max_element(orbits.begin(), orbits.end()) + 1; };
+        std::vector<int> last_ops; // ids of the ops that are only counted above the last loop (multi-pattern plans)
         std::optional<VertexSetIR> get_parent_vset(const VertexSetIR& vset) const;
         std::optional<VertexSetIR> get_parent_vset(const VertexSetIR& vset, size_t dep) const;
         std::optional<MiniGraphIR> get_parent_mg(const VertexSetIR& intersect) const;
@@ -5,10 +5,86 @@
 #ifndef MINIGRAPH_META_H
 #define MINIGRAPH_META_H
 #include <string>
+#include <vector>
+#include <map>
+#include <tuple>
 #include <stdint.h>
 
 namespace minigraph
 {
+    /* brief Parameters of the MiniGraphCostModel pruning decision, calibrated for a graph on this machine
+     * Written to the graph directory by calibrate; the defaults reproduce the uncalibrated cost model.
+     * */
+    class CostModelParams {
+    public:
+        bool calibrated{false}; // read from the graph directory
+        double build_ns{1.0}; // per element merged while pruning an adjacency list
+        double scan_ns{1.0}; // per element of an unpruned adjacency list scanned by a later set operation
+        double reuse_scale{1.0}; // observed / estimated visits of the MiniGraphs (profile feedback)
+        double large_degree_factor{4.0}; // adjacency lists of degree >= factor * average degree are always pruned
+
+        void save(std::string in_dir);
+        void read(std::string in_dir); // keeps the defaults if the graph has not been calibrated
+    };
+
+    /* brief Sketch of the degree and neighborhood overlap distributions of a graph, written by prep
+     * Estimates of intermediate set sizes use it instead of a uniform random graph with the same numbers of
+     * vertices, edges and triangles, which underestimates both on power-law graphs.
+     * */
+    class GraphStats {
+    public:
+        // vertices of degree in [2^b, 2^(b+1)) for bucket b
+        struct Bucket {
+            uint64_t num_vertex{0};
+            uint64_t sum_degree{0};
+            uint64_t sum_degree2{0};
+            uint64_t sum_triangle{0}; // closed wedges (twice the triangles) at the vertices
+        };
+        struct Distribution {
+            double mean{0}, p50{0}, p90{0}, p99{0};
+        };
+        bool collected{false}; // read from the graph directory
+        std::vector<Bucket> buckets;
+        Distribution edge_common; // |N(u) & N(v)| of random edges (u, v)
+        Distribution wedge_common; // |N(u) & N(w)| of random paths u - v - w with u != w
+        Distribution two_hop; // sum of the degrees of the neighbors of random vertices
+
+        void save(std::string in_dir);
+        void read(std::string in_dir); // leaves collected false if prep has not written the sketch
+
+        // expected degree of a vertex reached through an edge
+        double edge_degree() const;
+        // probability that a neighbor of u is a neighbor of v, for adjacent u and v (clustering of the wedges)
+        double edge_closure() const;
+        // probability that a neighbor of u is a neighbor of w, for u and w two hops apart
+        double wedge_closure() const;
+        // fraction of the vertices (or of the edge endpoints) at vertices of degree below min_degree or with fewer
+        // than min_triangle closed wedges; degrees and closed wedges are taken as uniform inside a bucket
+        double pruned_fraction(uint64_t min_degree, uint64_t min_triangle, bool per_endpoint) const;
+    };
+
+    /* brief Configurations chosen by autotune for the patterns of a graph, written to the graph directory
+     * A decision holds for a pattern, an adjacency type and a number of threads; run uses it for a query whose
+     * pruning and parallel types are left to auto.
+     * */
+    class TuningRecords {
+    public:
+        struct Decision {
+            int pruning_type{4};
+            int parallel_type{3};
+            int order_rank{0}; // CodeGenConfig::orderRank
+            double estimated_seconds{0}; // runtime extrapolated from the sampled roots
+        };
+        // (pattern_key, adj_type, num_threads)
+        std::map<std::tuple<std::string, int, int>, Decision> decisions;
+
+        // adjacency matrix, followed by ':' and the comma-separated vertex labels of a labeled pattern
+        static std::string pattern_key(const std::string &adj_mat, const std::vector<int> &labels);
+
+        void save(std::string in_dir);
+        void read(std::string in_dir); // no decisions if the graph has not been tuned
+    };
+
     class MetaData {
     public:
         uint64_t num_vertex{0};
@@ -17,6 +93,9 @@ namespace minigraph
         uint64_t max_degree{0};
         uint64_t max_offset{0};
         uint64_t max_triangle{0};
+        uint64_t num_label{0}; // number of distinct vertex labels; 0 if the graph is unlabeled
+        CostModelParams cost;
+        GraphStats stats;
 
         MetaData() = default;
         MetaData(uint64_t _num_vertex, uint64_t _num_edge, uint64_t _num_triangle,
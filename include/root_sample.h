@@ -0,0 +1,30 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_ROOT_SAMPLE_H
+#define MINIGRAPH_ROOT_SAMPLE_H
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace minigraph
+{
+    // roots sampled from one degree bucket; every root stands for weight vertices of the bucket
+    struct RootStratum {
+        double weight{1};
+        std::vector<uint64_t> roots;
+    };
+
+    /* brief Roots sampled from the buckets of vertices of degree [2^b, 2^(b+1)) of a preprocessed graph
+     * The work under a root grows with its degree, so the sample is split over the buckets in proportion to their
+     * total degree (at least one root per bucket, at most the whole bucket). Strata are listed from the highest
+     * degree down. The runner runs such a sample when MINIGRAPH_ROOT_SAMPLE names a file written by save_root_sample.
+     * */
+    std::vector<RootStratum> sample_roots(const std::string &graph_dir, uint64_t num_vertex, size_t sample_size);
+
+    // one stratum per line: the weight followed by the roots
+    void save_root_sample(const std::string &path, const std::vector<RootStratum> &strata);
+    std::vector<RootStratum> read_root_sample(const std::string &path);
+}
+#endif //MINIGRAPH_ROOT_SAMPLE_H
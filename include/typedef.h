@@ -29,7 +29,11 @@ namespace minigraph {
 
     enum class RunnerType {
         Benchmark,
-        Profiling // TODO: Implement it
+        Profiling, // TODO: Implement it
+        Enumeration, // write every embedding to Context::embeddings instead of only counting them
+        LocalCount, // count the matched subgraphs every data vertex takes part in (Context::local_counts)
+        OrbitCount, // LocalCount split by the orbit of the pattern vertex the data vertex is matched to
+        Analyze // count and record the calls, set sizes and time of every op in Context::analyzer (explain)
     };
 
     struct CodeGenConfig {
@@ -37,6 +41,9 @@ namespace minigraph {
         PruningType pruningType = PruningType::None;
         ParallelType parType = ParallelType::OpenMP;
         RunnerType runnerType = RunnerType::Benchmark;
+        int orderRank = 0; // use the orderRank-th cheapest matching order of the schedule search (autotune)
+        bool candidateFilter = true; // skip iterated vertices of lower degree or triangle count than their pattern vertex
+        bool cliqueEngine = true; // count complete unlabeled patterns with CliqueCounter (Benchmark runs only)
     };
 
 
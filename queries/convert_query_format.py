@@ -3,7 +3,7 @@ import os
 import sys
 
 def convert_query_file(input_path, output_path):
-    """Convert from labeled graph format to simple adjacency format"""
+    """Convert from labeled graph format to simple adjacency format (drops the labels)"""
     
     vertices = 0
     edges = []
@@ -28,6 +28,7 @@ def convert_query_file(input_path, output_path):
             f.write(f"{src} {dst}\n")
 
 # Convert all query files
+# The labeled .graph files are kept (./build/bin/run reads them directly); the unlabeled copy is written next to them
 for root, dirs, files in os.walk('queries'):
     for file in files:
         if file.endswith('.graph'):
@@ -39,7 +40,7 @@ for root, dirs, files in os.walk('queries'):
                     first_line = f.readline().strip()
                     if first_line.startswith('t '):
                         print(f"Converting: {input_path}")
-                        convert_query_file(input_path, input_path)
+                        convert_query_file(input_path, input_path[:-len('.graph')] + '.unlabeled')
             except:
                 print(f"Skipping: {input_path}")
 
@@ -0,0 +1,165 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+#include "codegen.h"
+#include "logging.h"
+#include "configure.h"
+#include "common.h"
+#include "frontend.h"
+#include "root_sample.h"
+#include <vector>
+#include <iostream>
+#include <fmt/format.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <string>
+#include <array>
+#include <set>
+#include <algorithm>
+#include <limits>
+using namespace minigraph;
+
+struct Candidate {
+    PruningType pruning;
+    ParallelType parallel;
+    int order_rank;
+};
+
+/* brief Configurations by how far they are from CostModel + NestedRt on the cheapest matching order
+ * Distance is the sum of the positions in the preference lists below and the rank of the order, so the first
+ * candidates vary one choice at a time.
+ * */
+std::vector<Candidate> rank_candidates(int num_orders) {
+    const std::vector<PruningType> pruning_pref = {PruningType::CostModel, PruningType::Online, PruningType::Static,
+                                                   PruningType::Eager, PruningType::None};
+    const std::vector<ParallelType> parallel_pref = {ParallelType::NestedRt, ParallelType::Nested,
+                                                     ParallelType::OpenMP, ParallelType::TbbTop};
+    std::vector<std::pair<std::array<int, 4>, Candidate>> scored;
+    for (int rank = 0; rank < num_orders; rank++) {
+        for (size_t i = 0; i < pruning_pref.size(); i++) {
+            for (size_t j = 0; j < parallel_pref.size(); j++) {
+                std::array<int, 4> score{rank + (int) i + (int) j, rank, (int) i, (int) j};
+                scored.push_back({score, Candidate{pruning_pref[i], parallel_pref[j], rank}});
+            }
+        }
+    }
+    std::sort(scored.begin(), scored.end(), [](const auto &l, const auto &r) { return l.first < r.first; });
+    std::vector<Candidate> out;
+    for (const auto &item: scored) out.push_back(item.second);
+    return out;
+}
+
+// ESTIMATED_EXECUTION_TIME(s)=<seconds> printed by the runner; infinity if it was cut off
+double parse_estimate(const std::string &run_results) {
+    const std::string key = "ESTIMATED_EXECUTION_TIME(s)=";
+    size_t pos = run_results.find(key);
+    CHECK(pos != std::string::npos) << "Missing " << key << " in the runner output:\n" << run_results;
+    std::string value = run_results.substr(pos + key.size(), run_results.find('\n', pos) - pos - key.size());
+    if (value.rfind("Cutoff", 0) == 0) return std::numeric_limits<double>::infinity();
+    return std::stod(value);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 6) {
+        std::cout << "./autotune [graph_name] [graph_dir] [query_name] [query] [adj_type] [top_n=8 (optional)] [sample_size=1000 (optional)] [num_orders=3 (optional)]\n";
+        std::cout << "Times the top_n candidate (pruning_type, parallel_type, matching order) configurations of a query on\n"
+                     "about sample_size roots sampled by degree, extrapolates their runtime on all roots and records the\n"
+                     "fastest in graph_dir/" << Constant::kTuneFile << ". run picks it up when pruning_type and parallel_type are auto.\n";
+        std::cout << "query: adjacency matrix of the pattern or a pattern file, as for run\n";
+        std::cout << "adj_type: 0=VertexInduced; 1=EdgeInduced; 2=EdgeInducedIEP\n";
+        std::cout << "num_orders: number of the cheapest matching orders of the schedule search to consider\n";
+        std::cout << "The decision holds for the OMP_NUM_THREADS the candidates run with.\n";
+        std::cout << "For example:\n./build/bin/autotune wiki ./dataset/GraphMini/wiki P1 0111101111011110 0\n";
+        return 0;
+    }
+    std::string graph_name{argv[1]};
+    std::string graph_dir{argv[2]};
+    std::string query_name{argv[3]};
+    std::string query_str{argv[4]};
+    int adjmat_type_int = std::atoi(argv[5]);
+    size_t top_n = 8, sample_size = 1000;
+    int num_orders = 3;
+    if (argc >= 7) top_n = std::stoul(argv[6]);
+    if (argc >= 8) sample_size = std::stoul(argv[7]);
+    if (argc >= 9) num_orders = std::atoi(argv[8]);
+    CHECK(top_n > 0 && sample_size > 0 && num_orders > 0) << "top_n, sample_size and num_orders must be positive";
+    int num_threads = 1; // the default of the runner
+    if (getenv("OMP_NUM_THREADS") != NULL) num_threads = std::atoi(getenv("OMP_NUM_THREADS"));
+
+    std::string pat;
+    std::vector<int> labels;
+    if (std::filesystem::is_regular_file(query_str)) {
+        pat = read_pattern(query_str, labels);
+    } else {
+        pat = query_str;
+    }
+    CHECK(pat.find(',') == std::string::npos) << "Multi-pattern queries always use OpenMP without pruning";
+
+    MetaData meta;
+    meta.read(graph_dir);
+    std::vector<RootStratum> strata = sample_roots(graph_dir, meta.num_vertex, sample_size);
+    std::filesystem::path sample_path = std::filesystem::path(PROJECT_PLAN_DIR) / "autotune_roots.txt";
+    save_root_sample(sample_path, strata);
+    size_t num_sampled = 0;
+    for (const RootStratum &stratum: strata) num_sampled += stratum.roots.size();
+    LOG(MSG) << "Graph=" << graph_name << " Query=" << query_name << " Threads=" << num_threads
+             << " SampledRoots=" << num_sampled << " Strata=" << strata.size();
+    setenv("MINIGRAPH_ROOT_SAMPLE", sample_path.c_str(), 1);
+
+    auto compile_cmd = compile_runner_cmd();
+    auto run_cmd = fmt::format("{bin_path} -1 {data_dir}", fmt::arg("bin_path", runner_path().string()),
+                               fmt::arg("data_dir", graph_dir));
+
+    std::set<std::string> generated; // candidates generating the same plan are timed once
+    size_t num_timed = 0;
+    double best_seconds = std::numeric_limits<double>::infinity();
+    Candidate best{PruningType::CostModel, ParallelType::NestedRt, 0};
+    for (const Candidate &cand: rank_candidates(num_orders)) {
+        if (num_timed >= top_n) break;
+        CodeGenConfig conf;
+        conf.adjMatType = static_cast<AdjMatType>(adjmat_type_int);
+        conf.pruningType = cand.pruning;
+        conf.parType = cand.parallel;
+        conf.orderRank = cand.order_rank;
+        std::string code = gen_code(pat, labels, conf, meta);
+        if (!generated.insert(code).second) continue;
+        num_timed++;
+        std::ofstream out_file(code_path());
+        out_file << code;
+        out_file.close();
+
+        Timer t;
+        if (system(compile_cmd.c_str()) != 0) exit(-1 && "compilation error");
+        double compile_t = t.Passed();
+        // a candidate is dropped as soon as its estimate exceeds that of the best one
+        if (best_seconds < std::numeric_limits<double>::infinity()) {
+            setenv("MINIGRAPH_SAMPLE_CUTOFF", std::to_string(best_seconds).c_str(), 1);
+        }
+        t.Reset();
+        double seconds = parse_estimate(exec(run_cmd.c_str()));
+        LOG(MSG) << fmt::format("CANDIDATE pruning_type={} parallel_type={} order_rank={} COMPILATION_TIME(s)={:.2f} "
+                                "SAMPLE_TIME(s)={:.2f} ESTIMATED_EXECUTION_TIME(s)={}",
+                                (int) cand.pruning, (int) cand.parallel, cand.order_rank, compile_t, t.Passed(),
+                                seconds == std::numeric_limits<double>::infinity() ? "Cutoff" : std::to_string(seconds));
+        if (seconds < best_seconds) {
+            best_seconds = seconds;
+            best = cand;
+        }
+    }
+    CHECK(best_seconds < std::numeric_limits<double>::infinity()) << "No candidate finished";
+
+    TuningRecords records;
+    records.read(graph_dir);
+    TuningRecords::Decision &decision = records.decisions[{TuningRecords::pattern_key(pat, labels), adjmat_type_int,
+                                                           num_threads}];
+    decision.pruning_type = static_cast<int>(best.pruning);
+    decision.parallel_type = static_cast<int>(best.parallel);
+    decision.order_rank = best.order_rank;
+    decision.estimated_seconds = best_seconds;
+    records.save(graph_dir);
+    LOG(MSG) << fmt::format("BEST pruning_type={} parallel_type={} order_rank={} ESTIMATED_EXECUTION_TIME(s)={}",
+                            decision.pruning_type, decision.parallel_type, decision.order_rank, best_seconds);
+    LOG(MSG) << "Saved\t" << std::filesystem::path(graph_dir) / Constant::kTuneFile;
+}
@@ -0,0 +1,110 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_ANALYZER_H
+#define MINIGRAPH_ANALYZER_H
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace minigraph {
+    /* brief Statistics of every probe of a plan generated with RunnerType::Analyze
+     * A probe is a set op, a MiniGraph build or the IEP block of the plan (see explain_plan for the numbering).
+     * input: size of the set the op starts from (the vertices of a MiniGraph); output: size of its result, or what it
+     *        added to the count for ops that only count (the candidates a MiniGraph is pruned to)
+     * Every thread accumulates into its own buffer, which are summed by reduce().
+     * format: one line "probe calls input output nanoseconds" per probe
+     * */
+    class PlanAnalyzer {
+    public:
+        struct Stats {
+            uint64_t calls{0}, input{0}, output{0}, nanos{0};
+        };
+
+        class alignas(64) Buffer {
+        private:
+            friend class PlanAnalyzer;
+            std::vector<Stats> m_stats;
+        public:
+            Stats &at(size_t probe) { return m_stats[probe]; };
+        };
+
+    private:
+        std::vector<Buffer> m_buffers;
+
+    public:
+        explicit PlanAnalyzer(int _num_threads) : m_buffers(_num_threads) {};
+
+        PlanAnalyzer(const PlanAnalyzer &) = delete;
+        PlanAnalyzer &operator=(const PlanAnalyzer &) = delete;
+
+        // called by the plan before it starts
+        void init(size_t num_probes) {
+            for (Buffer &buf: m_buffers) buf.m_stats.assign(num_probes, Stats{});
+        };
+
+        Buffer &buffer(int thread_id) { return m_buffers.at(thread_id); };
+
+        std::vector<Stats> reduce() const {
+            std::vector<Stats> out;
+            for (const Buffer &buf: m_buffers) {
+                out.resize(buf.m_stats.size());
+                for (size_t i = 0; i < buf.m_stats.size(); i++) {
+                    out[i].calls += buf.m_stats[i].calls;
+                    out[i].input += buf.m_stats[i].input;
+                    out[i].output += buf.m_stats[i].output;
+                    out[i].nanos += buf.m_stats[i].nanos;
+                }
+            }
+            return out;
+        };
+
+        void save(const std::string &path) const {
+            FILE *file = fopen(path.c_str(), "w");
+            if (file == nullptr) throw std::runtime_error("Failed to open analyze file: " + path);
+            std::vector<Stats> stats = reduce();
+            for (size_t i = 0; i < stats.size(); i++) {
+                fprintf(file, "%zu %lu %lu %lu %lu\n", i, (unsigned long) stats[i].calls, (unsigned long) stats[i].input,
+                        (unsigned long) stats[i].output, (unsigned long) stats[i].nanos);
+            }
+            fclose(file);
+        };
+    };
+
+    /* brief Times one execution of a probe
+     * The generated code calls done() right after the op; an op that ends the iteration with continue (its result is
+     * empty) is recorded with an empty output when the probe goes out of scope.
+     * */
+    class OpProbe {
+    private:
+        PlanAnalyzer::Stats &m_stats;
+        std::chrono::steady_clock::time_point m_start;
+        bool m_done{false};
+    public:
+        const long long start_count; // the counter before the op, for ops that only count
+
+        OpProbe(PlanAnalyzer::Buffer &buf, size_t probe, uint64_t input, long long count) :
+                m_stats{buf.at(probe)}, m_start{std::chrono::steady_clock::now()}, start_count{count} {
+            m_stats.calls++;
+            m_stats.input += input;
+        };
+
+        OpProbe(const OpProbe &) = delete;
+        OpProbe &operator=(const OpProbe &) = delete;
+
+        void done(uint64_t output) {
+            m_stats.output += output;
+            m_stats.nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_start).count();
+            m_done = true;
+        };
+
+        ~OpProbe() {
+            if (!m_done) done(0);
+        };
+    };
+}
+#endif //MINIGRAPH_ANALYZER_H
@@ -7,6 +7,12 @@
 #include "vertex_set.h"
 #include "graph.h"
 #include "minigraph.h"
+#include "embedding.h"
+#include "local_count.h"
+#include "analyzer.h"
+#include "candidate_filter.h"
+#include "kcore.h"
+#include "clique.h"
 #include <omp.h>
 #include <oneapi/tbb/parallel_for.h>
 #include <oneapi/tbb/tick_count.h>
@@ -28,6 +34,12 @@ namespace minigraph {
         std::vector<cc> per_thread_handled;
         std::vector<double> per_thread_time; // omp
         std::vector<tbb::tick_count> per_thread_tick; // tbb
+        EmbeddingSink *embeddings{nullptr}; // only used by plans generated with RunnerType::Enumeration
+        LocalCounter *local_counts{nullptr}; // only used by plans generated with RunnerType::LocalCount/OrbitCount
+        PlanAnalyzer *analyzer{nullptr}; // only used by plans generated with RunnerType::Analyze
+        std::vector<std::vector<cc>> per_thread_pattern_result; // [thread][pattern], only used by multi-pattern plans
+        const std::vector<IdType> *roots{nullptr}; // vertices matched to the first pattern vertex; all if null
+        std::vector<CandidateFilter> filters; // degree and triangle filters of the pattern vertices, built by the plan
         Context(int _num_threads): num_threads{_num_threads}{
             tick_begin = tbb::tick_count::now();
             per_thread_tick.resize(num_threads, tick_begin);
@@ -36,6 +48,11 @@ namespace minigraph {
             per_thread_handled.resize(num_threads);
         };
 
+        // number of vertices the first loop iterates over and the i-th of them
+        size_t num_roots(size_t num_vertex) const { return roots == nullptr ? num_vertex : roots->size(); }
+
+        IdType root(size_t i) const { return roots == nullptr ? static_cast<IdType>(i) : (*roots)[i]; }
+
         double tick_time(size_t i) {
             return (per_thread_tick.at(i) - tick_begin).seconds();
         }
@@ -67,8 +84,26 @@ namespace minigraph {
             for (cc c: per_thread_result) {
                 out += c.count;
             }
+            for (long long c: get_pattern_results()) {
+                out += c;
+            }
             return out / std::max(1, iep_redundency);
         }
+
+        // called by multi-pattern plans before they start
+        void init_patterns(size_t num_patterns) {
+            per_thread_pattern_result.assign(num_threads, std::vector<cc>(num_patterns));
+        }
+
+        // count of every pattern of a multi-pattern plan; empty for single-pattern plans
+        std::vector<long long> get_pattern_results() {
+            std::vector<long long> out;
+            for (const auto &counters: per_thread_pattern_result) {
+                out.resize(counters.size(), 0);
+                for (size_t k = 0; k < counters.size(); k++) out[k] += counters[k].count;
+            }
+            return out;
+        }
         double get_max_time(){
             int i = 0;
             double out = per_thread_time.at(0) + tick_time(0);
@@ -0,0 +1,47 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_CANDIDATE_FILTER_H
+#define MINIGRAPH_CANDIDATE_FILTER_H
+#include "graph.h"
+#include <vector>
+#include <omp.h>
+
+namespace minigraph {
+    /* brief Bitmap of the data vertices that can be matched to a pattern vertex of a given degree and triangle count
+     * An embedding maps the edges and triangles of a pattern vertex to distinct edges and triangles of its image,
+     * so a vertex with fewer neighbors or closed wedges (Graph::m_triangles, twice its triangles) can be skipped.
+     * Plans build one filter per distinct threshold before matching and test the vertices they iterate over.
+     * */
+    class CandidateFilter {
+    private:
+        std::vector<uint64_t> m_words;
+        uint64_t m_num_candidates{0};
+    public:
+        CandidateFilter(const Graph *graph, uint64_t min_degree, uint64_t min_triangle) {
+            const int64_t num_words = (graph->get_vnum() + 63) / 64;
+            m_words.resize(num_words, 0);
+            uint64_t num_candidates = 0;
+            // every word is owned by one iteration, so the bits are set without atomics
+#pragma omp parallel for schedule(static) reduction(+:num_candidates)
+            for (int64_t w = 0; w < num_words; w++) {
+                uint64_t word = 0;
+                const uint64_t end = std::min<uint64_t>(graph->get_vnum(), (w + 1) * 64);
+                for (uint64_t v_id = w * 64; v_id < end; v_id++) {
+                    if (graph->Degree(v_id) < min_degree) continue;
+                    if (min_triangle > 0 && graph->m_triangles[v_id] < min_triangle) continue;
+                    word |= 1ull << (v_id & 63);
+                }
+                m_words[w] = word;
+                num_candidates += __builtin_popcountll(word);
+            }
+            m_num_candidates = num_candidates;
+        };
+
+        bool test(IdType v_id) const { return (m_words[v_id >> 6] >> (v_id & 63)) & 1; };
+
+        uint64_t num_candidates() const { return m_num_candidates; };
+    };
+}
+#endif //MINIGRAPH_CANDIDATE_FILTER_H
@@ -0,0 +1,232 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_CLIQUE_H
+#define MINIGRAPH_CLIQUE_H
+#include "graph.h"
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+namespace minigraph {
+    /* brief Counts the k-cliques of a graph, one root vertex at a time
+     * The vertices are ranked by a degeneracy ordering and every edge is oriented towards the higher rank, so a vertex
+     * has at most degeneracy out-neighbors and every clique is counted once, at its lowest ranked vertex.
+     * For a root, its out-neighbors are renumbered 0..d-1 and the edges among them stored as rows of d bits, so the
+     * candidate sets of the deeper levels are intersected a word at a time.
+     * pivot: count with the succinct clique tree of Pivoter (Jain and Seshadhri, WSDM'20) instead of listing the
+     *        cliques. Every leaf holds h chosen vertices and p pivots adjacent to all of them and stands for
+     *        C(p, k - h) k-cliques, so the cost no longer grows with the number of cliques, which pays off for large k.
+     * */
+    class CliqueCounter {
+    public:
+        // per-thread buffers of count()
+        struct Workspace {
+            std::vector<uint64_t> rows; // rows[i * words + w]: bits of the local out-neighbors of local vertex i
+            std::vector<uint64_t> sets; // two candidate sets (next and remaining) per recursion level
+            size_t words{0};
+
+            uint64_t *row(size_t i) { return rows.data() + i * words; };
+
+            uint64_t *set(size_t level, size_t which) { return sets.data() + (2 * level + which) * words; };
+        };
+
+    private:
+        uint64_t m_k;
+        bool m_pivot;
+        uint64_t m_degeneracy{0};
+        std::vector<uint64_t> m_indptr;
+        std::vector<IdType> m_out; // out-neighbors of every vertex, in increasing id order
+        std::vector<uint64_t> m_binom; // m_binom[p * (m_k + 1) + j] = C(p, j)
+
+        static uint64_t popcount(const uint64_t *set, size_t words) {
+            uint64_t out = 0;
+            for (size_t w = 0; w < words; w++) out += __builtin_popcountll(set[w]);
+            return out;
+        };
+
+        // cliques of l more vertices in set, each found along increasing ranks
+        uint64_t list(Workspace &ws, const uint64_t *set, uint64_t l, size_t level) const {
+            const size_t words = ws.words;
+            if (l == 1) return popcount(set, words);
+            uint64_t out = 0;
+            uint64_t *next = ws.set(level, 0);
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t bits = set[w]; bits != 0; bits &= bits - 1) {
+                    const uint64_t *row = ws.row(w * 64 + __builtin_ctzll(bits));
+                    if (l == 2) {
+                        for (size_t x = 0; x < words; x++) out += __builtin_popcountll(set[x] & row[x]);
+                        continue;
+                    }
+                    uint64_t size = 0;
+                    for (size_t x = 0; x < words; x++) {
+                        next[x] = set[x] & row[x];
+                        size += __builtin_popcountll(next[x]);
+                    }
+                    if (size >= l - 1) out += list(ws, next, l - 1, level + 1);
+                }
+            }
+            return out;
+        };
+
+        // k-cliques of the subtree of the succinct clique tree with candidates set, h chosen vertices and p pivots
+        uint64_t pivot(Workspace &ws, const uint64_t *set, uint64_t size, uint64_t h, uint64_t p, size_t level) const {
+            // the subtree holds the chosen vertices alone once, every other clique of it is larger
+            if (h == m_k) return 1;
+            if (h + p + size < m_k) return 0;
+            if (size == 0) return m_binom[p * (m_k + 1) + m_k - h];
+            const size_t words = ws.words;
+            // the pivot covers the most candidates
+            size_t piv = 0;
+            uint64_t piv_size = 0;
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t bits = set[w]; bits != 0; bits &= bits - 1) {
+                    const size_t i = w * 64 + __builtin_ctzll(bits);
+                    const uint64_t covered = popcount_and(set, ws.row(i), words);
+                    if (covered >= piv_size) piv = i, piv_size = covered;
+                }
+            }
+            uint64_t *next = ws.set(level, 0), *rest = ws.set(level, 1);
+            const uint64_t *piv_row = ws.row(piv);
+            for (size_t w = 0; w < words; w++) next[w] = set[w] & piv_row[w];
+            uint64_t out = pivot(ws, next, piv_size, h, p + 1, level + 1);
+            // the cliques without the pivot that are not in its neighborhood hold one of the other candidates
+            std::copy(set, set + words, rest);
+            rest[piv >> 6] &= ~(1ull << (piv & 63));
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t bits = set[w] & ~piv_row[w]; bits != 0; bits &= bits - 1) {
+                    const size_t i = w * 64 + __builtin_ctzll(bits);
+                    if (i == piv) continue;
+                    const uint64_t *row = ws.row(i);
+                    uint64_t next_size = 0;
+                    for (size_t x = 0; x < words; x++) {
+                        next[x] = rest[x] & row[x];
+                        next_size += __builtin_popcountll(next[x]);
+                    }
+                    out += pivot(ws, next, next_size, h + 1, p, level + 1);
+                    rest[i >> 6] &= ~(1ull << (i & 63));
+                }
+            }
+            return out;
+        };
+
+        static uint64_t popcount_and(const uint64_t *a, const uint64_t *b, size_t words) {
+            uint64_t out = 0;
+            for (size_t w = 0; w < words; w++) out += __builtin_popcountll(a[w] & b[w]);
+            return out;
+        };
+
+    public:
+        CliqueCounter(const Graph *graph, uint64_t k, bool pivot) : m_k{k}, m_pivot{pivot} {
+            const int64_t num_vertex = graph->get_vnum();
+            // degeneracy ordering by bucket peeling (Batagelj and Zaversnik): rank = removal order
+            std::vector<uint64_t> degree(num_vertex), pos(num_vertex), rank(num_vertex);
+            std::vector<IdType> order(num_vertex);
+            uint64_t max_degree = 0;
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+                degree[v_id] = graph->Degree(v_id);
+                max_degree = std::max(max_degree, degree[v_id]);
+            }
+            std::vector<uint64_t> bin(max_degree + 2, 0);
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) bin[degree[v_id] + 1]++;
+            for (uint64_t d = 1; d <= max_degree + 1; d++) bin[d] += bin[d - 1];
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+                pos[v_id] = bin[degree[v_id]]++;
+                order[pos[v_id]] = v_id;
+            }
+            // bin[d] -> first position of degree d
+            for (uint64_t d = max_degree + 1; d > 0; d--) bin[d] = bin[d - 1];
+            bin[0] = 0;
+            for (int64_t i = 0; i < num_vertex; i++) {
+                const IdType v_id = order[i];
+                rank[v_id] = i;
+                VertexSet adj = graph->N(v_id);
+                for (size_t j = 0; j < adj.size(); j++) {
+                    const IdType u_id = adj[j];
+                    if (degree[u_id] <= degree[v_id]) continue;
+                    // move u to the front of its bucket, then into the bucket below
+                    const uint64_t du = degree[u_id], pu = pos[u_id], pw = bin[du];
+                    const IdType w_id = order[pw];
+                    if (u_id != w_id) {
+                        std::swap(order[pu], order[pw]);
+                        pos[u_id] = pw;
+                        pos[w_id] = pu;
+                    }
+                    bin[du]++;
+                    degree[u_id]--;
+                }
+            }
+            m_indptr.assign(num_vertex + 1, 0);
+            uint64_t max_out_degree = 0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(max:max_out_degree)
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+                VertexSet adj = graph->N(v_id);
+                uint64_t out_degree = 0;
+                for (size_t j = 0; j < adj.size(); j++) out_degree += rank[adj[j]] > rank[v_id];
+                m_indptr[v_id + 1] = out_degree;
+                max_out_degree = std::max(max_out_degree, out_degree);
+            }
+            m_degeneracy = max_out_degree;
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) m_indptr[v_id + 1] += m_indptr[v_id];
+            m_out.resize(m_indptr[num_vertex]);
+#pragma omp parallel for schedule(dynamic, 64)
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+                VertexSet adj = graph->N(v_id);
+                IdType *out = m_out.data() + m_indptr[v_id];
+                for (size_t j = 0; j < adj.size(); j++) {
+                    if (rank[adj[j]] > rank[v_id]) *out++ = adj[j];
+                }
+            }
+            // pivots of a leaf are out-neighbors of the root
+            m_binom.assign((m_degeneracy + 1) * (m_k + 1), 0);
+            for (uint64_t p = 0; p <= m_degeneracy; p++) {
+                m_binom[p * (m_k + 1)] = 1;
+                for (uint64_t j = 1; j <= std::min(p, m_k); j++) {
+                    m_binom[p * (m_k + 1) + j] = m_binom[(p - 1) * (m_k + 1) + j - 1] + m_binom[(p - 1) * (m_k + 1) + j];
+                }
+            }
+        };
+
+        uint64_t degeneracy() const { return m_degeneracy; };
+
+        // k-cliques whose lowest ranked vertex is root
+        uint64_t count(IdType root, Workspace &ws) const {
+            const IdType *out = m_out.data() + m_indptr[root];
+            const uint64_t d = m_indptr[root + 1] - m_indptr[root];
+            if (m_k <= 1) return m_k;
+            if (d < m_k - 1) return 0;
+            if (m_k == 2) return d;
+            const size_t words = (d + 63) / 64;
+            ws.words = words;
+            ws.rows.assign(d * words, 0);
+            // every level removes a candidate, so listing goes k levels deep and pivoting at most d + 1
+            const size_t levels = (m_pivot ? d + 2 : m_k) + 1;
+            if (ws.sets.size() < 2 * levels * words) ws.sets.resize(2 * levels * words);
+            // local ids follow the order of the out-neighbors, so the edges among them are found by merging
+            for (uint64_t i = 0; i < d; i++) {
+                const IdType *nb = m_out.data() + m_indptr[out[i]], *nb_end = m_out.data() + m_indptr[out[i] + 1];
+                uint64_t j = 0;
+                while (nb != nb_end && j < d) {
+                    if (*nb < out[j]) nb++;
+                    else if (out[j] < *nb) j++;
+                    else {
+                        ws.row(i)[j >> 6] |= 1ull << (j & 63);
+                        if (m_pivot) ws.row(j)[i >> 6] |= 1ull << (i & 63);
+                        nb++, j++;
+                    }
+                }
+            }
+            uint64_t *set = ws.set(0, 0);
+            std::fill(set, set + words, ~0ull);
+            if (d % 64 != 0) set[words - 1] = (1ull << (d % 64)) - 1;
+            if (m_pivot) {
+                // the sets of level l are written by the calls at level l, the root's is kept aside
+                std::copy(set, set + words, ws.set(0, 1));
+                return pivot(ws, ws.set(0, 1), d, 1, 0, 1);
+            }
+            return list(ws, set, m_k - 1, 1);
+        };
+    };
+}
+#endif //MINIGRAPH_CLIQUE_H
@@ -0,0 +1,138 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_EMBEDDING_H
+#define MINIGRAPH_EMBEDDING_H
+#include "vertex_set.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <initializer_list>
+
+namespace minigraph {
+    /* brief Destination of the embeddings produced by an enumeration plan
+     * Every matched tuple (i0_id ... ik_id) is first appended to the buffer owned by the worker thread and
+     * the buffer is handed to the sink once it holds `batch` tuples. Flushing is synchronous and serialized,
+     * so a slow consumer (e.g. a full pipe) stalls the producers instead of growing the buffers (backpressure).
+     * target: "|cmd" = stdin of cmd; otherwise a binary file (stdout is reserved for the runner's log)
+     * format: tuples of `width` native IdType values, in the vertex order of the generated plan
+     * limit: stop after `limit` embeddings have been accepted (0 = unlimited)
+     * */
+    class EmbeddingSink {
+    public:
+        using Callback = std::function<void(const IdType *tuples, uint64_t num_tuples, int width)>;
+
+        class alignas(64) Buffer {
+        private:
+            friend class EmbeddingSink;
+            EmbeddingSink *m_sink{nullptr};
+            std::vector<IdType> m_data;
+        public:
+            // returns false once the limit has been reached or the consumer went away: the caller should stop enumerating
+            bool push(std::initializer_list<IdType> tuple) {
+                assert(tuple.size() == (size_t) m_sink->m_width);
+                if (m_sink->done()) return false;
+                if (!m_sink->reserve()) return false;
+                m_data.insert(m_data.end(), tuple);
+                if (m_data.size() >= m_sink->m_batch * m_sink->m_width) flush();
+                return true;
+            };
+
+            bool done() const { return m_sink->done(); };
+
+            void flush() {
+                if (m_data.empty()) return;
+                m_sink->write(m_data.data(), m_data.size() / m_sink->m_width);
+                m_data.clear();
+            };
+        };
+
+    private:
+        int m_width{0};
+        uint64_t m_batch{0};
+        uint64_t m_limit{0};
+        FILE *m_file{nullptr};
+        bool m_pipe{false};
+        Callback m_callback;
+        std::mutex m_mutex;
+        alignas(64) std::atomic<uint64_t> m_reserved{0};
+        alignas(64) std::atomic<bool> m_done{false};
+        uint64_t m_written{0};
+        std::vector<Buffer> m_buffers;
+
+        void init_buffers(int num_threads) {
+            m_buffers.resize(num_threads);
+            for (Buffer &buf: m_buffers) {
+                buf.m_sink = this;
+                buf.m_data.reserve(m_batch * m_width);
+            }
+        };
+
+        bool reserve() {
+            if (m_limit == 0) return true;
+            if (m_reserved.fetch_add(1, std::memory_order_relaxed) < m_limit) return true;
+            m_done.store(true, std::memory_order_relaxed);
+            return false;
+        };
+
+        void write(const IdType *tuples, uint64_t num_tuples) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_callback) {
+                m_callback(tuples, num_tuples, m_width);
+            } else {
+                // the consumer went away (e.g. `head` on the other end of a pipe): stop enumerating
+                num_tuples = fwrite(tuples, sizeof(IdType) * m_width, num_tuples, m_file);
+                if (ferror(m_file)) m_done.store(true, std::memory_order_relaxed);
+            }
+            m_written += num_tuples;
+        };
+
+    public:
+        EmbeddingSink(int _width, const std::string &_target, int _num_threads, uint64_t _limit = 0,
+                      uint64_t _batch = 4096) : m_width{_width}, m_batch{_batch}, m_limit{_limit} {
+            if (!_target.empty() && _target.front() == '|') {
+                m_file = popen(_target.substr(1).c_str(), "w");
+                m_pipe = true;
+            } else {
+                m_file = fopen(_target.c_str(), "wb");
+            }
+            if (m_file == nullptr) throw std::runtime_error("Failed to open embedding sink: " + _target);
+            init_buffers(_num_threads);
+        };
+
+        EmbeddingSink(int _width, Callback _callback, int _num_threads, uint64_t _limit = 0,
+                      uint64_t _batch = 4096) : m_width{_width}, m_batch{_batch}, m_limit{_limit},
+                                                m_callback{std::move(_callback)} {
+            init_buffers(_num_threads);
+        };
+
+        EmbeddingSink(const EmbeddingSink &) = delete;
+        EmbeddingSink &operator=(const EmbeddingSink &) = delete;
+
+        ~EmbeddingSink() { close(); };
+
+        Buffer &buffer(int thread_id) { return m_buffers.at(thread_id); };
+
+        bool done() const { return m_done.load(std::memory_order_relaxed); };
+
+        int width() const { return m_width; };
+
+        // number of embeddings handed to the consumer so far
+        uint64_t written() const { return m_written; };
+
+        // flush the remaining tuples of every thread; must be called after the plan has returned
+        void close() {
+            for (Buffer &buf: m_buffers) buf.flush();
+            if (m_file == nullptr) return;
+            if (m_pipe) pclose(m_file);
+            else fclose(m_file);
+            m_file = nullptr;
+        };
+    };
+}
+#endif //MINIGRAPH_EMBEDDING_H
@@ -0,0 +1,136 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_KCORE_H
+#define MINIGRAPH_KCORE_H
+#include "graph.h"
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+namespace minigraph {
+    /* brief Vertices of the k-core of a graph, in increasing id order
+     * Every vertex of an embedding has at least as many neighbors in the embedding as its pattern vertex has in the
+     * pattern, so the embeddings of a pattern of minimum degree k lie in the k-core of the data graph.
+     * The vertices of degree below k are peeled round by round in parallel: a vertex joins the next round when the
+     * removal of a neighbor brings its degree from k to k - 1, which happens exactly once.
+     * */
+    inline std::vector<IdType> core_vertices(const Graph *graph, uint64_t k) {
+        const int64_t num_vertex = graph->get_vnum();
+        std::vector<std::atomic<uint64_t>> degree(num_vertex);
+        std::vector<IdType> frontier;
+#pragma omp parallel
+        {
+            std::vector<IdType> local;
+#pragma omp for schedule(static) nowait
+            for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+                degree[v_id].store(graph->Degree(v_id), std::memory_order_relaxed);
+                if (graph->Degree(v_id) < k) local.push_back(v_id);
+            }
+#pragma omp critical
+            frontier.insert(frontier.end(), local.begin(), local.end());
+        }
+        while (!frontier.empty()) {
+            std::vector<IdType> next;
+#pragma omp parallel
+            {
+                std::vector<IdType> local;
+#pragma omp for schedule(dynamic, 64) nowait
+                for (size_t i = 0; i < frontier.size(); i++) {
+                    VertexSet adj = graph->N(frontier[i]);
+                    for (size_t j = 0; j < adj.size(); j++) {
+                        if (degree[adj[j]].fetch_sub(1, std::memory_order_relaxed) == k) local.push_back(adj[j]);
+                    }
+                }
+#pragma omp critical
+                next.insert(next.end(), local.begin(), local.end());
+            }
+            frontier.swap(next);
+        }
+        std::vector<IdType> out;
+        for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+            if (degree[v_id].load(std::memory_order_relaxed) >= k) out.push_back(v_id);
+        }
+        return out;
+    }
+
+    /* brief Subgraph induced by ids (sorted), with vertex i of the output being ids[i]
+     * Renumbering in id order keeps the adjacency lists (and the label-sorted ones) sorted. The per-vertex triangle
+     * counts and max_triangle are kept from the input graph: they only bound the core's from above, which is all the
+     * candidate filters and the set buffers need.
+     * */
+    inline Graph *induced_graph(const Graph *graph, const std::vector<IdType> &ids) {
+        const int64_t num_vertex = ids.size();
+        auto new_id = [&ids](IdType v_id) {
+            auto itr = std::lower_bound(ids.begin(), ids.end(), v_id);
+            return itr != ids.end() && *itr == v_id ? (IdType) (itr - ids.begin()) : INVALID_ID;
+        };
+        Graph *out = new Graph;
+        out->num_vertex = num_vertex;
+        out->num_label = graph->num_label;
+        out->max_triangle = graph->max_triangle;
+        out->m_indptr = new uint64_t[num_vertex + 1];
+        out->m_offset = new uint64_t[num_vertex];
+        out->m_triangles = new uint64_t[num_vertex];
+        out->m_indptr[0] = 0;
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+            VertexSet adj = graph->N(ids[v_id]);
+            uint64_t degree = 0;
+            for (size_t j = 0; j < adj.size(); j++) degree += new_id(adj[j]) != INVALID_ID;
+            out->m_indptr[v_id + 1] = degree;
+            out->m_triangles[v_id] = graph->m_triangles[ids[v_id]];
+        }
+        for (int64_t v_id = 0; v_id < num_vertex; v_id++) out->m_indptr[v_id + 1] += out->m_indptr[v_id];
+        out->num_edge = out->m_indptr[num_vertex];
+        out->m_indices = new IdType[out->num_edge];
+        if (out->num_label > 0) {
+            out->m_labels = new uint32_t[num_vertex];
+            out->m_label_indices = new IdType[out->num_edge];
+            out->m_label_offset = new uint32_t[num_vertex * out->num_label];
+        }
+        uint64_t max_degree = 0, max_offset = 0, num_triangle = 0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(max:max_degree, max_offset) reduction(+:num_triangle)
+        for (int64_t v_id = 0; v_id < num_vertex; v_id++) {
+            const IdType old_id = ids[v_id];
+            VertexSet adj = graph->N(old_id);
+            IdType *indices = out->m_indices + out->m_indptr[v_id];
+            uint64_t degree = 0;
+            for (size_t j = 0; j < adj.size(); j++) {
+                IdType nb = new_id(adj[j]);
+                if (nb != INVALID_ID) indices[degree++] = nb;
+            }
+            out->m_offset[v_id] = std::lower_bound(indices, indices + degree, (IdType) v_id) - indices;
+            max_degree = std::max(max_degree, degree);
+            max_offset = std::max(max_offset, out->m_offset[v_id]);
+            num_triangle += out->m_triangles[v_id];
+            if (out->num_label == 0) continue;
+            out->m_labels[v_id] = graph->m_labels[old_id];
+            IdType *label_indices = out->m_label_indices + out->m_indptr[v_id];
+            uint32_t *label_offset = out->m_label_offset + v_id * out->num_label;
+            std::fill(label_offset, label_offset + out->num_label, 0);
+            const IdType *old_label_indices = graph->m_label_indices + graph->m_indptr[old_id];
+            uint64_t size = 0;
+            for (size_t j = 0; j < adj.size(); j++) {
+                IdType nb = new_id(old_label_indices[j]);
+                if (nb == INVALID_ID) continue;
+                label_indices[size++] = nb;
+                label_offset[graph->m_labels[old_label_indices[j]]]++;
+            }
+            // neighbors per label -> begin of every label
+            uint32_t begin = 0;
+            for (uint64_t l = 0; l < out->num_label; l++) {
+                uint32_t count = label_offset[l];
+                label_offset[l] = begin;
+                begin += count;
+            }
+        }
+        out->max_degree = max_degree;
+        out->max_offset = max_offset;
+        out->num_triangle = num_triangle;
+        return out;
+    }
+}
+#endif //MINIGRAPH_KCORE_H
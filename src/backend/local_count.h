@@ -0,0 +1,89 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#ifndef MINIGRAPH_LOCAL_COUNT_H
+#define MINIGRAPH_LOCAL_COUNT_H
+#include "vertex_set.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <oneapi/tbb/parallel_for.h>
+
+namespace minigraph {
+    /* brief Number of matched subgraphs every data vertex takes part in
+     * width: 1 for plain local counts; the number of orbits of the pattern vertices for orbit counts, in which case
+     *        column o counts the subgraphs where the vertex is matched to a pattern vertex of orbit o
+     * Every thread accumulates into its own dense num_vertex x width array and reduce() sums them in parallel.
+     * format: num_vertex x width native uint64_t, row-major, indexed by the vertex ids of the preprocessed graph
+     * */
+    class LocalCounter {
+    public:
+        class alignas(64) Buffer {
+        private:
+            friend class LocalCounter;
+            uint64_t m_width{1};
+            std::vector<uint64_t> m_counts;
+        public:
+            void add(IdType v_id, int orbit, uint64_t cnt) { m_counts[v_id * m_width + orbit] += cnt; };
+
+            // every vertex of the set is matched once
+            void add(const VertexSet &vset, int orbit) {
+                for (size_t i = 0; i < vset.size(); i++) m_counts[vset[i] * m_width + orbit]++;
+            };
+        };
+
+    private:
+        uint64_t m_num_vertex{0};
+        uint64_t m_width{1};
+        std::vector<Buffer> m_buffers;
+
+    public:
+        LocalCounter(uint64_t _num_vertex, uint64_t _width, int _num_threads) : m_num_vertex{_num_vertex},
+                                                                                m_width{_width} {
+            m_buffers.resize(_num_threads);
+            for (Buffer &buf: m_buffers) {
+                buf.m_width = m_width;
+                buf.m_counts.resize(m_num_vertex * m_width, 0);
+            }
+        };
+
+        LocalCounter(const LocalCounter &) = delete;
+        LocalCounter &operator=(const LocalCounter &) = delete;
+
+        Buffer &buffer(int thread_id) { return m_buffers.at(thread_id); };
+
+        uint64_t width() const { return m_width; };
+
+        // sum of the per-thread counts; must be called after the plan has returned
+        std::vector<uint64_t> reduce() const {
+            std::vector<uint64_t> out(m_num_vertex * m_width, 0);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, out.size()), [this, &out](const tbb::blocked_range<size_t> &r) {
+                for (const Buffer &buf: m_buffers) {
+                    for (size_t i = r.begin(); i < r.end(); i++) out[i] += buf.m_counts[i];
+                }
+            });
+            return out;
+        };
+
+        // ids: original id of every vertex if the plan ran on a renumbered subgraph of a graph of num_vertex vertices;
+        //      the rows of the vertices outside the subgraph are 0
+        void save(const std::string &path, const std::vector<IdType> *ids = nullptr, uint64_t num_vertex = 0) const {
+            std::vector<uint64_t> counts = reduce();
+            if (ids != nullptr) {
+                std::vector<uint64_t> rows(num_vertex * m_width, 0);
+                for (size_t i = 0; i < ids->size(); i++)
+                    std::copy_n(counts.begin() + i * m_width, m_width, rows.begin() + (*ids)[i] * m_width);
+                counts.swap(rows);
+            }
+            FILE *file = fopen(path.c_str(), "wb");
+            if (file == nullptr) throw std::runtime_error("Failed to open local count file: " + path);
+            size_t written = fwrite(counts.data(), sizeof(uint64_t), counts.size(), file);
+            fclose(file);
+            if (written != counts.size()) throw std::runtime_error("Failed to write local count file: " + path);
+        };
+    };
+}
+#endif //MINIGRAPH_LOCAL_COUNT_H
@@ -8,9 +8,15 @@
 #include "vertex_set.h"
 #include "graph.h"
 #include <atomic>
+#include <type_traits>
+#include <algorithm>
+#include <functional>
+#include <oneapi/tbb/parallel_for.h>
+#include <oneapi/tbb/parallel_reduce.h>
 
 #define NOT_PRUNE -2
 #define WILL_PRUNE -1
+#define BUILDING -3
 //#define DISABLE_REUSE 1
 
 namespace minigraph {
@@ -65,6 +71,10 @@ namespace minigraph {
         const double kAllocScale = 1.5;
     public:
         inline static std::atomic_uint64_t TOTAL_ALLOCATED{0};
+        // bytes the pools of all threads may allocate (0 = unlimited); builds that would exceed it degrade (see Admit)
+        inline static std::atomic_uint64_t BUDGET{0};
+        // builds that left lists unpruned because of BUDGET
+        inline static std::atomic_uint64_t DEGRADED_BUILDS{0};
 
         MiniGraphPool() = default;
 
@@ -83,6 +93,18 @@ namespace minigraph {
             return pool;
         }
 
+        /* brief Whether a buffer of num_elements can be handed out without exceeding BUDGET
+         * True if this thread has such a buffer available already. The check is not atomic with the allocation, so
+         * concurrent builds may overshoot the budget by one buffer each.
+         * */
+        bool Admit(size_t num_elements) const {
+            uint64_t budget = BUDGET.load(std::memory_order_relaxed);
+            if (budget == 0 || num_elements <= m_4k_cap) return true;
+            if (!buffer_avail.empty() && buffer_avail.back().capacity >= num_elements) return true;
+            size_t capacity = ((num_elements * kAllocScale / m_increment) + 1) * m_increment;
+            return TOTAL_ALLOCATED + capacity * sizeof(IdType) <= budget;
+        }
+
         Container AllocateWorkSpace(size_t num_elements) {
             if (num_elements <= m_4k_cap) return AllocateSmallWorkSpace();
             if (buffer_avail.empty() || buffer_avail.back().capacity < num_elements) {
@@ -189,8 +211,19 @@ namespace minigraph {
                 m_ctn = MiniGraphPool::Get().AllocateWorkSpace(_capacity);
             }
         };
+
+        // whether Resize or Reserve to _capacity stays within MiniGraphPool::BUDGET
+        bool Admit(size_t _capacity) const {
+            return capacity() >= _capacity || MiniGraphPool::Get().Admit(_capacity);
+        };
     };
 
+    // count a build in MiniGraphPool::DEGRADED_BUILDS the first time it leaves a list unpruned
+    inline void mark_degraded(bool &degraded) {
+        if (!degraded) MiniGraphPool::DEGRADED_BUILDS++;
+        degraded = true;
+    }
+
     inline const IdType *advance(const IdType* begin, const IdType* end, const IdType val) {
         while (*begin < val && begin < end) begin++;
         return begin;
@@ -214,6 +247,11 @@ namespace minigraph {
         return itr;
     }
 
+    inline bool contains(const VertexSet &set, IdType v_id) {
+        const IdType *itr = binary_search(set.begin(), set.end(), v_id);
+        return itr != set.end() && *itr == v_id;
+    }
+
     inline ManagedContainer get_indices(const VertexSet &_vertices, const VertexSet &_to_iter) {
         ManagedContainer out(_to_iter.size());
         if (_vertices.begin() == _to_iter.begin()) {
@@ -258,30 +296,180 @@ namespace minigraph {
     };
 
 
-    // MiniGraph Interface
-    struct MiniGraphIF {
-        MiniGraphIF() = default;
+    /* brief Positions of the vertices of a MiniGraph in the vertices of its parent
+     * Owned, or shared with the index map the plan computed for the same vertex set in the current iteration, in
+     * which case the map must outlive the MiniGraph (the plan declares it first).
+     * */
+    class IndexMap {
+    private:
+        ManagedContainer m_own;
+        const IdType *m_data{nullptr};
+        size_t m_size{0};
+    public:
+        template<typename MiniGraph>
+        void assign(const MiniGraph *mg, const VertexSet &_vertex, const ManagedContainer *_shared) {
+            if (_shared != nullptr) {
+                m_data = _shared->begin();
+                m_size = _shared->size();
+                return;
+            }
+            m_own = mg->indices(_vertex);
+            m_data = m_own.begin();
+            m_size = m_own.size();
+        }
+
+        size_t size() const { return m_size; }
+
+        IdType operator[](size_t i) const {
+            assert(i < m_size);
+            return m_data[i];
+        }
+    };
 
-        virtual ~MiniGraphIF() = default;
+    /* brief Lazily pruned adjacency lists shared by the tasks of nested plans
+     * The m_degree entry of a list that is not pruned yet is claimed by a single task with a CAS to BUILDING; that
+     * task fills the range of m_ctn reserved for the list and publishes the degree with a release store. Readers
+     * never wait: a list that is being pruned by another task is read unpruned, as the lists the cost model decides
+     * not to prune already are.
+     * */
+    inline IdType load_degree(const IdType &entry) {
+        return __atomic_load_n(&entry, __ATOMIC_ACQUIRE);
+    }
+
+    inline bool claim_degree(IdType &entry, IdType unbuilt) {
+        return __atomic_compare_exchange_n(&entry, &unbuilt, static_cast<IdType>(BUILDING), false,
+                                           __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    }
 
+    inline void publish_degree(IdType &entry, IdType degree) {
+        __atomic_store_n(&entry, degree, __ATOMIC_RELEASE);
+    }
+
+    struct MiniGraphCost {
+        double build_ns{1.0};
+        double scan_ns{1.0};
+        double large_degree_factor{4.0};
+    };
+
+    /* brief Common base of the MiniGraphs (adjacency lists of a vertex set pruned by an intersect set)
+     * The MiniGraph types are templates on whether the lists are bounded by the vertex id and on the type of the
+     * MiniGraph they are pruned from (void = the data graph). Generated plans name the concrete instantiation, so
+     * N(), indices() and Degree() are resolved at compile time and inlined into the loops using them.
+     * */
+    struct MiniGraphIF {
         inline static const Graph *DATA_GRAPH{nullptr};
 
-        virtual void build(const VertexSet &_vertex,
-                           const VertexSet &_intersect,
-                           const VertexSet &_iter) = 0;
+        // per-element costs of MiniGraphCostModel::should_prune; plans of calibrated graphs set them (see calibrate)
+        inline static MiniGraphCost COST{};
+
+        // upper bound of the size of the pruned adjacency list of v_id
+        template<bool Bounded>
+        static size_t max_pruned_degree(IdType v_id, size_t intersect_size) {
+            return std::min<size_t>(intersect_size, Bounded ? DATA_GRAPH->Offset(v_id) : DATA_GRAPH->Degree(v_id));
+        }
+    };
+
+    // a MiniGraph build probes its intersect set instead of merging once it prunes at least this many lists
+    constexpr size_t PROBE_MIN_LISTS = 4;
+
+    /* brief One-to-many intersection of the intersect set of a MiniGraph with the lists it prunes
+     * The left set is marked once in a dense bitmap over the vertex ids owned by the thread; every list shorter than
+     * the left set is then streamed through membership probes (cost = size of the list, stopping at the largest
+     * marked id) instead of being merged with the left set. Longer lists are still merged. The marks are cleared
+     * when the probe goes out of scope, so the bitmap is all-zero between builds.
+     * */
+    class IntersectProbe {
+    private:
+        const VertexSet &m_left;
+        bool m_marked{false};
+        IdType m_max{0};
+
+        static std::vector<uint64_t> &bitmap() {
+            thread_local static std::vector<uint64_t> bits;
+            return bits;
+        }
+
+        static bool test(const std::vector<uint64_t> &bits, IdType v_id) {
+            return (bits[v_id / 64] >> (v_id % 64)) & 1;
+        }
+
+    public:
+        IntersectProbe(const VertexSet &_left, size_t _num_lists) : m_left{_left} {
+            if (_num_lists < PROBE_MIN_LISTS || m_left.size() == 0) return;
+            m_marked = true;
+            m_max = m_left[m_left.size() - 1];
+            std::vector<uint64_t> &bits = bitmap();
+            if (bits.size() <= m_max / 64) bits.resize(m_max / 64 + 1, 0);
+            for (IdType v_id: m_left) bits[v_id / 64] |= uint64_t{1} << (v_id % 64);
+        }
 
-        virtual void build(MiniGraphIF *mg,
-                           const VertexSet &_vertex,
-                           const VertexSet &_intersect,
-                           const VertexSet &_iter) = 0;
+        ~IntersectProbe() {
+            if (!m_marked) return;
+            std::vector<uint64_t> &bits = bitmap();
+            for (IdType v_id: m_left) bits[v_id / 64] = 0;
+        }
 
-        virtual VertexSet N(IdType i) = 0;
+        IntersectProbe(const IntersectProbe &) = delete;
+        IntersectProbe &operator=(const IntersectProbe &) = delete;
 
-        virtual ManagedContainer indices(const VertexSet &_to_iter) const = 0;
+        size_t intersect(const VertexSet &list, IdType *buffer) const {
+            if (!m_marked || list.size() >= m_left.size()) return m_left.intersect(list, buffer);
+            const std::vector<uint64_t> &bits = bitmap();
+            size_t out_size = 0;
+            for (IdType v_id: list) {
+                if (v_id > m_max) break;
+                if (test(bits, v_id)) buffer[out_size++] = v_id;
+            }
+            return out_size;
+        }
 
-        virtual IdType Degree(IdType i) const = 0;
+        // only the ids smaller than upper
+        size_t intersect(const VertexSet &list, IdType upper, IdType *buffer) const {
+            if (!m_marked || list.size() >= m_left.size()) return m_left.intersect(list, upper, buffer);
+            const std::vector<uint64_t> &bits = bitmap();
+            size_t out_size = 0;
+            for (IdType v_id: list) {
+                if (v_id > m_max || v_id >= upper) break;
+                if (test(bits, v_id)) buffer[out_size++] = v_id;
+            }
+            return out_size;
+        }
     };
 
+    // MiniGraphs built from at least this many adjacency lists use the parallel build if the plan allows it (_par)
+    constexpr size_t PAR_BUILD_THRESHOLD = 1024;
+
+    /* brief Two-phase parallel build of the adjacency lists of a MiniGraph
+     * par_layout sizes the lists in parallel (reserve(i) = upper bound of the i-th list, 0 if it is not stored),
+     * lays them out in pos with a prefix sum and reserves ctn; par_fill then prunes the lists in parallel
+     * (fill(k) = size of the k-th list it pruned) and returns their total size. Every list is padded to its bound,
+     * so the tasks write disjoint ranges of ctn and all allocations stay in the calling thread.
+     * With _degradable, par_layout returns false instead of reserving lists over MiniGraphPool::BUDGET; the caller
+     * then lays out only the lists it must prune.
+     * */
+    template<typename ReserveFn>
+    bool par_layout(size_t num_vertex, ManagedContainer &pos, ManagedContainer &ctn, ReserveFn reserve,
+                    bool _degradable = false) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertex), [&](const tbb::blocked_range<size_t> &r) {
+            for (size_t i = r.begin(); i < r.end(); i++) pos[i + 1] = reserve(i);
+        });
+        pos[0] = 0;
+        for (size_t i = 0; i < num_vertex; i++) pos[i + 1] += pos[i];
+        if (_degradable && !ctn.Admit(pos[num_vertex])) return false;
+        if (ctn.capacity() < pos[num_vertex]) ctn.Reserve(pos[num_vertex]);
+        return true;
+    }
+
+    template<typename FillFn>
+    size_t par_fill(size_t num_lists, FillFn fill) {
+        return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, num_lists), size_t{0},
+                                    [&](const tbb::blocked_range<size_t> &r, size_t edges) {
+                                        for (size_t k = r.begin(); k < r.end(); k++) edges += fill(k);
+                                        return edges;
+                                    }, std::plus<>());
+    }
+
+    template<bool Bounded, typename Parent = void>
     class MiniGraphEager : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -289,22 +477,39 @@ namespace minigraph {
         ManagedContainer m_ctn;
         ManagedContainer m_pos;
         ManagedContainer m_degree;
-        ManagedContainer m_indices;
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
         const bool m_par{false};
+        bool m_degraded{false};
         size_t num_edges{0};
-        MiniGraphIF *m_mg{nullptr};
+        Parent *m_mg{nullptr};
 
-    public:
-        MiniGraphEager() = default;
+        // over MiniGraphPool::BUDGET: the i-th list is read unpruned, as the lists the other MiniGraphs do not prune
+        void skip(size_t i) {
+            m_degree[i] = NOT_PRUNE;
+            m_pos[i + 1] = m_pos[i];
+            mark_degraded(m_degraded);
+        }
 
-        ~MiniGraphEager() override = default;
+        // lay out the lists in parallel; over the budget, only the lists of _iter (read directly by the plan)
+        void par_layout_lists(const VertexSet &_iter) {
+            auto bound = [this](size_t i) -> size_t {
+                return m_degree[i] == static_cast<IdType>(NOT_PRUNE) ? 0
+                                                                      : max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+            };
+            std::fill(m_degree.begin(), m_degree.end(), 0);
+            if (par_layout(m_vertex.size(), m_pos, m_ctn, bound, true)) return;
+            std::fill(m_degree.begin(), m_degree.end(), static_cast<IdType>(NOT_PRUNE));
+            for (IdType v_idx: get_indices(m_vertex, _iter)) m_degree[v_idx] = 0;
+            mark_degraded(m_degraded);
+            par_layout(m_vertex.size(), m_pos, m_ctn, bound);
+        }
 
-        MiniGraphEager(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
+    public:
+        explicit MiniGraphEager(bool _par = false) : m_par{_par} {};
 
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
             if (m_pos.capacity() <= m_vertex.size()) {
@@ -314,24 +519,45 @@ namespace minigraph {
             m_pos.set_size(m_vertex.size() + 1);
             m_degree.set_size(m_vertex.size());
             num_edges = 0;
+            m_degraded = false;
             m_pos[0] = num_edges;
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                par_layout_lists(_iter);
+                num_edges = par_fill(m_vertex.size(), [this](size_t i) -> size_t {
+                    if (m_degree[i] == static_cast<IdType>(NOT_PRUNE)) return 0;
+                    IdType v_id = m_vertex[i];
+                    IdType *start = m_ctn.begin() + m_pos[i];
+                    m_degree[i] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                          : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[i];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, m_vertex.size());
             for (uint64_t i = 0; i < m_vertex.size(); ++i) {
-                size_t buffer_required = m_intersect.size() + m_pos[i];
-                if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 IdType v_id = m_vertex[i];
+                size_t buffer_required = m_intersect.size() + m_pos[i];
+                if (m_ctn.capacity() < buffer_required) {
+                    if (!m_ctn.Admit(buffer_required) && !contains(_iter, v_id)) {
+                        skip(i);
+                        continue;
+                    }
+                    m_ctn.Resize(buffer_required);
+                }
                 IdType *start = m_ctn.begin() + m_pos[i];
-                size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                          : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                size_t degree = Bounded ? probe.intersect(DATA_GRAPH->NBound(v_id), start)
+                                          : probe.intersect(DATA_GRAPH->N(v_id), start);
                 m_degree[i] = degree;
                 m_pos[i + 1] = m_pos[i] + degree;
                 num_edges += degree;
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
 
             #ifdef DISABLE_REUSE
                     return build(_vertex, _intersect, _iter);
@@ -347,35 +573,173 @@ namespace minigraph {
             m_pos.set_size(m_vertex.size() + 1);
             m_degree.set_size(m_vertex.size());
             m_pos[0] = 0;
-            m_indices = m_mg->indices(m_vertex);
+            m_degraded = false;
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                par_layout_lists(_iter);
+                num_edges = par_fill(m_vertex.size(), [this](size_t i) -> size_t {
+                    if (m_degree[i] == static_cast<IdType>(NOT_PRUNE)) return 0;
+                    IdType v_id = m_vertex[i];
+                    IdType *start = m_ctn.begin() + m_pos[i];
+                    m_degree[i] = Bounded ? m_intersect.intersect(m_mg->N(m_mg_indices[i]), v_id, start)
+                                          : m_intersect.intersect(m_mg->N(m_mg_indices[i]), start);
+                    return m_degree[i];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, m_vertex.size());
             for (uint64_t i = 0; i < m_vertex.size(); ++i) {
-                size_t buffer_required = m_intersect.size() + m_pos[i];
-                if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 IdType v_id = m_vertex[i];
-                IdType adj_idx = m_indices[i];
+                size_t buffer_required = m_intersect.size() + m_pos[i];
+                if (m_ctn.capacity() < buffer_required) {
+                    if (!m_ctn.Admit(buffer_required) && !contains(_iter, v_id)) {
+                        skip(i);
+                        continue;
+                    }
+                    m_ctn.Resize(buffer_required);
+                }
+                IdType adj_idx = m_mg_indices[i];
                 IdType *start = m_ctn.begin() + m_pos[i];
-                size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                          : m_intersect.intersect(m_mg->N(adj_idx), start);
+                size_t degree = Bounded ? probe.intersect(m_mg->N(adj_idx), v_id, start)
+                                          : probe.intersect(m_mg->N(adj_idx), start);
                 m_degree[i] = degree;
                 m_pos[i + 1] = m_pos[i] + degree;
             }
         }
 
-        VertexSet N(IdType i) override {
+        VertexSet N(IdType i) {
+            if (m_degree[i] == static_cast<IdType>(NOT_PRUNE)) {
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
+                }
+                return DATA_GRAPH->N(m_vertex[i]);
+            }
             return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
         }
 
-        IdType Degree(IdType i) const override {
+        IdType Degree(IdType i) const {
             return m_degree[i];
         }
+
+        // some lists are read unpruned because the last build exceeded MiniGraphPool::BUDGET
+        bool degraded() const { return m_degraded; }
+    };
+
+    // MiniGraphBitset only stores bitsets if its intersect set has at most this many vertices
+    constexpr size_t BITSET_MAX_LOCAL = 8192;
+
+    /* brief Eager MiniGraph that also stores its adjacency lists as bitsets over the local index space of the
+     * intersect set: bit k of row i is set iff m_intersect[k] is a neighbor of the i-th vertex. Counting the
+     * intersection (or difference) of two lists of the same MiniGraph is then a word-wise AND (ANDN) and popcount
+     * over |intersect| / 32 words instead of a merge. Lists restricted by a vertex id are prefixes of the local
+     * index space (see local_bound). The rows are only built if |intersect| <= BITSET_MAX_LOCAL; otherwise
+     * has_bits() is false and the generated code uses the VertexSet kernels on N().
+     * */
+    template<bool Bounded, typename Parent = void>
+    class MiniGraphBitset : public MiniGraphIF {
+    private:
+        MiniGraphEager<Bounded, Parent> m_lists;
+        VertexSet m_intersect;
+        ManagedContainer m_bits;
+        size_t m_words{0}; // words per row
+        bool m_has_bits{false};
+        const bool m_par{false};
+
+        void build_row(IdType i) {
+            IdType *row = m_bits.begin() + i * m_words;
+            std::fill(row, row + m_words, 0);
+            const IdType *itr = m_intersect.begin();
+            for (IdType v_id: m_lists.N(i)) {
+                itr = binary_search(itr, m_intersect.end(), v_id);
+                size_t k = itr - m_intersect.begin();
+                row[k / 32] |= 1u << (k % 32);
+            }
+        }
+
+        void build_bits(size_t num_vertex) {
+            // rows of unpruned lists cannot be mapped to the local index space
+            m_has_bits = !m_lists.degraded() && m_intersect.size() <= BITSET_MAX_LOCAL;
+            if (!m_has_bits) return;
+            m_words = (m_intersect.size() + 31) / 32;
+            if (!m_bits.Admit(m_words * num_vertex)) {
+                MiniGraphPool::DEGRADED_BUILDS++;
+                m_has_bits = false;
+                return;
+            }
+            if (m_bits.capacity() < m_words * num_vertex) m_bits.Reserve(m_words * num_vertex);
+            if (m_par && num_vertex >= PAR_BUILD_THRESHOLD) {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertex), [this](const tbb::blocked_range<size_t> &r) {
+                    for (size_t i = r.begin(); i < r.end(); i++) build_row(i);
+                });
+            } else {
+                for (size_t i = 0; i < num_vertex; i++) build_row(i);
+            }
+        }
+
+    public:
+        explicit MiniGraphBitset(bool _par = false) : m_lists{_par}, m_par{_par} {};
+
+        void build(const VertexSet &_vertex,
+                   const VertexSet &_intersect,
+                   const VertexSet &_iter) {
+            m_lists.build(_vertex, _intersect, _iter);
+            m_intersect = _intersect;
+            build_bits(_vertex.size());
+        }
+
+        void build(Parent *mg,
+                   const VertexSet &_vertex,
+                   const VertexSet &_intersect,
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
+            m_lists.build(mg, _vertex, _intersect, _iter, _mg_indices);
+            m_intersect = _intersect;
+            build_bits(_vertex.size());
+        }
+
+        VertexSet N(IdType i) { return m_lists.N(i); }
+
+        ManagedContainer indices(const VertexSet &_to_iter) const { return m_lists.indices(_to_iter); }
+
+        IdType Degree(IdType i) const { return m_lists.Degree(i); }
+
+        bool has_bits() const { return m_has_bits; }
+
+        // number of intersect vertices smaller than v_id: the local bound of the lists restricted by v_id
+        size_t local_bound(IdType v_id) const {
+            return binary_search(m_intersect.begin(), m_intersect.end(), v_id) - m_intersect.begin();
+        }
+
+        size_t local_size() const { return m_intersect.size(); }
+
+        // |N(a) & N(b)| over the local indices below limit
+        size_t intersect_cnt(IdType a, IdType b, size_t limit) const {
+            const IdType *row_a = m_bits.begin() + a * m_words;
+            const IdType *row_b = m_bits.begin() + b * m_words;
+            size_t full = limit / 32, cnt = 0;
+            for (size_t w = 0; w < full; w++) cnt += __builtin_popcount(row_a[w] & row_b[w]);
+            if (limit % 32) cnt += __builtin_popcount(row_a[full] & row_b[full] & ((1u << (limit % 32)) - 1));
+            return cnt;
+        }
+
+        // |N(a) - N(b)| over the local indices below limit
+        size_t subtract_cnt(IdType a, IdType b, size_t limit) const {
+            const IdType *row_a = m_bits.begin() + a * m_words;
+            const IdType *row_b = m_bits.begin() + b * m_words;
+            size_t full = limit / 32, cnt = 0;
+            for (size_t w = 0; w < full; w++) cnt += __builtin_popcount(row_a[w] & ~row_b[w]);
+            if (limit % 32) cnt += __builtin_popcount(row_a[full] & ~row_b[full] & ((1u << (limit % 32)) - 1));
+            return cnt;
+        }
     };
 
+    template<bool Bounded, typename Parent = void>
     class MiniGraphLazy : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -384,22 +748,17 @@ namespace minigraph {
         ManagedContainer m_pos;
         ManagedContainer m_degree;
         ManagedContainer m_indices;
-        ManagedContainer m_mg_indices;
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
         const bool m_par{false};
         size_t num_edges{0};
-        MiniGraphIF *m_mg{nullptr};
+        Parent *m_mg{nullptr};
 
     public:
-        MiniGraphLazy() = default;
-
-        MiniGraphLazy(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
-
-        ~MiniGraphLazy() override = default;
+        explicit MiniGraphLazy(bool _par = false) : m_par{_par} {};
 
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
 
@@ -416,23 +775,41 @@ namespace minigraph {
             for (auto &x: m_degree) {
                 x = INVALID_ID;
             }
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists pruned now
+                for (IdType v_idx: m_indices) m_degree[v_idx] = 0;
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) {
+                    return m_degree[i] == INVALID_ID ? 0 : max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                              : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, m_indices.size());
             for (auto v_idx: m_indices) {
                 m_pos[v_idx] = num_edges;
                 size_t buffer_required = m_intersect.size() + num_edges;
                 if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 IdType v_id = m_vertex[v_idx];
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                          : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                size_t degree = Bounded ? probe.intersect(DATA_GRAPH->NBound(v_id), start)
+                                          : probe.intersect(DATA_GRAPH->N(v_id), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
             m_mg = mg;
             m_vertex = _vertex;
             m_intersect = _intersect;
@@ -448,9 +825,27 @@ namespace minigraph {
                 x = INVALID_ID;
             }
             m_indices = get_indices(m_vertex, _iter);
-            m_mg_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
             assert(m_indices.size() == _iter.size());
             assert(m_mg_indices.size() == m_vertex.size());
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists pruned now
+                for (IdType v_idx: m_indices) m_degree[v_idx] = 0;
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) {
+                    return m_degree[i] == INVALID_ID ? 0 : max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    IdType adj_idx = m_mg_indices[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                              : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, m_indices.size());
             for (IdType v_idx: m_indices) {
                 IdType v_id = m_vertex[v_idx];
                 IdType adj_idx = m_mg_indices[v_idx];
@@ -458,27 +853,29 @@ namespace minigraph {
                 if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 m_pos[v_idx] = num_edges;
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                          : m_intersect.intersect(m_mg->N(adj_idx), start);
+                size_t degree = Bounded ? probe.intersect(m_mg->N(adj_idx), v_id, start)
+                                          : probe.intersect(m_mg->N(adj_idx), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        VertexSet N(IdType i) override {
+        VertexSet N(IdType i) {
             if (m_degree[i] == INVALID_ID) {
-                if (m_mg) return m_mg->N(m_mg_indices[i]);
-                else return DATA_GRAPH->N(m_vertex[i]);
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
+                }
+                return DATA_GRAPH->N(m_vertex[i]);
             } else {
                 return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
             }
         }
 
-        IdType Degree(IdType i) const override {
+        IdType Degree(IdType i) const {
             return m_degree[i];
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
@@ -486,6 +883,7 @@ namespace minigraph {
     };
 
 
+    template<bool Bounded, typename Parent = void>
     class MiniGraphOnline : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -494,19 +892,36 @@ namespace minigraph {
         ManagedContainer m_pos;
         ManagedContainer m_degree;
         ManagedContainer m_indices;
-        ManagedContainer m_mg_indices;
-        MiniGraphIF *m_mg{nullptr};
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
+        Parent *m_mg{nullptr};
         const bool m_par{false};
         size_t num_edges{0};
         size_t est_edges{0};
+
+        // reserve the ranges laid out in m_pos; over MiniGraphPool::BUDGET, only those of the lists pruned now
+        void reserve_lists() {
+            est_edges = m_pos[m_vertex.size()];
+            if (m_ctn.Admit(est_edges)) {
+                if (m_ctn.capacity() < est_edges) m_ctn.Reserve(est_edges);
+                return;
+            }
+            for (size_t i = 0; i < m_vertex.size(); i++) m_degree[i] = NOT_PRUNE;
+            for (IdType v_idx: m_indices) m_degree[v_idx] = INVALID_ID;
+            size_t offset = 0;
+            for (size_t i = 0; i < m_vertex.size(); i++) {
+                size_t reserved = m_pos[i + 1] - m_pos[i];
+                m_pos[i] = offset;
+                if (m_degree[i] != static_cast<IdType>(NOT_PRUNE)) offset += reserved;
+            }
+            m_pos[m_vertex.size()] = est_edges = offset;
+            MiniGraphPool::DEGRADED_BUILDS++;
+            if (m_ctn.capacity() < est_edges) m_ctn.Reserve(est_edges);
+        }
     public:
-        MiniGraphOnline() = default;
-        MiniGraphOnline(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
-        ~MiniGraphOnline() override = default;
+        explicit MiniGraphOnline(bool _par = false) : m_par{_par} {};
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
             if (m_pos.capacity() <= m_vertex.size()) {
@@ -523,25 +938,37 @@ namespace minigraph {
             m_indices = get_indices(m_vertex, _iter);
             for (size_t i = 0; i < m_vertex.size(); i++) {
                 IdType v_id = m_vertex[i];
-                m_pos[i + 1] = m_bounded ? m_pos[i] + std::min(DATA_GRAPH->Offset(v_id), m_intersect.size())
+                m_pos[i + 1] = Bounded ? m_pos[i] + std::min(DATA_GRAPH->Offset(v_id), m_intersect.size())
                                          : m_pos[i] + std::min(DATA_GRAPH->Degree(v_id), m_intersect.size());
             }
-            est_edges = m_pos[m_vertex.size()];
-            if (m_ctn.capacity() < est_edges) m_ctn.Reserve(est_edges);
+            reserve_lists();
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                              : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, m_indices.size());
             for (auto v_idx: m_indices) {
                 IdType v_id = m_vertex[v_idx];
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                          : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                size_t degree = Bounded ? probe.intersect(DATA_GRAPH->NBound(v_id), start)
+                                          : probe.intersect(DATA_GRAPH->N(v_id), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
             m_mg = mg;
             m_vertex = _vertex;
             m_intersect = _intersect;
@@ -559,7 +986,7 @@ namespace minigraph {
             }
 
             m_indices = get_indices(m_vertex, _iter);
-            m_mg_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
             assert(m_vertex.size() == m_mg_indices.size());
             assert(m_indices.size() <= _iter.size());
             m_pos[0] = 0;
@@ -567,48 +994,75 @@ namespace minigraph {
                 IdType adj_idx = m_mg_indices[i];
                 m_pos[i + 1] = m_pos[i] + std::min((IdType) m_intersect.size(), m_mg->Degree(adj_idx));
             }
-            est_edges = m_pos[m_vertex.size()];
-            if (m_ctn.capacity() < est_edges) m_ctn.Reserve(est_edges);
+            reserve_lists();
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    IdType adj_idx = m_mg_indices[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                              : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, m_indices.size());
             for (IdType v_idx: m_indices) {
                 IdType adj_idx = m_mg_indices[v_idx];
                 IdType v_id = m_vertex[v_idx];
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                          : m_intersect.intersect(m_mg->N(adj_idx), start);
+                size_t degree = Bounded ? probe.intersect(m_mg->N(adj_idx), v_id, start)
+                                          : probe.intersect(m_mg->N(adj_idx), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        VertexSet N(IdType i) override {
-            if (m_degree[i] == INVALID_ID) {
-                IdType v_id = m_vertex[i];
-                if (m_mg != nullptr) {
-                    IdType adj_idx = m_mg_indices[i];
-                    IdType *start = m_ctn.begin() + m_pos[i];
-                    size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                                : m_intersect.intersect(m_mg->N(adj_idx), start);
-                    m_degree[i] = degree;
-                } else {
-                    IdType *start = m_ctn.begin() + m_pos[i];
-                    size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                                : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
-                    m_degree[i] = degree;
+        VertexSet N(IdType i) {
+            IdType degree = load_degree(m_degree[i]);
+            if (degree == INVALID_ID && claim_degree(m_degree[i], INVALID_ID)) {
+                IdType *start = m_ctn.begin() + m_pos[i];
+                degree = prune(i, start);
+                publish_degree(m_degree[i], degree);
+                return VertexSet(m_vertex[i], start, degree);
+            }
+            if (degree == INVALID_ID || degree == static_cast<IdType>(BUILDING) || degree == static_cast<IdType>(NOT_PRUNE)) {
+                // being pruned by another task, or over MiniGraphPool::BUDGET
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
                 }
+                return DATA_GRAPH->N(m_vertex[i]);
             }
-            return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
+            return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], degree);
         }
 
-        IdType Degree(IdType i) const override {
-            return m_degree[i];
+        IdType Degree(IdType i) const {
+            return load_degree(m_degree[i]);
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
         }
+
+    private:
+        // prune the i-th list into its reserved range
+        IdType prune(IdType i, IdType *start) {
+            IdType v_id = m_vertex[i];
+            if constexpr (!std::is_void_v<Parent>) {
+                if (m_mg != nullptr) {
+                    IdType adj_idx = m_mg_indices[i];
+                    return Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                   : m_intersect.intersect(m_mg->N(adj_idx), start);
+                }
+            }
+            return Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+        }
     };
+    template<bool Bounded, typename Parent = void>
     class MiniGraphCostModel : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -617,42 +1071,74 @@ namespace minigraph {
         ManagedContainer m_pos;
         ManagedContainer m_degree;
         // ManagedContainer m_indices;
-        ManagedContainer m_mg_indices;
-        MiniGraphIF *m_mg{nullptr};
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
+        Parent *m_mg{nullptr};
         const bool m_par{false};
         size_t num_edges{0};
         size_t est_edges{0};
         size_t two_htop{0};
         // size_t threshold{0};
         double reuse_multiplier{-1};
+        bool m_degraded{false};
         // estimated number of times the pruned adj will be used
         // if less than 0 prune all
 
         bool should_prune(size_t idx) const {
             uint64_t degree = DATA_GRAPH->Degree(m_vertex[idx]);
-            const static int large_degree_threshold = DATA_GRAPH->num_edge / DATA_GRAPH->num_vertex * 4;
-            if (degree >= large_degree_threshold) return true;
+            if (degree >= COST.large_degree_factor * DATA_GRAPH->num_edge / DATA_GRAPH->num_vertex) return true;
             auto intersect_size = m_intersect.size();
-            double gain = reuse_multiplier / m_vertex.size() * (degree - intersect_size * degree / DATA_GRAPH->num_vertex) - intersect_size - degree;
+            double gain = reuse_multiplier / m_vertex.size() * COST.scan_ns * (degree - intersect_size * degree / DATA_GRAPH->num_vertex)
+                          - COST.build_ns * (intersect_size + degree);
         //    if (gain < 0 && degree > 10000) {
         //        printf("Vertex Degree=%d | Reuse Factor=%f | Vertex Size=%d | Intersect Size=%d | Gain=%f\n ", degree, reuse_multiplier, m_vertex.size(), intersect_size, gain);
         //    }
             return gain > 0;
         }
 
-    public:
-        MiniGraphCostModel() = default;
+        // reserve the range of the i-th list, pruned on first use; over MiniGraphPool::BUDGET it is read unpruned
+        void reserve_list(size_t i) {
+            size_t est_intersect_size = std::min(m_intersect.size(), DATA_GRAPH->Degree(m_vertex[i]));
+            size_t buffer_required = est_intersect_size + m_pos[i];
+            if (m_ctn.capacity() < buffer_required) {
+                if (!m_ctn.Admit(buffer_required)) {
+                    m_degree[i] = NOT_PRUNE;
+                    m_pos[i + 1] = m_pos[i];
+                    mark_degraded(m_degraded);
+                    return;
+                }
+                m_ctn.Resize(buffer_required);
+            }
+            m_pos[i + 1] = m_pos[i] + est_intersect_size;
+            m_degree[i] = WILL_PRUNE;
+        }
 
-        MiniGraphCostModel(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
+        // lay out the lists in parallel; over the budget, only the lists of _iter (m_degree = 0) are kept
+        void par_layout_lists() {
+            bool degraded = false;
+            auto bound = [this, &degraded](size_t i) -> size_t {
+                if (m_degree[i] != 0) {
+                    if (degraded || !should_prune(i)) return 0;
+                    m_degree[i] = WILL_PRUNE;
+                }
+                return max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+            };
+            if (par_layout(m_vertex.size(), m_pos, m_ctn, bound, true)) return;
+            degraded = true;
+            for (size_t i = 0; i < m_vertex.size(); i++) {
+                if (m_degree[i] != 0) m_degree[i] = NOT_PRUNE;
+            }
+            mark_degraded(m_degraded);
+            par_layout(m_vertex.size(), m_pos, m_ctn, bound);
+        }
 
-        ~MiniGraphCostModel() override = default;
+    public:
+        explicit MiniGraphCostModel(bool _par = false) : m_par{_par} {};
 
         void set_reuse_multiplier(double _reuse) { reuse_multiplier = _reuse; };
 
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
             // threshold = DATA_GRAPH->get_enum() / DATA_GRAPH->get_vnum();
@@ -663,40 +1149,55 @@ namespace minigraph {
             m_pos.set_size(m_vertex.size() + 1);
             m_degree.set_size(m_vertex.size());
             num_edges = two_htop = 0;
+            m_degraded = false;
             m_pos[0] = 0;
 
             // for (auto v_id : m_vertex) {
             //     two_htop += DATA_GRAPH->Degree(v_id);
             // }
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists of _iter, which are pruned now
+                ManagedContainer iter_indices = get_indices(m_vertex, _iter);
+                for (size_t i = 0; i < m_vertex.size(); i++) m_degree[i] = NOT_PRUNE;
+                for (IdType v_idx: iter_indices) m_degree[v_idx] = 0;
+                par_layout_lists();
+                num_edges = par_fill(iter_indices.size(), [this, &iter_indices](size_t k) {
+                    IdType v_idx = iter_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                              : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, _iter.size());
             if (_iter.begin() == m_vertex.begin()) {
-                for (uint64_t i = 0; i < _iter.size(); ++i) {
+                // a prefix of the vertices, which _iter may extend past
+                const size_t num_iter = std::min(_iter.size(), m_vertex.size());
+                for (uint64_t i = 0; i < num_iter; ++i) {
                     size_t buffer_required = m_intersect.size() + m_pos[i];
                     if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                     IdType v_id = m_vertex[i];
                     IdType *start = m_ctn.begin() + m_pos[i];
-                    size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                            : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    size_t degree = Bounded ? probe.intersect(DATA_GRAPH->NBound(v_id), start)
+                                            : probe.intersect(DATA_GRAPH->N(v_id), start);
                     m_degree[i] = degree;
                     m_pos[i + 1] = m_pos[i] + degree;
                     num_edges += degree;
                 }
-                for (uint64_t i = _iter.size(); i < m_vertex.size(); i++) {
+                for (uint64_t i = num_iter; i < m_vertex.size(); i++) {
                     if (should_prune(i)) {
                         // size_t buffer_required = m_intersect.size() + m_pos[i];
                         // if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         // IdType v_id = m_vertex[i];
                         // IdType *start = m_ctn.begin() + m_pos[i];
-                        // size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                        // size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                         //                         : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                         // m_degree[i] = degree;
                         // m_pos[i + 1] = m_pos[i] + degree;
                         // num_edges += degree;
-                        IdType v_id = m_vertex[i];
-                        size_t est_intersect_size = std::min(m_intersect.size(), DATA_GRAPH->Degree(v_id));
-                        size_t buffer_required = est_intersect_size + m_pos[i];
-                        if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
-                        m_pos[i+1] = m_pos[i] + est_intersect_size;
-                        m_degree[i] = WILL_PRUNE;
+                        reserve_list(i);
                     } else {
                         m_degree[i] = NOT_PRUNE;
                         m_pos[i + 1] = m_pos[i];
@@ -712,18 +1213,13 @@ namespace minigraph {
                         size_t buffer_required = m_intersect.size() + m_pos[i];
                         if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         IdType *start = m_ctn.begin() + m_pos[i];
-                        size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                                : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                        size_t degree = Bounded ? probe.intersect(DATA_GRAPH->NBound(v_id), start)
+                                                : probe.intersect(DATA_GRAPH->N(v_id), start);
                         m_degree[i] = degree;
                         m_pos[i + 1] = m_pos[i] + degree;
                         num_edges += degree;
                     } else if (should_prune(i)) {
-                        IdType v_id = m_vertex[i];
-                        size_t est_intersect_size = std::min(m_intersect.size(), DATA_GRAPH->Degree(v_id));
-                        size_t buffer_required = est_intersect_size + m_pos[i];
-                        if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
-                        m_pos[i+1] = m_pos[i] + est_intersect_size;
-                        m_degree[i] = WILL_PRUNE;
+                        reserve_list(i);
                     } else {
                         m_degree[i] = NOT_PRUNE;
                         m_pos[i + 1] = m_pos[i];
@@ -732,10 +1228,11 @@ namespace minigraph {
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
 
                     #ifdef DISABLE_REUSE
                         return build(_vertex, _intersect, _iter);
@@ -751,6 +1248,7 @@ namespace minigraph {
             m_pos.set_size(m_vertex.size() + 1);
             m_degree.set_size(m_vertex.size());
             num_edges = two_htop = 0;
+            m_degraded = false;
             m_pos[0] = 0;
 
             // for (auto v_id : m_vertex) {
@@ -758,42 +1256,57 @@ namespace minigraph {
             // }
 
             // m_indices = get_indices(m_vertex, _iter);
-            m_mg_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
             assert(m_vertex.size() == m_mg_indices.size());
 //            assert(m_indices.size() <= _iter.size());
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists of _iter, which are pruned now
+                ManagedContainer iter_indices = get_indices(m_vertex, _iter);
+                for (size_t i = 0; i < m_vertex.size(); i++) m_degree[i] = NOT_PRUNE;
+                for (IdType v_idx: iter_indices) m_degree[v_idx] = 0;
+                par_layout_lists();
+                num_edges = par_fill(iter_indices.size(), [this, &iter_indices](size_t k) {
+                    IdType v_idx = iter_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    IdType adj_idx = m_mg_indices[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                              : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
+            IntersectProbe probe(m_intersect, _iter.size());
             if (_iter.begin() == m_vertex.begin()) {
-                for (uint64_t i = 0; i < _iter.size(); ++i) {
+                // a prefix of the vertices, which _iter may extend past
+                const size_t num_iter = std::min(_iter.size(), m_vertex.size());
+                for (uint64_t i = 0; i < num_iter; ++i) {
                     size_t buffer_required = m_intersect.size() + m_pos[i];
                     if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                     IdType v_id = m_vertex[i];
                     IdType adj_idx = m_mg_indices[i];
                     IdType *start = m_ctn.begin() + m_pos[i];
 
-                    size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                            : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    size_t degree = Bounded ? probe.intersect(m_mg->N(adj_idx), v_id, start)
+                                            : probe.intersect(m_mg->N(adj_idx), start);
 
                     m_degree[i] = degree;
                     m_pos[i + 1] = m_pos[i] + degree;
                     num_edges += degree;
                 }
-                for (uint64_t i = _iter.size(); i < m_vertex.size(); i++) {
+                for (uint64_t i = num_iter; i < m_vertex.size(); i++) {
                     if (should_prune(i)) {
                         // size_t buffer_required = m_intersect.size() + m_pos[i];
                         // if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         // IdType v_id = m_vertex[i];
                         // IdType *start = m_ctn.begin() + m_pos[i];
                         // IdType adj_idx = m_mg_indices[i];
-                        // size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                        // size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                         //                         : m_intersect.intersect(m_mg->N(adj_idx), start);
                         // m_degree[i] = degree;
                         // m_pos[i + 1] = m_pos[i] + degree;
                         // num_edges += degree;
-                        IdType v_id = m_vertex[i];
-                        size_t est_intersect_size = std::min(m_intersect.size(), DATA_GRAPH->Degree(v_id));
-                        size_t buffer_required = est_intersect_size + m_pos[i];
-                        if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
-                        m_pos[i+1] = m_pos[i] + est_intersect_size;
-                        m_degree[i] = WILL_PRUNE;
+                        reserve_list(i);
                     } else {
                         m_degree[i] = NOT_PRUNE;
                         m_pos[i + 1] = m_pos[i];
@@ -809,17 +1322,13 @@ namespace minigraph {
                         if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         IdType *start = m_ctn.begin() + m_pos[i];
                         IdType adj_idx = m_mg_indices[i];
-                        size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                                : m_intersect.intersect(m_mg->N(adj_idx), start);
+                        size_t degree = Bounded ? probe.intersect(m_mg->N(adj_idx), v_id, start)
+                                                : probe.intersect(m_mg->N(adj_idx), start);
                         m_degree[i] = degree;
                         m_pos[i + 1] = m_pos[i] + degree;
                         num_edges += degree;
                     } else if (should_prune(i)) {
-                        size_t est_intersect_size = std::min(m_intersect.size(), DATA_GRAPH->Degree(v_id));
-                        size_t buffer_required = est_intersect_size + m_pos[i];
-                        if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
-                        m_pos[i+1] = m_pos[i] + est_intersect_size;
-                        m_degree[i] = WILL_PRUNE;
+                        reserve_list(i);
                     }
                     else {
                         m_degree[i] = NOT_PRUNE;
@@ -829,43 +1338,49 @@ namespace minigraph {
             }
         }
 
-        VertexSet N(IdType i) override {
-            if (m_degree[i] == NOT_PRUNE) {
-                if (m_mg) {
-                    return m_mg->N(m_mg_indices[i]);
-                }
-                else {
-                    return DATA_GRAPH->N(m_vertex[i]);
-                }
-            } else if (m_degree[i] == WILL_PRUNE) {
-                IdType v_id = m_vertex[i];
+        VertexSet N(IdType i) {
+            IdType degree = load_degree(m_degree[i]);
+            if (degree == static_cast<IdType>(WILL_PRUNE) && claim_degree(m_degree[i], static_cast<IdType>(WILL_PRUNE))) {
                 IdType *start = m_ctn.begin() + m_pos[i];
-                size_t degree{0};
-                if (m_mg) {
-                    IdType adj_idx = m_mg_indices[i];
-                    degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                            : m_intersect.intersect(m_mg->N(adj_idx), start);
-                    m_degree[i] = degree;
-                } else {
-                    degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                            : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
-                    m_degree[i] = degree;
+                degree = prune(i, start);
+                publish_degree(m_degree[i], degree);
+                return VertexSet(m_vertex[i], start, degree);
+            }
+            if (degree == static_cast<IdType>(NOT_PRUNE) || degree == static_cast<IdType>(WILL_PRUNE)
+                || degree == static_cast<IdType>(BUILDING)) {
+                // not worth pruning, or being pruned by another task
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
                 }
-                return VertexSet(v_id, start, degree);
-            } else {
-                return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
+                return DATA_GRAPH->N(m_vertex[i]);
             }
+            return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], degree);
         }
 
-        IdType Degree(IdType i) const override {
-            return m_degree[i];
+        IdType Degree(IdType i) const {
+            return load_degree(m_degree[i]);
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
         }
+
+    private:
+        // prune the i-th list into its reserved range
+        IdType prune(IdType i, IdType *start) {
+            IdType v_id = m_vertex[i];
+            if constexpr (!std::is_void_v<Parent>) {
+                if (m_mg != nullptr) {
+                    IdType adj_idx = m_mg_indices[i];
+                    return Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                   : m_intersect.intersect(m_mg->N(adj_idx), start);
+                }
+            }
+            return Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+        }
     };
 }
 #endif //MINIGRAPH_MINIGRAPH_H
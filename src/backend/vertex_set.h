@@ -22,6 +22,9 @@ namespace minigraph {
         uint64_t m_size{0};
         bool m_pooled{false};
 
+        template<bool Store, size_t K>
+        inline size_t subtract_union(const VertexSet *const (&others)[K], IdType upper, IdType *buffer) const;
+
         class VertexSetPool {
         private:
             
@@ -137,6 +140,11 @@ namespace minigraph {
         inline VertexSet subtract(const VertexSet &other) const;
         inline size_t subtract_cnt(const VertexSet &other, IdType upper) const;
         inline size_t subtract_cnt(const VertexSet &other) const;
+        // the vertices below upper that are in none of the others (nor one of their vids), in one pass over this set
+        template<typename... Sets>
+        inline VertexSet subtract_union(IdType upper, const Sets &... others) const;
+        template<typename... Sets>
+        inline size_t subtract_union_cnt(IdType upper, const Sets &... others) const;
         inline VertexSet bounded(IdType upper) const;
         inline size_t bounded_cnt(IdType upper) const;
         inline VertexSet remove(IdType id) const;
@@ -291,6 +299,42 @@ namespace minigraph {
         return out_size;
     };
 
+    template<bool Store, size_t K>
+    size_t VertexSet::subtract_union(const VertexSet *const (&others)[K], IdType upper, IdType *buffer) const {
+        size_t idx_r[K] = {};
+        size_t out_size = 0;
+        for (size_t idx_l = 0; idx_l < size(); idx_l++) {
+            const IdType left = m_data[idx_l];
+            if (left >= upper) break;
+            bool keep = true;
+            // the cursors of the others only move forward, so skipping them after a match loses nothing
+            for (size_t k = 0; k < K && keep; k++) {
+                const VertexSet &other = *others[k];
+                while (idx_r[k] < other.size() && other.m_data[idx_r[k]] < left) idx_r[k]++;
+                keep = left != other.m_vid && (idx_r[k] == other.size() || other.m_data[idx_r[k]] != left);
+            }
+            if (keep) {
+                if constexpr (Store) buffer[out_size] = left;
+                out_size++;
+            }
+        }
+        return out_size;
+    }
+
+    template<typename... Sets>
+    VertexSet VertexSet::subtract_union(IdType upper, const Sets &... others) const {
+        const VertexSet *sets[] = {&others...};
+        VertexSet out(size());
+        out.m_size = subtract_union<true>(sets, upper, out.m_data);
+        return out;
+    }
+
+    template<typename... Sets>
+    size_t VertexSet::subtract_union_cnt(IdType upper, const Sets &... others) const {
+        const VertexSet *sets[] = {&others...};
+        return subtract_union<false>(sets, upper, nullptr);
+    }
+
     VertexSet VertexSet::bounded(IdType upper) const {
         size_t idx_l = 0;
         if (size() > 64) {
@@ -398,5 +442,150 @@ namespace minigraph {
         return out;
     }
 
+    /* brief A VertexSet without the vertices >= an upper bound and without a few excluded vertices
+     * EdgeInduced plans drop the matched vertices from candidate sets. remove() copies the whole set to drop one
+     * vertex; the view records it instead and the kernels skip it while merging. Like a VertexSet copy, the view
+     * points into the set it is taken from and must not outlive it.
+     * */
+    class VertexSetView {
+    public:
+        static constexpr int MAX_EXCLUDED = 16; // at least the number of matched vertices of a pattern
+    private:
+        VertexSet m_set; // the prefix below the upper bound
+        IdType m_excluded[MAX_EXCLUDED]; // ascending; each one is in m_set
+        int m_num_excluded{0};
+
+        // number of excluded vertices < upper
+        size_t excluded_below(IdType upper) const {
+            size_t out = 0;
+            while (out < (size_t) m_num_excluded && m_excluded[out] < upper) out++;
+            return out;
+        };
+
+        template<bool Subtract, bool Store>
+        inline size_t merge(const VertexSet &other, IdType upper, IdType *buffer) const;
+    public:
+        explicit VertexSetView(const VertexSet &_set) : m_set{_set} {};
+
+        uint64_t size() const { return m_set.size() - m_num_excluded; };
+        IdType vid() const { return m_set.vid(); };
+
+        inline VertexSetView bounded(IdType upper) const;
+        inline size_t bounded_cnt(IdType upper) const;
+        inline VertexSetView remove(IdType id) const;
+        inline size_t remove_cnt(IdType id) const;
+        inline VertexSet intersect(const VertexSet &other, IdType upper = INVALID_ID) const;
+        inline size_t intersect_cnt(const VertexSet &other, IdType upper = INVALID_ID) const;
+        inline VertexSet subtract(const VertexSet &other, IdType upper = INVALID_ID) const;
+        inline size_t subtract_cnt(const VertexSet &other, IdType upper = INVALID_ID) const;
+        // copy into a pooled set, for sets that are iterated or indexed
+        inline VertexSet materialize() const;
+    };
+
+    template<bool Subtract, bool Store>
+    size_t VertexSetView::merge(const VertexSet &other, IdType upper, IdType *buffer) const {
+        const IdType *data = m_set.begin();
+        const size_t num_excluded = m_num_excluded;
+        size_t idx_l = 0, idx_r = 0, idx_e = 0, out_size = 0;
+        while (idx_l < m_set.size() && idx_r < other.size()) {
+            const IdType left = data[idx_l];
+            const IdType right = other[idx_r];
+            if (left >= upper || right >= upper) break;
+            if (idx_e < num_excluded && left == m_excluded[idx_e]) {
+                idx_l++;
+                idx_e++;
+                continue;
+            }
+            if (left <= right) idx_l++;
+            if (right <= left) idx_r++;
+            if (Subtract ? left < right && left != other.vid() : left == right) {
+                if constexpr (Store) buffer[out_size] = left;
+                out_size++;
+            }
+        }
+        if constexpr (Subtract) {
+            while (idx_l < m_set.size()) {
+                const IdType left = data[idx_l++];
+                if (left >= upper) break;
+                if (idx_e < num_excluded && left == m_excluded[idx_e]) {
+                    idx_e++;
+                    continue;
+                }
+                if (left != other.vid()) {
+                    if constexpr (Store) buffer[out_size] = left;
+                    out_size++;
+                }
+            }
+        }
+        return out_size;
+    }
+
+    VertexSetView VertexSetView::bounded(IdType upper) const {
+        VertexSetView out{*this};
+        out.m_set = m_set.bounded(upper);
+        out.m_num_excluded = excluded_below(upper);
+        return out;
+    }
+
+    size_t VertexSetView::bounded_cnt(IdType upper) const {
+        return m_set.bounded_cnt(upper) - excluded_below(upper);
+    }
+
+    VertexSetView VertexSetView::remove(IdType id) const {
+        VertexSetView out{*this};
+        const size_t pos = m_set.bounded_cnt(id);
+        if (pos == m_set.size() || m_set[pos] != id) return out;
+        size_t idx_e = excluded_below(id);
+        if (idx_e < (size_t) m_num_excluded && m_excluded[idx_e] == id) return out;
+        assert(m_num_excluded < MAX_EXCLUDED);
+        for (size_t i = m_num_excluded; i > idx_e; i--) out.m_excluded[i] = m_excluded[i - 1];
+        out.m_excluded[idx_e] = id;
+        out.m_num_excluded++;
+        return out;
+    }
+
+    size_t VertexSetView::remove_cnt(IdType id) const {
+        const size_t pos = m_set.bounded_cnt(id);
+        if (pos == m_set.size() || m_set[pos] != id) return size();
+        size_t idx_e = excluded_below(id);
+        if (idx_e < (size_t) m_num_excluded && m_excluded[idx_e] == id) return size();
+        return size() - 1;
+    }
+
+    VertexSet VertexSetView::intersect(const VertexSet &other, IdType upper) const {
+        VertexSet out(m_set.size());
+        out.set_size(merge<false, true>(other, upper, out.begin()));
+        return out;
+    }
+
+    size_t VertexSetView::intersect_cnt(const VertexSet &other, IdType upper) const {
+        return merge<false, false>(other, upper, nullptr);
+    }
+
+    VertexSet VertexSetView::subtract(const VertexSet &other, IdType upper) const {
+        VertexSet out(m_set.size());
+        out.set_size(merge<true, true>(other, upper, out.begin()));
+        return out;
+    }
+
+    size_t VertexSetView::subtract_cnt(const VertexSet &other, IdType upper) const {
+        return merge<true, false>(other, upper, nullptr);
+    }
+
+    VertexSet VertexSetView::materialize() const {
+        VertexSet out(m_set.size());
+        IdType *buffer = out.begin();
+        size_t idx_e = 0, out_size = 0;
+        for (size_t i = 0; i < m_set.size(); i++) {
+            if (idx_e < (size_t) m_num_excluded && m_set[i] == m_excluded[idx_e]) {
+                idx_e++;
+                continue;
+            }
+            buffer[out_size++] = m_set[i];
+        }
+        out.set_size(out_size);
+        return out;
+    }
+
 }
 #endif //MINIGRAPH_VERTEX_SET_H
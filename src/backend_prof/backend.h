@@ -31,6 +31,7 @@ namespace minigraph {
         std::vector<cc> per_thread_handled;
         std::vector<double> per_thread_time; // omp
         std::vector<tbb::tick_count> per_thread_tick; // tbb
+        const std::vector<IdType> *roots{nullptr}; // vertices matched to the first pattern vertex; all if null
         Context(int _num_threads): num_threads{_num_threads}{
             tick_begin = tbb::tick_count::now();
             per_thread_tick.resize(num_threads, tick_begin);
@@ -39,6 +40,11 @@ namespace minigraph {
             per_thread_handled.resize(num_threads);
         };
 
+        // number of vertices the first loop iterates over and the i-th of them
+        size_t num_roots(size_t num_vertex) const { return roots == nullptr ? num_vertex : roots->size(); }
+
+        IdType root(size_t i) const { return roots == nullptr ? static_cast<IdType>(i) : (*roots)[i]; }
+
         double tick_time(size_t i) {
             return (per_thread_tick.at(i) - tick_begin).seconds();
         }
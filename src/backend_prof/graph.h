@@ -12,8 +12,13 @@ namespace minigraph {
         uint64_t *m_indptr{nullptr};
         uint64_t *m_offset{nullptr};
         uint64_t *m_triangles{nullptr};
+        // vertex labels (only loaded when num_label > 0)
+        uint32_t *m_labels{nullptr};
+        IdType *m_label_indices{nullptr}; // every adjacency list sorted by (label, id)
+        uint32_t *m_label_offset{nullptr}; // num_vertex x num_label: begin of each label inside the adjacency list
         uint64_t num_vertex{0}, num_edge{0}, num_triangle{0};
         uint64_t max_degree{0}, max_offset{0}, max_triangle{0};
+        uint64_t num_label{0};
         bool m_mmap{false};
 
         Graph() = default;
@@ -21,12 +26,16 @@ namespace minigraph {
         ~Graph() {
             if (!m_mmap) {
                 if (m_indices != nullptr) delete[] m_indices;
+                if (m_label_indices != nullptr) delete[] m_label_indices;
             } else {
                 munmap(m_indices, sizeof(IdType) * num_edge);
+                if (m_label_indices != nullptr) munmap(m_label_indices, sizeof(IdType) * num_edge);
             }
             if (m_indptr != nullptr) delete[] m_indptr;
             if (m_offset != nullptr) delete[] m_offset;
             if (m_triangles != nullptr) delete[] m_triangles;
+            if (m_labels != nullptr) delete[] m_labels;
+            if (m_label_offset != nullptr) delete[] m_label_offset;
         };
 
         uint64_t get_vnum() const { return num_vertex; }
@@ -60,6 +69,17 @@ namespace minigraph {
             auto degree = Offset(v_id);
             return VertexSet(v_id, start, degree);
         };
+
+        IdType Label(IdType v_id) const { assert(v_id < num_vertex && num_label > 0); return m_labels[v_id]; };
+
+        // return the neighbors of v with the given label
+        VertexSet NL(IdType v_id, IdType label) const {
+            assert(v_id < num_vertex && label < num_label);
+            const uint32_t *offset = m_label_offset + v_id * num_label;
+            uint64_t begin = offset[label];
+            uint64_t end = label + 1 < num_label ? offset[label + 1] : Degree(v_id);
+            return VertexSet(v_id, m_label_indices + m_indptr[v_id] + begin, end - begin);
+        };
     };
 
 
@@ -8,10 +8,15 @@
 #include "vertex_set.h"
 #include "graph.h"
 #include <atomic>
+#include <type_traits>
+#include <functional>
+#include <oneapi/tbb/parallel_for.h>
+#include <oneapi/tbb/parallel_reduce.h>
 #include <tuple>
 
 #define NOT_PRUNE -2
 #define WILL_PRUNE -1
+#define BUILDING -3
 
 namespace minigraph {
     
@@ -258,30 +263,112 @@ namespace minigraph {
     };
 
 
-    // MiniGraph Interface
-    struct MiniGraphIF {
-        MiniGraphIF() = default;
+    /* brief Positions of the vertices of a MiniGraph in the vertices of its parent
+     * Owned, or shared with the index map the plan computed for the same vertex set in the current iteration, in
+     * which case the map must outlive the MiniGraph (the plan declares it first).
+     * */
+    class IndexMap {
+    private:
+        ManagedContainer m_own;
+        const IdType *m_data{nullptr};
+        size_t m_size{0};
+    public:
+        template<typename MiniGraph>
+        void assign(const MiniGraph *mg, const VertexSet &_vertex, const ManagedContainer *_shared) {
+            if (_shared != nullptr) {
+                m_data = _shared->begin();
+                m_size = _shared->size();
+                return;
+            }
+            m_own = mg->indices(_vertex);
+            m_data = m_own.begin();
+            m_size = m_own.size();
+        }
 
-        virtual ~MiniGraphIF() = default;
+        size_t size() const { return m_size; }
 
-        inline static const Graph *DATA_GRAPH{nullptr};
+        IdType operator[](size_t i) const {
+            assert(i < m_size);
+            return m_data[i];
+        }
+    };
 
-        virtual void build(const VertexSet &_vertex,
-                           const VertexSet &_intersect,
-                           const VertexSet &_iter) = 0;
+    /* brief Lazily pruned adjacency lists shared by the tasks of nested plans
+     * The m_degree entry of a list that is not pruned yet is claimed by a single task with a CAS to BUILDING; that
+     * task fills the range of m_ctn reserved for the list and publishes the degree with a release store. Readers
+     * never wait: a list that is being pruned by another task is read unpruned, as the lists the cost model decides
+     * not to prune already are.
+     * */
+    inline IdType load_degree(const IdType &entry) {
+        return __atomic_load_n(&entry, __ATOMIC_ACQUIRE);
+    }
 
-        virtual void build(MiniGraphIF *mg,
-                           const VertexSet &_vertex,
-                           const VertexSet &_intersect,
-                           const VertexSet &_iter) = 0;
+    inline bool claim_degree(IdType &entry, IdType unbuilt) {
+        return __atomic_compare_exchange_n(&entry, &unbuilt, static_cast<IdType>(BUILDING), false,
+                                           __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    }
 
-        virtual VertexSet N(IdType i) = 0;
+    inline void publish_degree(IdType &entry, IdType degree) {
+        __atomic_store_n(&entry, degree, __ATOMIC_RELEASE);
+    }
 
-        virtual ManagedContainer indices(const VertexSet &_to_iter) const = 0;
+    struct MiniGraphCost {
+        double build_ns{1.0};
+        double scan_ns{1.0};
+        double large_degree_factor{4.0};
+    };
+
+    /* brief Common base of the MiniGraphs (adjacency lists of a vertex set pruned by an intersect set)
+     * The MiniGraph types are templates on whether the lists are bounded by the vertex id and on the type of the
+     * MiniGraph they are pruned from (void = the data graph). Generated plans name the concrete instantiation, so
+     * N(), indices() and Degree() are resolved at compile time and inlined into the loops using them.
+     * */
+    struct MiniGraphIF {
+        inline static const Graph *DATA_GRAPH{nullptr};
+
+        // per-element costs of MiniGraphCostModel::should_prune; plans of calibrated graphs set them (see calibrate)
+        inline static MiniGraphCost COST{};
+
+        // visits of the MiniGraphCostModel lists estimated by the plan and observed (profile feedback for calibrate)
+        inline static std::atomic_uint64_t REUSE_ESTIMATED{0};
+        inline static std::atomic_uint64_t REUSE_OBSERVED{0};
 
-        virtual IdType Degree(IdType i) const = 0;
+        // upper bound of the size of the pruned adjacency list of v_id
+        template<bool Bounded>
+        static size_t max_pruned_degree(IdType v_id, size_t intersect_size) {
+            return std::min<size_t>(intersect_size, Bounded ? DATA_GRAPH->Offset(v_id) : DATA_GRAPH->Degree(v_id));
+        }
     };
 
+    // MiniGraphs built from at least this many adjacency lists use the parallel build if the plan allows it (_par)
+    constexpr size_t PAR_BUILD_THRESHOLD = 1024;
+
+    /* brief Two-phase parallel build of the adjacency lists of a MiniGraph
+     * par_layout sizes the lists in parallel (reserve(i) = upper bound of the i-th list, 0 if it is not stored),
+     * lays them out in pos with a prefix sum and reserves ctn; par_fill then prunes the lists in parallel
+     * (fill(k) = size of the k-th list it pruned) and returns their total size. Every list is padded to its bound,
+     * so the tasks write disjoint ranges of ctn and all allocations stay in the calling thread.
+     * */
+    template<typename ReserveFn>
+    void par_layout(size_t num_vertex, ManagedContainer &pos, ManagedContainer &ctn, ReserveFn reserve) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertex), [&](const tbb::blocked_range<size_t> &r) {
+            for (size_t i = r.begin(); i < r.end(); i++) pos[i + 1] = reserve(i);
+        });
+        pos[0] = 0;
+        for (size_t i = 0; i < num_vertex; i++) pos[i + 1] += pos[i];
+        if (ctn.capacity() < pos[num_vertex]) ctn.Reserve(pos[num_vertex]);
+    }
+
+    template<typename FillFn>
+    size_t par_fill(size_t num_lists, FillFn fill) {
+        return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, num_lists), size_t{0},
+                                    [&](const tbb::blocked_range<size_t> &r, size_t edges) {
+                                        for (size_t k = r.begin(); k < r.end(); k++) edges += fill(k);
+                                        return edges;
+                                    }, std::plus<>());
+    }
+
+    template<bool Bounded, typename Parent = void>
     class MiniGraphEager : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -289,22 +376,17 @@ namespace minigraph {
         ManagedContainer m_ctn;
         ManagedContainer m_pos;
         ManagedContainer m_degree;
-        ManagedContainer m_indices;
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
         const bool m_par{false};
         size_t num_edges{0};
-        MiniGraphIF *m_mg{nullptr};
+        Parent *m_mg{nullptr};
 
     public:
-        MiniGraphEager() = default;
-
-        ~MiniGraphEager() override = default;
-
-        MiniGraphEager(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
+        explicit MiniGraphEager(bool _par = false) : m_par{_par} {};
 
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
             if (m_pos.capacity() <= m_vertex.size()) {
@@ -315,12 +397,25 @@ namespace minigraph {
             m_degree.set_size(m_vertex.size());
             num_edges = 0;
             m_pos[0] = num_edges;
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) {
+                    return max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(m_vertex.size(), [this](size_t i) {
+                    IdType v_id = m_vertex[i];
+                    IdType *start = m_ctn.begin() + m_pos[i];
+                    m_degree[i] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                          : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[i];
+                });
+                return;
+            }
             for (uint64_t i = 0; i < m_vertex.size(); ++i) {
                 size_t buffer_required = m_intersect.size() + m_pos[i];
                 if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 IdType v_id = m_vertex[i];
                 IdType *start = m_ctn.begin() + m_pos[i];
-                size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                 m_degree[i] = degree;
                 m_pos[i + 1] = m_pos[i] + degree;
@@ -328,10 +423,11 @@ namespace minigraph {
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
             m_mg = mg;
             m_vertex = _vertex;
             m_intersect = _intersect;
@@ -342,35 +438,49 @@ namespace minigraph {
             m_pos.set_size(m_vertex.size() + 1);
             m_degree.set_size(m_vertex.size());
             m_pos[0] = 0;
-            m_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) {
+                    return max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(m_vertex.size(), [this](size_t i) {
+                    IdType v_id = m_vertex[i];
+                    IdType *start = m_ctn.begin() + m_pos[i];
+                    m_degree[i] = Bounded ? m_intersect.intersect(m_mg->N(m_mg_indices[i]), v_id, start)
+                                          : m_intersect.intersect(m_mg->N(m_mg_indices[i]), start);
+                    return m_degree[i];
+                });
+                return;
+            }
             for (uint64_t i = 0; i < m_vertex.size(); ++i) {
                 size_t buffer_required = m_intersect.size() + m_pos[i];
                 if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 IdType v_id = m_vertex[i];
-                IdType adj_idx = m_indices[i];
+                IdType adj_idx = m_mg_indices[i];
                 IdType *start = m_ctn.begin() + m_pos[i];
-                size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                                           : m_intersect.intersect(m_mg->N(adj_idx), start);
                 m_degree[i] = degree;
                 m_pos[i + 1] = m_pos[i] + degree;
             }
         }
 
-        VertexSet N(IdType i) override {
+        VertexSet N(IdType i) {
             return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
         }
 
-        IdType Degree(IdType i) const override {
+        IdType Degree(IdType i) const {
             return m_degree[i];
         }
     };
 
+    template<bool Bounded, typename Parent = void>
     class MiniGraphLazy : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -379,22 +489,17 @@ namespace minigraph {
         ManagedContainer m_pos;
         ManagedContainer m_degree;
         ManagedContainer m_indices;
-        ManagedContainer m_mg_indices;
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
         const bool m_par{false};
         size_t num_edges{0};
-        MiniGraphIF *m_mg{nullptr};
+        Parent *m_mg{nullptr};
 
     public:
-        MiniGraphLazy() = default;
-
-        MiniGraphLazy(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
-
-        ~MiniGraphLazy() override = default;
+        explicit MiniGraphLazy(bool _par = false) : m_par{_par} {};
 
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
 
@@ -411,23 +516,40 @@ namespace minigraph {
             for (auto &x: m_degree) {
                 x = INVALID_ID;
             }
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists pruned now
+                for (IdType v_idx: m_indices) m_degree[v_idx] = 0;
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) {
+                    return m_degree[i] == INVALID_ID ? 0 : max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                              : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
             for (auto v_idx: m_indices) {
                 m_pos[v_idx] = num_edges;
                 size_t buffer_required = m_intersect.size() + num_edges;
                 if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 IdType v_id = m_vertex[v_idx];
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
             m_mg = mg;
             m_vertex = _vertex;
             m_intersect = _intersect;
@@ -443,9 +565,26 @@ namespace minigraph {
                 x = INVALID_ID;
             }
             m_indices = get_indices(m_vertex, _iter);
-            m_mg_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
             assert(m_indices.size() == _iter.size());
             assert(m_mg_indices.size() == m_vertex.size());
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists pruned now
+                for (IdType v_idx: m_indices) m_degree[v_idx] = 0;
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) {
+                    return m_degree[i] == INVALID_ID ? 0 : max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    IdType adj_idx = m_mg_indices[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                              : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
             for (IdType v_idx: m_indices) {
                 IdType v_id = m_vertex[v_idx];
                 IdType adj_idx = m_mg_indices[v_idx];
@@ -453,27 +592,29 @@ namespace minigraph {
                 if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                 m_pos[v_idx] = num_edges;
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                                           : m_intersect.intersect(m_mg->N(adj_idx), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        VertexSet N(IdType i) override {
+        VertexSet N(IdType i) {
             if (m_degree[i] == INVALID_ID) {
-                if (m_mg) return m_mg->N(m_mg_indices[i]);
-                else return DATA_GRAPH->N(m_vertex[i]);
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
+                }
+                return DATA_GRAPH->N(m_vertex[i]);
             } else {
                 return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
             }
         }
 
-        IdType Degree(IdType i) const override {
+        IdType Degree(IdType i) const {
             return m_degree[i];
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
@@ -481,6 +622,7 @@ namespace minigraph {
     };
 
 
+    template<bool Bounded, typename Parent = void>
     class MiniGraphOnline : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -489,19 +631,16 @@ namespace minigraph {
         ManagedContainer m_pos;
         ManagedContainer m_degree;
         ManagedContainer m_indices;
-        ManagedContainer m_mg_indices;
-        MiniGraphIF *m_mg{nullptr};
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
+        Parent *m_mg{nullptr};
         const bool m_par{false};
         size_t num_edges{0};
         size_t est_edges{0};
     public:
-        MiniGraphOnline() = default;
-        MiniGraphOnline(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
-        ~MiniGraphOnline() override = default;
+        explicit MiniGraphOnline(bool _par = false) : m_par{_par} {};
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
             if (m_pos.capacity() <= m_vertex.size()) {
@@ -518,25 +657,37 @@ namespace minigraph {
             m_indices = get_indices(m_vertex, _iter);
             for (size_t i = 0; i < m_vertex.size(); i++) {
                 IdType v_id = m_vertex[i];
-                m_pos[i + 1] = m_bounded ? m_pos[i] + std::min(DATA_GRAPH->Offset(v_id), m_intersect.size())
+                m_pos[i + 1] = Bounded ? m_pos[i] + std::min(DATA_GRAPH->Offset(v_id), m_intersect.size())
                                          : m_pos[i] + std::min(DATA_GRAPH->Degree(v_id), m_intersect.size());
             }
             est_edges = m_pos[m_vertex.size()];
             if (m_ctn.capacity() < est_edges) m_ctn.Reserve(est_edges);
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                              : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
             for (auto v_idx: m_indices) {
                 IdType v_id = m_vertex[v_idx];
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
             m_mg = mg;
             m_vertex = _vertex;
             m_intersect = _intersect;
@@ -554,7 +705,7 @@ namespace minigraph {
             }
 
             m_indices = get_indices(m_vertex, _iter);
-            m_mg_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
             assert(m_vertex.size() == m_mg_indices.size());
             assert(m_indices.size() <= _iter.size());
             m_pos[0] = 0;
@@ -564,46 +715,73 @@ namespace minigraph {
             }
             est_edges = m_pos[m_vertex.size()];
             if (m_ctn.capacity() < est_edges) m_ctn.Reserve(est_edges);
+            if (m_par && m_indices.size() >= PAR_BUILD_THRESHOLD) {
+                num_edges = par_fill(m_indices.size(), [this](size_t k) {
+                    IdType v_idx = m_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    IdType adj_idx = m_mg_indices[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                              : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
             for (IdType v_idx: m_indices) {
                 IdType adj_idx = m_mg_indices[v_idx];
                 IdType v_id = m_vertex[v_idx];
                 IdType *start = m_ctn.begin() + m_pos[v_idx];
-                size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                                           : m_intersect.intersect(m_mg->N(adj_idx), start);
                 m_degree[v_idx] = degree;
                 num_edges += degree;
             }
         }
 
-        VertexSet N(IdType i) override {
-            if (m_degree[i] == INVALID_ID) {
-                IdType v_id = m_vertex[i];
-                if (m_mg != nullptr) {
-                    IdType adj_idx = m_mg_indices[i];
-                    IdType *start = m_ctn.begin() + m_pos[i];
-                    size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                                : m_intersect.intersect(m_mg->N(adj_idx), start);
-                    m_degree[i] = degree;
-                } else {
-                    IdType *start = m_ctn.begin() + m_pos[i];
-                    size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                                : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
-                    m_degree[i] = degree;
+        VertexSet N(IdType i) {
+            IdType degree = load_degree(m_degree[i]);
+            if (degree == INVALID_ID && claim_degree(m_degree[i], INVALID_ID)) {
+                IdType *start = m_ctn.begin() + m_pos[i];
+                degree = prune(i, start);
+                publish_degree(m_degree[i], degree);
+                return VertexSet(m_vertex[i], start, degree);
+            }
+            if (degree == INVALID_ID || degree == static_cast<IdType>(BUILDING)) {
+                // being pruned by another task
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
                 }
+                return DATA_GRAPH->N(m_vertex[i]);
             }
-            return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
+            return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], degree);
         }
 
-        IdType Degree(IdType i) const override {
-            return m_degree[i];
+        IdType Degree(IdType i) const {
+            return load_degree(m_degree[i]);
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
         }
+
+    private:
+        // prune the i-th list into its reserved range
+        IdType prune(IdType i, IdType *start) {
+            IdType v_id = m_vertex[i];
+            if constexpr (!std::is_void_v<Parent>) {
+                if (m_mg != nullptr) {
+                    IdType adj_idx = m_mg_indices[i];
+                    return Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                   : m_intersect.intersect(m_mg->N(adj_idx), start);
+                }
+            }
+            return Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+        }
     };
+    template<bool Bounded, typename Parent = void>
     class MiniGraphCostModel : public MiniGraphIF {
     private:
         VertexSet m_vertex;
@@ -612,9 +790,8 @@ namespace minigraph {
         ManagedContainer m_pos;
         ManagedContainer m_degree;
         // ManagedContainer m_indices;
-        ManagedContainer m_mg_indices;
-        MiniGraphIF *m_mg{nullptr};
-        const bool m_bounded{false};
+        IndexMap m_mg_indices;
+        Parent *m_mg{nullptr};
         const bool m_par{false};
         size_t num_edges{0};
         size_t est_edges{0};
@@ -626,10 +803,10 @@ namespace minigraph {
 
         bool should_prune(size_t idx) const {
             uint64_t degree = DATA_GRAPH->Degree(m_vertex[idx]);
-            const static int large_degree_threshold = DATA_GRAPH->num_edge * 4 / DATA_GRAPH->num_vertex;
-            if (degree >= large_degree_threshold) return true;
+            if (degree >= COST.large_degree_factor * DATA_GRAPH->num_edge / DATA_GRAPH->num_vertex) return true;
             auto intersect_size = m_intersect.size();
-            double gain = reuse_multiplier / m_vertex.size() * (degree - 1.0 * intersect_size * degree / DATA_GRAPH->num_vertex) - intersect_size - degree;
+            double gain = reuse_multiplier / m_vertex.size() * COST.scan_ns * (degree - 1.0 * intersect_size * degree / DATA_GRAPH->num_vertex)
+                          - COST.build_ns * (intersect_size + degree);
             // double gain = reuse_multiplier / two_htop * degree * (degree - 1.0 * intersect_size * degree / DATA_GRAPH->num_vertex) - intersect_size - degree;
         //    if (gain < 0 && degree > 10000) {
         //        printf("Vertex Degree=%d | Reuse Factor=%f | Vertex Size=%d | Intersect Size=%d | Gain=%f\n ", degree, reuse_multiplier, m_vertex.size(), intersect_size, gain);
@@ -638,17 +815,16 @@ namespace minigraph {
         }
 
     public:
-        MiniGraphCostModel() = default;
+        explicit MiniGraphCostModel(bool _par = false) : m_par{_par} {};
 
-        MiniGraphCostModel(bool _bounded, bool _par = false) : m_bounded{_bounded}, m_par{_par} {};
-
-        ~MiniGraphCostModel() override = default;
-
-        void set_reuse_multiplier(double _reuse) { reuse_multiplier = _reuse; };
+        void set_reuse_multiplier(double _reuse) {
+            reuse_multiplier = _reuse;
+            REUSE_ESTIMATED.fetch_add(static_cast<uint64_t>(_reuse), std::memory_order_relaxed);
+        };
 
         void build(const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter) {
             m_vertex = _vertex;
             m_intersect = _intersect;
             // threshold = DATA_GRAPH->get_enum() / DATA_GRAPH->get_vnum();
@@ -664,25 +840,49 @@ namespace minigraph {
             for (auto v_id : m_vertex) {
                 two_htop += DATA_GRAPH->Degree(v_id);
             }
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists of _iter, which are pruned now
+                ManagedContainer iter_indices = get_indices(m_vertex, _iter);
+                for (size_t i = 0; i < m_vertex.size(); i++) m_degree[i] = NOT_PRUNE;
+                for (IdType v_idx: iter_indices) m_degree[v_idx] = 0;
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) -> size_t {
+                    if (m_degree[i] != 0) {
+                        if (!should_prune(i)) return 0;
+                        m_degree[i] = WILL_PRUNE;
+                    }
+                    return max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(iter_indices.size(), [this, &iter_indices](size_t k) {
+                    IdType v_idx = iter_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                                              : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
             if (_iter.begin() == m_vertex.begin()) {
-                for (uint64_t i = 0; i < _iter.size(); ++i) {
+                // a prefix of the vertices, which _iter may extend past
+                const size_t num_iter = std::min(_iter.size(), m_vertex.size());
+                for (uint64_t i = 0; i < num_iter; ++i) {
                     size_t buffer_required = m_intersect.size() + m_pos[i];
                     if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                     IdType v_id = m_vertex[i];
                     IdType *start = m_ctn.begin() + m_pos[i];
-                    size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                    size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                                             : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                     m_degree[i] = degree;
                     m_pos[i + 1] = m_pos[i] + degree;
                     num_edges += degree;
                 }
-                for (uint64_t i = _iter.size(); i < m_vertex.size(); i++) {
+                for (uint64_t i = num_iter; i < m_vertex.size(); i++) {
                     if (should_prune(i)) {
                         // size_t buffer_required = m_intersect.size() + m_pos[i];
                         // if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         // IdType v_id = m_vertex[i];
                         // IdType *start = m_ctn.begin() + m_pos[i];
-                        // size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                        // size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                         //                         : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                         // m_degree[i] = degree;
                         // m_pos[i + 1] = m_pos[i] + degree;
@@ -708,7 +908,7 @@ namespace minigraph {
                         size_t buffer_required = m_intersect.size() + m_pos[i];
                         if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         IdType *start = m_ctn.begin() + m_pos[i];
-                        size_t degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                        size_t degree = Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
                                                 : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
                         m_degree[i] = degree;
                         m_pos[i + 1] = m_pos[i] + degree;
@@ -728,10 +928,11 @@ namespace minigraph {
             }
         }
 
-        void build(MiniGraphIF *mg,
+        void build(Parent *mg,
                    const VertexSet &_vertex,
                    const VertexSet &_intersect,
-                   const VertexSet &_iter) override {
+                   const VertexSet &_iter,
+                   const ManagedContainer *_mg_indices = nullptr) {
             m_mg = mg;
             m_vertex = _vertex;
             m_intersect = _intersect;
@@ -750,32 +951,57 @@ namespace minigraph {
             }
 
             // m_indices = get_indices(m_vertex, _iter);
-            m_mg_indices = m_mg->indices(m_vertex);
+            m_mg_indices.assign(m_mg, m_vertex, _mg_indices);
             assert(m_vertex.size() == m_mg_indices.size());
 //            assert(m_indices.size() <= _iter.size());
+            if (m_par && m_vertex.size() >= PAR_BUILD_THRESHOLD) {
+                // m_degree = 0 marks the lists of _iter, which are pruned now
+                ManagedContainer iter_indices = get_indices(m_vertex, _iter);
+                for (size_t i = 0; i < m_vertex.size(); i++) m_degree[i] = NOT_PRUNE;
+                for (IdType v_idx: iter_indices) m_degree[v_idx] = 0;
+                par_layout(m_vertex.size(), m_pos, m_ctn, [this](size_t i) -> size_t {
+                    if (m_degree[i] != 0) {
+                        if (!should_prune(i)) return 0;
+                        m_degree[i] = WILL_PRUNE;
+                    }
+                    return max_pruned_degree<Bounded>(m_vertex[i], m_intersect.size());
+                });
+                num_edges = par_fill(iter_indices.size(), [this, &iter_indices](size_t k) {
+                    IdType v_idx = iter_indices[k];
+                    IdType v_id = m_vertex[v_idx];
+                    IdType *start = m_ctn.begin() + m_pos[v_idx];
+                    IdType adj_idx = m_mg_indices[v_idx];
+                    m_degree[v_idx] = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                              : m_intersect.intersect(m_mg->N(adj_idx), start);
+                    return m_degree[v_idx];
+                });
+                return;
+            }
             if (_iter.begin() == m_vertex.begin()) {
-                for (uint64_t i = 0; i < _iter.size(); ++i) {
+                // a prefix of the vertices, which _iter may extend past
+                const size_t num_iter = std::min(_iter.size(), m_vertex.size());
+                for (uint64_t i = 0; i < num_iter; ++i) {
                     size_t buffer_required = m_intersect.size() + m_pos[i];
                     if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                     IdType v_id = m_vertex[i];
                     IdType adj_idx = m_mg_indices[i];
                     IdType *start = m_ctn.begin() + m_pos[i];
 
-                    size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                    size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                                             : m_intersect.intersect(m_mg->N(adj_idx), start);
 
                     m_degree[i] = degree;
                     m_pos[i + 1] = m_pos[i] + degree;
                     num_edges += degree;
                 }
-                for (uint64_t i = _iter.size(); i < m_vertex.size(); i++) {
+                for (uint64_t i = num_iter; i < m_vertex.size(); i++) {
                     if (should_prune(i)) {
                         // size_t buffer_required = m_intersect.size() + m_pos[i];
                         // if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         // IdType v_id = m_vertex[i];
                         // IdType *start = m_ctn.begin() + m_pos[i];
                         // IdType adj_idx = m_mg_indices[i];
-                        // size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                        // size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                         //                         : m_intersect.intersect(m_mg->N(adj_idx), start);
                         // m_degree[i] = degree;
                         // m_pos[i + 1] = m_pos[i] + degree;
@@ -801,7 +1027,7 @@ namespace minigraph {
                         if (m_ctn.capacity() < buffer_required) m_ctn.Resize(buffer_required);
                         IdType *start = m_ctn.begin() + m_pos[i];
                         IdType adj_idx = m_mg_indices[i];
-                        size_t degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                        size_t degree = Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
                                                 : m_intersect.intersect(m_mg->N(adj_idx), start);
                         m_degree[i] = degree;
                         m_pos[i + 1] = m_pos[i] + degree;
@@ -821,43 +1047,50 @@ namespace minigraph {
             }
         }
 
-        VertexSet N(IdType i) override {
-            if (m_degree[i] == NOT_PRUNE) {
-                if (m_mg) {
-                    return m_mg->N(m_mg_indices[i]);
-                }
-                else {
-                    return DATA_GRAPH->N(m_vertex[i]);
-                }
-            } else if (m_degree[i] == WILL_PRUNE) {
-                IdType v_id = m_vertex[i];
+        VertexSet N(IdType i) {
+            REUSE_OBSERVED.fetch_add(1, std::memory_order_relaxed);
+            IdType degree = load_degree(m_degree[i]);
+            if (degree == static_cast<IdType>(WILL_PRUNE) && claim_degree(m_degree[i], static_cast<IdType>(WILL_PRUNE))) {
                 IdType *start = m_ctn.begin() + m_pos[i];
-                size_t degree{0};
-                if (m_mg) {
-                    IdType adj_idx = m_mg_indices[i];
-                    degree = m_bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
-                                            : m_intersect.intersect(m_mg->N(adj_idx), start);
-                    m_degree[i] = degree;
-                } else {
-                    degree = m_bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
-                                            : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
-                    m_degree[i] = degree;
+                degree = prune(i, start);
+                publish_degree(m_degree[i], degree);
+                return VertexSet(m_vertex[i], start, degree);
+            }
+            if (degree == static_cast<IdType>(NOT_PRUNE) || degree == static_cast<IdType>(WILL_PRUNE)
+                || degree == static_cast<IdType>(BUILDING)) {
+                // not worth pruning, or being pruned by another task
+                if constexpr (!std::is_void_v<Parent>) {
+                    if (m_mg) return m_mg->N(m_mg_indices[i]);
                 }
-                return VertexSet(v_id, start, degree);
-            } else {
-                return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], m_degree[i]);
+                return DATA_GRAPH->N(m_vertex[i]);
             }
+            return VertexSet(m_vertex[i], m_ctn.begin() + m_pos[i], degree);
         }
 
-        IdType Degree(IdType i) const override {
-            return m_degree[i];
+        IdType Degree(IdType i) const {
+            return load_degree(m_degree[i]);
         }
 
-        ManagedContainer indices(const VertexSet &_to_iter) const override {
+        ManagedContainer indices(const VertexSet &_to_iter) const {
             auto out = get_indices(m_vertex, _to_iter);
             assert(out.size() == _to_iter.size());
             return out;
         }
+
+    private:
+        // prune the i-th list into its reserved range
+        IdType prune(IdType i, IdType *start) {
+            IdType v_id = m_vertex[i];
+            if constexpr (!std::is_void_v<Parent>) {
+                if (m_mg != nullptr) {
+                    IdType adj_idx = m_mg_indices[i];
+                    return Bounded ? m_intersect.intersect(m_mg->N(adj_idx), v_id, start)
+                                   : m_intersect.intersect(m_mg->N(adj_idx), start);
+                }
+            }
+            return Bounded ? m_intersect.intersect(DATA_GRAPH->NBound(v_id), start)
+                           : m_intersect.intersect(DATA_GRAPH->N(v_id), start);
+        }
     };
 }
 #endif //MINIGRAPH_MINIGRAPH_H
@@ -0,0 +1,169 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+#include "backend/backend.h"
+#include "meta.h"
+#include "logging.h"
+#include "common.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace minigraph;
+
+template<typename T>
+inline void read_file(std::filesystem::path path, T *&pointer, uint64_t num_elements) {
+    CHECK(std::filesystem::is_regular_file(path)) << "File does not exists: " << path;
+    const size_t num_bytes = sizeof(T) * num_elements;
+    pointer = new T[num_elements];
+    std::ifstream file;
+    file.open(path, std::ios::binary | std::ios::in);
+    file.read(reinterpret_cast<char *>(pointer), num_bytes);
+    CHECK(file.gcount() == (long int) num_bytes) << "Only read " << ToReadableSize(file.gcount()) << " out of "
+                                                 << ToReadableSize(num_bytes) << " from " << path;
+    file.close();
+}
+
+// adjacency lists only: the set operations being timed do not need triangles or labels
+Graph *load_adjacency(const std::string &in_dir, const MetaData &meta) {
+    Graph *out = new Graph;
+    out->num_vertex = meta.num_vertex;
+    out->num_edge = meta.num_edge;
+    out->max_degree = meta.max_degree;
+    std::filesystem::path indicesFile = in_dir;
+    indicesFile /= sizeof(IdType) == sizeof(uint64_t) ? Constant::kIndicesU64File : Constant::kIndicesU32File;
+    read_file<uint64_t>(std::filesystem::path{in_dir} / Constant::kIndptrU64File, out->m_indptr, meta.num_vertex + 1);
+    read_file<uint64_t>(std::filesystem::path{in_dir} / Constant::kOffsetU64File, out->m_offset, meta.num_vertex);
+    read_file<IdType>(indicesFile, out->m_indices, meta.num_edge);
+    return out;
+}
+
+struct CostSample {
+    double seconds{0};
+    uint64_t elements{0};
+
+    double ns() const { return elements == 0 ? 1.0 : seconds * 1e9 / elements; }
+};
+
+/* brief Per-element cost of the merges a MiniGraph build performs
+ * For random roots u, the intersect set is N(u) and the pruned lists are N(v) of neighbors v of u, as for the
+ * MiniGraph of the first loop. Elements = |N(u)| + |N(v)|.
+ * */
+CostSample measure_build(const Graph *graph, std::mt19937_64 &rng, size_t num_roots, size_t lists_per_root,
+                         IdType *buffer, uint64_t &sink) {
+    CostSample out;
+    std::uniform_int_distribution<IdType> pick(0, graph->get_vnum() - 1);
+    for (size_t r = 0; r < num_roots; r++) {
+        IdType u = pick(rng);
+        VertexSet intersect = graph->N(u);
+        if (intersect.size() < 2) continue;
+        Timer t;
+        for (size_t k = 0; k < lists_per_root; k++) {
+            IdType v = intersect[rng() % intersect.size()];
+            VertexSet list = graph->N(v);
+            sink += intersect.intersect(list, buffer);
+            out.elements += intersect.size() + list.size();
+        }
+        out.seconds += t.Passed();
+    }
+    return out;
+}
+
+/* brief Per-element cost of a later set operation reading an unpruned adjacency list
+ * A small candidate set (every 4th neighbor of u, so the merge spans the whole id range) is intersected with the
+ * adjacency list of a random vertex at distance two. Elements = |candidates| + |N(w)|.
+ * */
+CostSample measure_scan(const Graph *graph, std::mt19937_64 &rng, size_t num_roots, size_t lists_per_root,
+                        IdType *buffer, uint64_t &sink) {
+    CostSample out;
+    std::uniform_int_distribution<IdType> pick(0, graph->get_vnum() - 1);
+    std::vector<IdType> candidates;
+    for (size_t r = 0; r < num_roots; r++) {
+        IdType u = pick(rng);
+        VertexSet adj = graph->N(u);
+        if (adj.size() < 4) continue;
+        candidates.clear();
+        for (size_t i = 0; i < adj.size(); i += 4) candidates.push_back(adj[i]);
+        VertexSet cand(u, candidates.data(), candidates.size());
+        Timer t;
+        for (size_t k = 0; k < lists_per_root; k++) {
+            VertexSet hop = graph->N(adj[rng() % adj.size()]);
+            if (hop.size() == 0) continue;
+            VertexSet list = graph->N(hop[rng() % hop.size()]);
+            sink += cand.intersect(list, buffer);
+            out.elements += cand.size() + list.size();
+        }
+        out.seconds += t.Passed();
+    }
+    return out;
+}
+
+// observed / estimated visits of the MiniGraphCostModel lists reported by prof_runner
+double read_reuse_feedback(const std::vector<std::string> &logs) {
+    double estimated = 0, observed = 0;
+    for (const auto &path: logs) {
+        std::ifstream file(path);
+        CHECK(file.is_open()) << "Failed to open profile log: " << path;
+        for (std::string line; std::getline(file, line);) {
+            for (auto [key, value]: {std::pair<std::string, double *>{"MGReuseEstimated", &estimated},
+                                     std::pair<std::string, double *>{"MGReuseObserved", &observed}}) {
+                size_t pos = line.find(key);
+                if (pos != std::string::npos) *value += std::stod(line.substr(pos + key.size()));
+            }
+        }
+    }
+    if (estimated <= 0 || observed <= 0) {
+        LOG(WARNING) << "No MiniGraphCostModel visits in the profile logs; keeping the reuse scale";
+        return -1;
+    }
+    return std::clamp(observed / estimated, 0.01, 100.0);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "./calibrate [graph_dir] [prof_runner logs (optional)...]\n";
+        std::cout << "Measures the costs of the set operations of the MiniGraph cost model on this machine and graph\n"
+                     "and writes them to graph_dir/" << Constant::kCostModelFile << ", where run and census pick them up.\n";
+        std::cout << "prof_runner logs of CostModel profiling plans also calibrate the estimated MiniGraph reuse.\n";
+        std::cout << "For example:\n./build/bin/calibrate ./dataset/GraphMini/wiki\n";
+        return 0;
+    }
+    std::string graph_dir{argv[1]};
+    std::vector<std::string> logs(argv + 2, argv + argc);
+
+    MetaData meta;
+    meta.read(graph_dir);
+    CostModelParams params = meta.cost;
+    Timer t;
+    Graph *graph = load_adjacency(graph_dir, meta);
+    LOG(MSG) << "LoadTime\t" << t.Passed() << "s";
+
+    constexpr size_t kRoots = 4096, kListsPerRoot = 32;
+    std::mt19937_64 rng(0);
+    std::vector<IdType> buffer(meta.max_degree + 1);
+    uint64_t sink = 0;
+    t.Reset();
+    measure_build(graph, rng, kRoots / 8, kListsPerRoot, buffer.data(), sink); // warm up
+    CostSample build = measure_build(graph, rng, kRoots, kListsPerRoot, buffer.data(), sink);
+    CostSample scan = measure_scan(graph, rng, kRoots, kListsPerRoot, buffer.data(), sink);
+    LOG(MSG) << "MeasureTime\t" << t.Passed() << "s";
+    LOG(INFO) << "Checksum\t" << sink;
+    params.build_ns = build.ns();
+    params.scan_ns = scan.ns();
+    if (!logs.empty()) {
+        double reuse_scale = read_reuse_feedback(logs);
+        if (reuse_scale > 0) params.reuse_scale = reuse_scale;
+    }
+    params.save(graph_dir);
+
+    LOG(MSG) << Constant::kCostBuildNs << "\t" << params.build_ns;
+    LOG(MSG) << Constant::kCostScanNs << "\t" << params.scan_ns;
+    LOG(MSG) << Constant::kCostReuseScale << "\t" << params.reuse_scale;
+    LOG(MSG) << Constant::kCostLargeDegreeFactor << "\t" << params.large_degree_factor;
+    LOG(MSG) << "Saved\t" << std::filesystem::path(graph_dir) / Constant::kCostModelFile;
+    delete graph;
+}
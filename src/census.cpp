@@ -0,0 +1,155 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+#include "codegen.h"
+#include "logging.h"
+#include "configure.h"
+#include "common.h"
+#include "frontend.h"
+#include "../dependency/GraphPi/include/motif_generator.h"
+#include <vector>
+#include <iostream>
+#include <fmt/format.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <numeric>
+using namespace minigraph;
+
+// all connected k-vertex patterns up to isomorphism
+std::vector<std::string> gen_motifs(int k) {
+    MotifGenerator generator(k);
+    std::vector<std::string> out;
+    for (const Pattern &p: generator.generate()) {
+        std::string adj_mat(k * k, '0');
+        const int *adj = p.get_adj_mat_ptr();
+        for (int i = 0; i < k * k; i++) {
+            if (adj[i]) adj_mat.at(i) = '1';
+        }
+        out.push_back(adj_mat);
+    }
+    return out;
+}
+
+int num_edges(const std::string &adj_mat) {
+    return std::count(adj_mat.begin(), adj_mat.end(), '1') / 2;
+}
+
+// number of vertex orders under which every edge of sub is an edge of sup (both have k vertices)
+uint64_t num_embeddings(const std::string &sub, const std::string &sup, int k) {
+    std::vector<int> perm(k);
+    std::iota(perm.begin(), perm.end(), 0);
+    uint64_t out = 0;
+    do {
+        bool mapped = true;
+        for (int i = 0; i < k && mapped; i++) {
+            for (int j = 0; j < k && mapped; j++) {
+                if (sub.at(i * k + j) == '1' && sup.at(perm[i] * k + perm[j]) != '1') mapped = false;
+            }
+        }
+        if (mapped) out++;
+    } while (std::next_permutation(perm.begin(), perm.end()));
+    return out;
+}
+
+/* brief Vertex-induced counts from edge-induced counts of all connected k-vertex patterns
+ * Every edge-induced match of H spans k vertices that induce exactly one pattern G containing H, so
+ * EI(H) = sum_G VI(G) * s(H, G) with s(H, G) = (number of copies of H spanning G) = embeddings(H, G) / |Aut(H)|.
+ * The system is triangular in the number of edges and is solved from the clique (VI = EI) downwards.
+ * */
+std::vector<long long> to_vertex_induced(const std::vector<std::string> &motifs, const std::vector<long long> &ei, int k) {
+    size_t n = motifs.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&motifs](size_t l, size_t r) {
+        return num_edges(motifs.at(l)) > num_edges(motifs.at(r));
+    });
+    std::vector<long long> vi(n, 0);
+    for (size_t h: order) {
+        uint64_t num_aut = num_embeddings(motifs.at(h), motifs.at(h), k);
+        long long cnt = ei.at(h);
+        for (size_t g = 0; g < n; g++) {
+            if (g == h || num_edges(motifs.at(g)) <= num_edges(motifs.at(h))) continue;
+            cnt -= vi.at(g) * (long long) (num_embeddings(motifs.at(h), motifs.at(g), k) / num_aut);
+        }
+        vi.at(h) = cnt;
+    }
+    return vi;
+}
+
+// RESULT_<k>=<count> lines printed by the runner
+std::vector<long long> parse_results(const std::string &run_results, size_t num_patterns) {
+    std::vector<long long> out(num_patterns, -1);
+    std::stringstream ss(run_results);
+    for (std::string line; std::getline(ss, line);) {
+        size_t pos = line.find("RESULT_");
+        if (pos == std::string::npos) continue;
+        size_t eq = line.find('=', pos);
+        size_t k = std::stoul(line.substr(pos + 7, eq - pos - 7));
+        if (k < num_patterns) out.at(k) = std::stoll(line.substr(eq + 1));
+    }
+    for (size_t k = 0; k < num_patterns; k++) {
+        CHECK(out.at(k) >= 0) << "Missing RESULT_" << k << " in the runner output:\n" << run_results;
+    }
+    return out;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cout << "./census [graph_name] [graph_dir] [k] [adj_type=1 (optional)] [exp_id=-1 (optional)]\n";
+        std::cout << "Counts every connected k-vertex pattern (graphlet) as an induced subgraph with a single plan\n";
+        std::cout << "adj_type: 0=count the vertex-induced patterns directly;\n"
+                     "          1=count the edge-induced patterns and derive the vertex-induced counts from them\n";
+        std::cout << "For example:\n./build/bin/census wiki ./dataset/GraphMini/wiki 4\n";
+        return 0;
+    }
+    std::string graph_name{argv[1]};
+    std::string graph_dir{argv[2]};
+    int k = std::atoi(argv[3]);
+    int adjmat_type_int = 1;
+    if (argc >= 5) adjmat_type_int = std::atoi(argv[4]);
+    int exp_id = -1;
+    if (argc >= 6) exp_id = std::atoi(argv[5]);
+    CHECK(k >= 3) << "Patterns need at least 3 vertices";
+    CHECK(adjmat_type_int == 0 || adjmat_type_int == 1) << "adj_type must be 0 or 1";
+
+    CodeGenConfig conf;
+    conf.adjMatType = static_cast<AdjMatType>(adjmat_type_int);
+    conf.pruningType = PruningType::None;
+    conf.parType = ParallelType::OpenMP;
+    conf.runnerType = RunnerType::Benchmark;
+    MetaData meta;
+    meta.read(graph_dir);
+
+    Timer t;
+    std::vector<std::string> motifs = gen_motifs(k);
+    LOG(MSG) << "Graph=" << graph_name << " K=" << k << " Patterns=" << motifs.size();
+    std::string code = gen_code(motifs, conf, meta);
+    std::ofstream out_file(code_path());
+    out_file << code;
+    out_file.close();
+    LOG(MSG) << "CODE_GENERATION_TIME(s)=" << t.Passed();
+
+    t.Reset();
+    auto compile_cmd = compile_runner_cmd();
+    if (system(compile_cmd.c_str()) != 0) exit(-1 && "compilation error");
+    LOG(MSG) << "COMPILATION_TIME(s)=" << t.Passed();
+
+    auto run_cmd = fmt::format("{bin_path} {exp_id} {data_dir}",
+                               fmt::arg("bin_path", runner_path().string()),
+                               fmt::arg("data_dir", graph_dir),
+                               fmt::arg("exp_id", exp_id));
+    t.Reset();
+    std::vector<long long> counts = parse_results(exec(run_cmd.c_str()), motifs.size());
+    LOG(MSG) << "CODE_EXECUTION_TIME(s)=" << t.Passed();
+
+    std::vector<long long> vi = counts;
+    if (conf.adjMatType == AdjMatType::EdgeInduced) vi = to_vertex_induced(motifs, counts, k);
+    for (size_t i = 0; i < motifs.size(); i++) {
+        std::string line = fmt::format("PATTERN={} EDGES={} VERTEX_INDUCED={}", motifs.at(i), num_edges(motifs.at(i)), vi.at(i));
+        if (conf.adjMatType == AdjMatType::EdgeInduced) line += fmt::format(" EDGE_INDUCED={}", counts.at(i));
+        LOG(MSG) << line;
+    }
+}
@@ -13,12 +13,24 @@
 #include <sstream>
 #include <algorithm>
 #include <utility>
+#include <set>
+#include <map>
+#include <fstream>
+#include <functional>
+#include <limits>
 #include "../../dependency/GraphPi/include/schedule.h"
 #include "typedef.h"
 
 namespace minigraph {
     bool EnableProfling = false;
+    bool EnableEnumeration = false;
+    bool EnableLocalCount = false;
+    bool EnableBatch = false;
+    bool EnableAnalyze = false;
     CodeGenConfig CurConfig;
+    // index in Context::filters of the candidate filter of the vertex matched at each loop, -1 if not filtered
+    std::vector<int> LoopFilter;
+    std::vector<std::pair<uint64_t, uint64_t>> Filters; // (min_degree, min_triangle) of every candidate filter
 
     inline int VEC_INDEX(int i, int j, int p_size) { 
         if (i < 0 || j < 0 || i >= p_size || j >= p_size) { 
@@ -88,13 +100,131 @@ namespace minigraph {
         return ToEdgeIR(res_mat, vid);
     };
 
-    PlanIR create_plan(const std::string &_adj_mat, CodeGenConfig config, MetaData meta) {
+    // all permutations of the pattern vertices that preserve both the edges and the vertex labels
+    std::vector<std::vector<int>> label_automorphisms(const std::string &adj_mat, const std::vector<int> &labels) {
+        int p_size = get_pattern_size(adj_mat);
+        std::vector<std::vector<int>> out;
+        std::vector<int> perm(p_size, -1);
+        std::vector<bool> used(p_size, false);
+        std::function<void(int)> extend = [&](int vid) {
+            if (vid == p_size) {
+                out.push_back(perm);
+                return;
+            }
+            for (int img = 0; img < p_size; img++) {
+                if (used.at(img) || labels.at(img) != labels.at(vid)) continue;
+                bool valid = true;
+                for (int prev = 0; prev < vid && valid; prev++) {
+                    valid = adj_mat.at(VEC_INDEX(vid, prev, p_size)) == adj_mat.at(VEC_INDEX(img, perm.at(prev), p_size));
+                }
+                if (!valid) continue;
+                used.at(img) = true;
+                perm.at(vid) = img;
+                extend(vid + 1);
+                used.at(img) = false;
+            }
+        };
+        extend(0);
+        return out;
+    }
+
+    /* brief Symmetry breaking restrictions of a labeled pattern (Grochow & Kellis)
+     * GraphPi only knows the automorphisms of the unlabeled pattern, which over-restricts a labeled one.
+     * Take the first vertex v that is moved by the remaining automorphisms, require v to have the largest id in
+     * its orbit and continue with the automorphisms fixing v. Every other vertex of the orbit comes after v in the
+     * schedule, so each restriction is an upper bound given by an already matched vertex.
+     * Returns pairs in the format of Schedule::restrict_pair: (v, u) means id(u) < id(v)
+     * */
+    std::vector<std::pair<int, int>> label_restricts(const std::string &adj_mat, const std::vector<int> &labels) {
+        int p_size = get_pattern_size(adj_mat);
+        std::vector<std::vector<int>> group = label_automorphisms(adj_mat, labels);
+        std::vector<std::pair<int, int>> out;
+        for (int vid = 0; vid < p_size && group.size() > 1; vid++) {
+            std::set<int> orbit;
+            for (const auto &perm: group) orbit.insert(perm.at(vid));
+            if (orbit.size() == 1) continue;
+            for (int other: orbit) {
+                if (other == vid) continue;
+                CHECK(other > vid) << "Logic error: the orbit of " << vid << " contains an earlier vertex " << other;
+                out.emplace_back(vid, other);
+            }
+            std::vector<std::vector<int>> stabilizer;
+            for (const auto &perm: group) {
+                if (perm.at(vid) == vid) stabilizer.push_back(perm);
+            }
+            group = stabilizer;
+        }
+        return out;
+    }
+
+    /* brief Orbit of every scheduled pattern vertex under the (label-preserving) automorphisms
+     * Orbits are numbered by their smallest vertex in the input pattern, so the numbering does not depend on the schedule.
+     * order: input pattern vertex of every scheduled vertex (Schedule::order)
+     * */
+    std::vector<int> pattern_orbits(const std::string &adj_mat, std::vector<int> labels, const std::vector<int> &order) {
+        int p_size = get_pattern_size(adj_mat);
+        if (labels.empty()) labels.resize(p_size, -1);
+        std::vector<int> first(p_size, p_size);
+        for (const auto &perm: label_automorphisms(adj_mat, labels)) {
+            for (int vid = 0; vid < p_size; vid++) first.at(vid) = std::min(first.at(vid), order.at(perm.at(vid)));
+        }
+        std::vector<int> reps = first;
+        std::sort(reps.begin(), reps.end());
+        reps.erase(std::unique(reps.begin(), reps.end()), reps.end());
+        std::vector<int> out;
+        for (int vid = 0; vid < p_size; vid++) {
+            out.push_back(std::lower_bound(reps.begin(), reps.end(), first.at(vid)) - reps.begin());
+        }
+        return out;
+    }
+
+    /* brief Edge and triangle counts under which GraphPi's uniform model sees the sketched graph
+     * The schedule search sizes a set intersected with k adjacency lists as v * p0 * p1^(k-1), with p0 = e / v^2 and
+     * p1 = t * v / e^2. The counts are scaled so that v * p0 is the degree of a vertex reached through an edge and
+     * p1 grows with the measured triangle closure over that of a uniform random graph (p0). Without the sketch
+     * (or on a uniform random graph) they are the counts of the graph.
+     * */
+    std::pair<uint64_t, uint64_t> schedule_counts(const MetaData &meta) {
+        if (!meta.stats.collected || meta.num_vertex == 0 || meta.num_edge == 0) return {meta.num_edge, meta.num_triangle};
+        const double v = meta.num_vertex, e = meta.num_edge, t = meta.num_triangle;
+        const double p0 = e / v / v;
+        const double p1 = t * v / e / e * meta.stats.edge_closure() / p0;
+        const double num_edge = std::max(e, meta.stats.edge_degree() * v);
+        const double num_triangle = p1 * num_edge * num_edge / v;
+        return {(uint64_t) num_edge, std::max<uint64_t>(1, (uint64_t) num_triangle)};
+    }
+
+    PlanIR create_plan(const std::string &_adj_mat, const std::vector<int> &_labels, CodeGenConfig config,
+                       MetaData meta) {
         Timer t;
         Schedule sc{};
         int p_size = get_pattern_size(_adj_mat);
-        sc.get_schedule(_adj_mat.c_str(), p_size, meta.num_vertex, meta.num_edge, meta.num_triangle);
+        if (!_labels.empty()) {
+            CHECK(_labels.size() == (size_t) p_size) << "Expect " << p_size << " vertex labels but get " << _labels.size();
+            CHECK(meta.num_label > 0) << "The pattern is labeled but the data graph is not (add "
+                                      << Constant::kLabelFile << " and rerun prep)";
+            for (int label: _labels) {
+                CHECK(label >= 0 && (uint64_t) label < meta.num_label)
+                    << "No vertex of the data graph carries label " << label;
+            }
+        }
+        auto [num_edge, num_triangle] = schedule_counts(meta);
+        sc.get_schedule(_adj_mat.c_str(), p_size, meta.num_vertex, num_edge, num_triangle, PerfModelType::graphpi,
+                        config.orderRank);
         std::string adj_mat = sc.get_adj_mat_str();
+        std::vector<int> labels;
+        if (!_labels.empty()) {
+            // the schedule permutes the pattern vertices
+            for (int vid = 0; vid < p_size; vid++) labels.push_back(_labels.at(sc.order.at(vid)));
+            sc.restrict_pair = label_restricts(adj_mat, labels);
+        }
         std::string res_mat = restricts_to_str(sc.restrict_pair, p_size);
+        std::vector<int> orbits;
+        if (config.runnerType == RunnerType::LocalCount) {
+            orbits.resize(p_size, 0);
+        } else if (config.runnerType == RunnerType::OrbitCount) {
+            orbits = pattern_orbits(adj_mat, labels, sc.order);
+        }
         LOG(MSG) << "SCHEDULING_TIME(s)=" << t.Passed();
         t.Reset();
         PlanIR out;
@@ -117,7 +247,7 @@ namespace minigraph {
             for (int vid = dep + 1; vid < p_size; vid++) {
                 const EdgeIR &e = edge_ir_vec.at(vid);
                 const EdgeRestrictIR &r = res_ir_vec.at(vid);
-                VertexSetIR v_ir = VertexSetIR(e, r, dep);
+                VertexSetIR v_ir = VertexSetIR(e, r, dep, labels.empty() ? -1 : labels.at(vid));
                 if (v_ir.edge_num() > 0)
                     set_ops.at(dep).push_back(v_ir);
             }
@@ -126,7 +256,7 @@ namespace minigraph {
             int iter_vid = dep + 1;
             const EdgeIR &e = edge_ir_vec.at(iter_vid);
             const EdgeRestrictIR &r = res_ir_vec.at(iter_vid);
-            VertexSetIR v_iter_ir = VertexSetIR(e, r, dep);
+            VertexSetIR v_iter_ir = VertexSetIR(e, r, dep, labels.empty() ? -1 : labels.at(iter_vid));
             CHECK(v_iter_ir.edge_num() > 0)
                 << "Invalid schedule: The set of vertex to iterate potentially contains all vertices in the graph";
             iter_set.at(dep) = v_iter_ir;
@@ -148,6 +278,18 @@ namespace minigraph {
             CHECK(iter_vs.has_id()) << "Invalid VertexSetIR (id = -1)";
         }
         out.p_size = p_size;
+        out.labels = labels;
+        out.orbits = orbits;
+        out.degrees.resize(p_size, 0);
+        out.triangles.resize(p_size, 0);
+        for (int u = 0; u < p_size; u++) {
+            for (int v = 0; v < p_size; v++) {
+                if (adj_mat.at(u * p_size + v) != '1') continue;
+                out.degrees.at(u)++;
+                for (int w = 0; w < p_size; w++)
+                    out.triangles.at(u) += adj_mat.at(v * p_size + w) == '1' && adj_mat.at(u * p_size + w) == '1';
+            }
+        }
         out.set_ops = set_ops;
         out.iter_set = iter_set;
         // iep optimization
@@ -256,7 +398,7 @@ namespace minigraph {
             }
         }
         for (auto &mg_op: out.mg_ops) {
-            for (auto itr = mg_op.begin(); itr != mg_op.end(); itr++) {
+            for (auto itr = mg_op.begin(); itr != mg_op.end();) {
                 if (itr->id < IndeedUsed.size() && !IndeedUsed.at(itr->id)) {
                     itr = mg_op.erase(itr);  // erase returns next valid iterator
                 }
@@ -270,11 +412,113 @@ namespace minigraph {
     };
 
 
+    // emit every candidate of the last pattern vertex together with the prefix i0_id ... i{p_size-2}_id
+    std::string gen_code_emit(const PlanIR &plan, const VertexSetIR &op) {
+        int dep = plan.p_size - 1;
+        std::string tuple;
+        for (int prefix_dep = 0; prefix_dep < dep; prefix_dep++) {
+            tuple += fmt::format("i{}_id, ", prefix_dep);
+        }
+        return fmt::format(
+                "for (size_t i{dep}_idx = 0; i{dep}_idx < s{op_id}.size(); i{dep}_idx++) {left} if (!emb.push({left}{tuple}s{op_id}[i{dep}_idx]{right})) break; counter += 1; {right}\n",
+                fmt::arg("left", "{"),
+                fmt::arg("right", "}"),
+                fmt::arg("op_id", op.id),
+                fmt::arg("tuple", tuple),
+                fmt::arg("dep", dep));
+    }
+
+    // credit the s{op} subgraphs sharing the prefix i0_id ... i{p_size-2}_id to their vertices
+    std::string gen_code_local(const PlanIR &plan, const VertexSetIR &op) {
+        int dep = plan.p_size - 1;
+        std::string out = fmt::format("counter += s{}.size();", op.id);
+        for (int prefix_dep = 0; prefix_dep < dep; prefix_dep++) {
+            out += fmt::format(" lc.add(i{dep}_id, {orbit}, s{op_id}.size());",
+                               fmt::arg("dep", prefix_dep),
+                               fmt::arg("orbit", plan.orbits.at(prefix_dep)),
+                               fmt::arg("op_id", op.id));
+        }
+        out += fmt::format(" lc.add(s{}, {});\n", op.id, plan.orbits.at(dep));
+        return out;
+    }
+
+    // the last op either counts with the fused *_cnt kernel or materializes the set for enumeration/local counts
+    std::string gen_code_last_op(const PlanIR &plan, const VertexSetIR &op, const std::string &kernel,
+                                 const std::string &args) {
+        // multi-pattern plans add the count to the counter of every pattern ending at this loop
+        if (EnableBatch) return fmt::format("const uint64_t c{} = {}_cnt({});\n", op.id, kernel, args);
+        if (!EnableEnumeration && !EnableLocalCount) return fmt::format("counter += {}_cnt({});\n", kernel, args);
+        return fmt::format("VertexSet s{} = {}({});\n", op.id, kernel, args)
+               + gen_indent(op.loop_depth())
+               + (EnableEnumeration ? gen_code_emit(plan, op) : gen_code_local(plan, op));
+    }
+
+    // adjacency of the dep-th matched vertex restricted to the neighbors carrying `label` (-1 = all neighbors)
+    std::string gen_adj_name(int dep, int label) {
+        if (label == -1) return fmt::format("i{}_adj", dep);
+        return fmt::format("i{}_adj_l{}", dep, label);
+    }
+
+    // labels of the candidate sets computed at or below loop dep; one adjacency view of i{dep} is read per label
+    std::set<int> gen_adj_labels(const PlanIR &plan, int dep) {
+        std::set<int> out;
+        for (int op_dep = dep; op_dep < plan.p_size - 1; op_dep++) {
+            for (const auto &op: plan.set_ops.at(op_dep)) out.insert(op.label());
+        }
+        if (out.empty()) out.insert(-1);
+        return out;
+    }
+
+    /* brief Decide which loops test the vertices they iterate over against a CandidateFilter
+     * A loop is filtered if the degree and closed-wedge thresholds of its pattern vertex are estimated to drop at
+     * least 5% of the candidates (vertices for the root loop, edge endpoints for the others). The vertices counted
+     * by the last ops and the IEP sets are not filtered: they are only counted, never expanded.
+     * */
+    void plan_filters(const PlanIR &plan, const CodeGenConfig &config) {
+        LoopFilter.clear();
+        Filters.clear();
+        // the profiling backend has no filters; without the graph statistics there is no estimate of the selectivity
+        if (!config.candidateFilter || EnableProfling || !plan.meta.stats.collected) return;
+        constexpr double min_pruned = 0.05;
+        bool iep = config.adjMatType == AdjMatType::EdgeInducedIEP && plan.iep_num > 1;
+        int last_loop = iep ? plan.iep_depth : plan.p_size - 2;
+        LoopFilter.resize(plan.p_size, -1);
+        for (int dep = 0; dep <= last_loop; dep++) {
+            // every candidate is adjacent to a matched vertex, so a degree of one holds anyway
+            uint64_t min_degree = plan.degrees.at(dep) > 1 ? plan.degrees.at(dep) : 0;
+            uint64_t min_triangle = plan.triangles.at(dep);
+            if (min_degree == 0 && min_triangle == 0) continue;
+            if (plan.meta.stats.pruned_fraction(min_degree, min_triangle, dep > 0) < min_pruned) continue;
+            std::pair<uint64_t, uint64_t> threshold{min_degree, min_triangle};
+            auto itr = std::find(Filters.begin(), Filters.end(), threshold);
+            LoopFilter.at(dep) = itr - Filters.begin();
+            if (itr == Filters.end()) Filters.push_back(threshold);
+        }
+    }
+
+    // builds the candidate filters before matching
+    std::string gen_code_filters() {
+        if (Filters.empty()) return "";
+        std::string out = "\t\tctx.filters.clear();\n";
+        for (const auto &[min_degree, min_triangle]: Filters)
+            out += fmt::format("\t\tctx.filters.emplace_back(graph, {}, {});\n", min_degree, min_triangle);
+        return out;
+    }
+
     std::string gen_code_read_adj(const PlanIR &plan, int dep) {
-        std::string out;
+        std::vector<std::string> lines;
         if (EnableProfling) {
-            out += fmt::format("ctx.profiler->set_cur_loop({dep});\n", fmt::arg("dep", dep));
-            out += gen_indent(dep);
+            lines.push_back(fmt::format("ctx.profiler->set_cur_loop({dep});\n", fmt::arg("dep", dep)));
+        }
+        if (EnableEnumeration) {
+            lines.push_back("if (emb.done()) continue;\n");
+        }
+        if (dep == 0 && !plan.labels.empty()) {
+            // deeper vertices are label-filtered by the adjacency views, the root is checked here
+            lines.push_back(fmt::format("if (graph->Label(i0_id) != {}) continue;\n", plan.labels.at(0)));
+        }
+        if (dep == 0 && dep < (int) LoopFilter.size() && LoopFilter.at(dep) >= 0) {
+            lines.push_back(fmt::format("if (!ctx.filters[{}].test(i0_id)) continue;\n", LoopFilter.at(dep)));
         }
         bool NoAdjNeeded = true;
         if (CurConfig.pruningType == PruningType::None) {
@@ -284,18 +528,43 @@ namespace minigraph {
                 auto mg = plan.get_parent_mg(op);
                 NoAdjNeeded = NoAdjNeeded && mg.has_value();
             }
+            // sets without a parent subtract (remove) the adjacency lists of every earlier loop
+            for (int op_dep = dep + 1; op_dep < plan.p_size - 1; op_dep++) {
+                for (const auto &op: plan.set_ops.at(op_dep)) {
+                    NoAdjNeeded = NoAdjNeeded && plan.get_parent_vset(op).has_value();
+                }
+            }
         }
         if (dep > 0) {
             const VertexSetIR &iter = plan.iter_set.at(dep - 1);
-            out += fmt::format("const IdType i{dep}_id = s{iter_id}[i{dep}_idx];\n",
-                                                 fmt::arg("dep", dep),
-                                                 fmt::arg("iter_id", iter.id));
+            lines.push_back(fmt::format("const IdType i{dep}_id = s{iter_id}[i{dep}_idx];\n",
+                                        fmt::arg("dep", dep),
+                                        fmt::arg("iter_id", iter.id)));
+            if (dep < (int) LoopFilter.size() && LoopFilter.at(dep) >= 0) {
+                lines.push_back(fmt::format("if (!ctx.filters[{filter}].test(i{dep}_id)) continue;\n",
+                                            fmt::arg("filter", LoopFilter.at(dep)),
+                                            fmt::arg("dep", dep)));
+            }
         }
 
         if (!NoAdjNeeded) {
-            if (dep > 0) out += gen_indent(dep);
-            out += fmt::format("VertexSet i{dep}_adj = graph->N(i{dep}_id);\n",
-                                                 fmt::arg("dep", dep));
+            for (int label: gen_adj_labels(plan, dep)) {
+                if (label == -1) {
+                    lines.push_back(fmt::format("VertexSet {adj} = graph->N(i{dep}_id);\n",
+                                                fmt::arg("adj", gen_adj_name(dep, label)),
+                                                fmt::arg("dep", dep)));
+                } else {
+                    lines.push_back(fmt::format("VertexSet {adj} = graph->NL(i{dep}_id, {label});\n",
+                                                fmt::arg("adj", gen_adj_name(dep, label)),
+                                                fmt::arg("dep", dep),
+                                                fmt::arg("label", label)));
+                }
+            }
+        }
+        std::string out;
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (i > 0) out += gen_indent(dep);
+            out += lines.at(i);
         }
         return out;
     }
@@ -313,24 +582,76 @@ namespace minigraph {
         }
     }
 
+    // the set is only read by the set kernels: it is neither iterated nor the vertices of a MiniGraph nor an IEP set
+    bool read_by_kernels_only(const PlanIR &plan, const VertexSetIR &op) {
+        auto same = [&op](const VertexSetIR &vset) { return vset.id == op.id; };
+        if (std::any_of(plan.iter_set.begin(), plan.iter_set.end(), same)) return false;
+        if (std::any_of(plan.iep_set.begin(), plan.iep_set.end(), same)) return false;
+        for (const auto &mgs: plan.mg_ops) {
+            for (const auto &mg: mgs) {
+                if (same(mg.m_vertices) || same(mg.m_intersect)) return false;
+            }
+        }
+        return true;
+    }
+
+    /* brief Whether an EdgeInduced op is kept as a VertexSetView instead of a VertexSet
+     * Ops that drop matched vertices with remove() (and the sets bounded from them) record the dropped vertices in
+     * a view rather than copying the set, as long as only the set kernels read them. Sets that are iterated or
+     * indexed by MiniGraphs keep their positions and stay VertexSets.
+     * */
+    bool is_set_view(const PlanIR &plan, const VertexSetIR &op) {
+        if (VertexSetIR::adjMatType == AdjMatType::VertexInduced) return false;
+        if (EnableProfling || EnableBatch || EnableEnumeration || EnableLocalCount) return false;
+        // one excluded vertex per matched vertex, see VertexSetView::MAX_EXCLUDED
+        if (plan.p_size - 1 > 16) return false;
+        if (CurConfig.pruningType != PruningType::None && plan.get_parent_mg(op).has_value()) return false;
+        if (!read_by_kernels_only(plan, op)) return false;
+        int dep = op.loop_depth();
+        auto parent = plan.get_parent_vset(op);
+        if (!parent.has_value()) {
+            for (int subtract_id = 0; subtract_id < dep; subtract_id++) {
+                if (!op.is_restricted(subtract_id)) return true;
+            }
+            return false;
+        }
+        if (parent->loop_depth() == dep) return is_set_view(plan, parent.value());
+        if (op.is_edge(dep)) return false;
+        return !op.is_restricted(dep) || is_set_view(plan, parent.value());
+    }
+
+    std::string gen_set_type(const PlanIR &plan, const VertexSetIR &op) {
+        return is_set_view(plan, op) ? "VertexSetView" : "VertexSet";
+    }
+
     std::string gen_code_op(const PlanIR &plan, const VertexSetIR &op) {
         std::string out;
         auto parent = plan.get_parent_vset(op);
         int dep = op.loop_depth();
+        // intersect/subtract against the neighbors carrying the label of the candidates
+        std::string adj = gen_adj_name(dep, op.label());
         std::string upper_bound;
         if (op.is_restricted(op.loop_depth())) {
-            upper_bound = fmt::format(", i{}_adj.vid()", dep);
+            upper_bound = fmt::format(", {}.vid()", adj);
         }
         if (parent.has_value()) {
             CHECK(parent->loop_depth() + 1 >= op.loop_depth()) << "Not optimal parent";
+            // remove/bounded of a view is a view, copied only if this op has to be a VertexSet
+            bool parent_view = is_set_view(plan, parent.value());
+            std::string materialize = parent_view && !is_set_view(plan, op) ? ".materialize()" : "";
             // generate code from prefix
             if (parent->loop_depth() == op.loop_depth()) {
                 CHECK(op.is_restricted(op.loop_depth())) << "\nLogic error (op is not restricted at loop_depth)\nOP:\n"
                                                          << op << "\nParent:\n" << parent.value();
-                out += fmt::format("VertexSet s{op_id} = s{parent_id}.bounded(i{dep}_id);\n",
+                out += fmt::format("{type} s{op_id} = s{parent_id}.bounded(i{dep}_id){materialize};\n",
+                                   fmt::arg("type", gen_set_type(plan, op)),
                                    fmt::arg("op_id", op.id),
                                    fmt::arg("parent_id", parent->id),
-                                   fmt::arg("dep", dep));
+                                   fmt::arg("dep", dep),
+                                   fmt::arg("materialize", materialize));
+                // only multi-pattern plans have several ops (hence same-depth parents) at a counting loop
+                if (EnableBatch && plan.is_last_op(op))
+                    out += gen_indent(dep) + fmt::format("const uint64_t c{op_id} = s{op_id}.size();\n", fmt::arg("op_id", op.id));
 
             } else if (parent->loop_depth() == op.loop_depth() - 1) {
 
@@ -339,17 +660,16 @@ namespace minigraph {
                     if (!plan.is_last_op(op)) {
                         // intersect and return vertex set
                         out += fmt::format(
-                                "VertexSet s{op_id} = s{parent_id}.intersect(i{dep}_adj{upper_bound});\n",
+                                "VertexSet s{op_id} = s{parent_id}.intersect({adj}{upper_bound});\n",
                                 fmt::arg("op_id", op.id),
                                 fmt::arg("parent_id", parent->id),
                                 fmt::arg("dep", dep),
+                                fmt::arg("adj", adj),
                                 fmt::arg("upper_bound", upper_bound));
                     } else {
                         // intersect and return counter
-                        out += fmt::format("counter += s{parent_id}.intersect_cnt(i{dep}_adj{upper_bound});\n",
-                                           fmt::arg("parent_id", parent->id),
-                                           fmt::arg("dep", dep),
-                                           fmt::arg("upper_bound", upper_bound));
+                        out += gen_code_last_op(plan, op, fmt::format("s{}.intersect", parent->id),
+                                                adj + upper_bound);
                     }
                 } else {
                     if (VertexSetIR::adjMatType == minigraph::AdjMatType::VertexInduced) {
@@ -357,43 +677,44 @@ namespace minigraph {
                         if (!plan.is_last_op(op)) {
                             // last op: intersect and return vertex set
                             out += fmt::format(
-                                    "VertexSet s{op_id} = s{parent_id}.subtract(i{dep}_adj{upper_bound});\n",
+                                    "VertexSet s{op_id} = s{parent_id}.subtract({adj}{upper_bound});\n",
                                     fmt::arg("op_id", op.id),
                                     fmt::arg("parent_id", parent->id),
                                     fmt::arg("dep", dep),
+                                    fmt::arg("adj", adj),
                                     fmt::arg("upper_bound", upper_bound));
                         } else {
                             // intersect and return counter
-                            out += fmt::format("counter += s{parent_id}.subtract_cnt(i{dep}_adj{upper_bound});\n",
-                                               fmt::arg("parent_id", parent->id),
-                                               fmt::arg("dep", dep),
-                                               fmt::arg("upper_bound", upper_bound));
+                            out += gen_code_last_op(plan, op, fmt::format("s{}.subtract", parent->id),
+                                                    adj + upper_bound);
                         }
                     } else {
                         // EdgeInduced: remove v_iter
                         if (!plan.is_last_op(op)) {
+                            std::string source = fmt::format("s{}", parent->id);
+                            if (is_set_view(plan, op) && !parent_view) source = fmt::format("VertexSetView({})", source);
                             if (op.is_restricted(op.loop_depth())) {
-                                out += fmt::format("VertexSet s{op_id} = s{parent_id}.bounded(i{dep}_adj.vid());\n",
+                                out += fmt::format("{type} s{op_id} = {source}.bounded({adj}.vid()){materialize};\n",
+                                                   fmt::arg("type", gen_set_type(plan, op)),
                                                    fmt::arg("op_id", op.id),
-                                                   fmt::arg("parent_id", parent->id),
-                                                   fmt::arg("dep", dep));
+                                                   fmt::arg("source", source),
+                                                   fmt::arg("adj", adj),
+                                                   fmt::arg("materialize", materialize));
                             } else {
-                                out += fmt::format("VertexSet s{op_id} = s{parent_id}.remove(i{dep}_adj.vid());\n",
+                                out += fmt::format("{type} s{op_id} = {source}.remove({adj}.vid()){materialize};\n",
+                                                   fmt::arg("type", gen_set_type(plan, op)),
                                                    fmt::arg("op_id", op.id),
-                                                   fmt::arg("parent_id", parent->id),
-                                                   fmt::arg("dep", dep));
+                                                   fmt::arg("source", source),
+                                                   fmt::arg("adj", adj),
+                                                   fmt::arg("materialize", materialize));
                             }
                         } else {
                             if (op.is_restricted(op.loop_depth())) {
-                                out += fmt::format("counter += s{parent_id}.bounded_cnt(i{dep}_adj.vid());\n",
-                                                   fmt::arg("op_id", op.id),
-                                                   fmt::arg("parent_id", parent->id),
-                                                   fmt::arg("dep", dep));
+                                out += gen_code_last_op(plan, op, fmt::format("s{}.bounded", parent->id),
+                                                        adj + ".vid()");
                             } else {
-                                out += fmt::format("counter += s{parent_id}.remove_cnt(i{dep}_adj.vid());\n",
-                                                   fmt::arg("op_id", op.id),
-                                                   fmt::arg("parent_id", parent->id),
-                                                   fmt::arg("dep", dep));
+                                out += gen_code_last_op(plan, op, fmt::format("s{}.remove", parent->id),
+                                                        adj + ".vid()");
                             }
                         }
                     }
@@ -405,31 +726,69 @@ namespace minigraph {
             CHECK(op.edge_num() == 1 && op.is_edge(op.loop_depth()))
                 << "\nLogic error: VertexSetIR should have one parent but get none\n" << op;
 
+            if (VertexSetIR::adjMatType == AdjMatType::VertexInduced && dep > 1 && !EnableProfling) {
+                // subtract all the earlier adjacency lists in one pass instead of a pooled set per subtraction
+                std::string others, upper_bound;
+                int num_bounds = 0;
+                if (op.is_restricted(dep)) {
+                    upper_bound = fmt::format("i{}_id", dep);
+                    num_bounds++;
+                }
+                for (int subtract_id = 0; subtract_id < dep; subtract_id++) {
+                    std::string subtract_adj = gen_adj_name(subtract_id, op.label());
+                    others += ", " + subtract_adj;
+                    if (op.is_restricted(subtract_id)) {
+                        upper_bound += (num_bounds > 0 ? ", " : "") + subtract_adj + ".vid()";
+                        num_bounds++;
+                    }
+                }
+                if (num_bounds == 0) upper_bound = "INVALID_ID";
+                if (num_bounds > 1) upper_bound = "std::min({" + upper_bound + "})";
+                if (plan.is_last_op(op)) return gen_code_last_op(plan, op, adj + ".subtract_union", upper_bound + others);
+                out += fmt::format("VertexSet s{op_id} = {adj}.subtract_union({upper_bound}{others});\n",
+                                   fmt::arg("op_id", op.id),
+                                   fmt::arg("adj", adj),
+                                   fmt::arg("upper_bound", upper_bound),
+                                   fmt::arg("others", others));
+                if (!EnableBatch)
+                    out += gen_indent(dep) + fmt::format("if (s{op_id}.size() == 0) continue;\n", fmt::arg("op_id", op.id));
+                return out;
+            }
+
+            // chained VertexSet::remove() calls may return a set pointing into the pooled temporary of the previous
+            // one, so sets that drop matched vertices are built as a view and copied once if they must be a VertexSet
+            bool removes = false;
+            for (int subtract_id = 0; subtract_id < dep; subtract_id++) {
+                removes = removes || (VertexSetIR::adjMatType != AdjMatType::VertexInduced && !op.is_restricted(subtract_id));
+            }
+            removes = removes && !EnableProfling;
+            std::string source = removes ? fmt::format("VertexSetView({})", adj) : adj;
             if (op.is_restricted(op.loop_depth())) {
-                out += fmt::format("VertexSet s{op_id} = i{dep}_adj.bounded(i{dep}_id)",
+                out += fmt::format("{type} s{op_id} = {source}.bounded(i{dep}_id)",
+                                   fmt::arg("type", gen_set_type(plan, op)),
                                    fmt::arg("op_id", op.id),
+                                   fmt::arg("source", source),
                                    fmt::arg("dep", dep));
             } else {
-                out += fmt::format("VertexSet s{op_id} = i{dep}_adj",
+                out += fmt::format("{type} s{op_id} = {source}",
+                                   fmt::arg("type", gen_set_type(plan, op)),
                                    fmt::arg("op_id", op.id),
-                                   fmt::arg("dep", dep));
+                                   fmt::arg("source", source));
             }
 
             for (int subtract_id = 0; subtract_id < dep; subtract_id++) {
                 if (VertexSetIR::adjMatType == minigraph::AdjMatType::VertexInduced) {
                     std::string subtract_bound;
                     if (op.is_restricted(subtract_id)) {
-                        subtract_bound = fmt::format(", i{}_adj.vid()", subtract_id);
+                        subtract_bound = fmt::format(", {}.vid()", gen_adj_name(subtract_id, op.label()));
                     }
 //                    out += fmt::format("s{op_id} = s{op_id}.subtract(i{subtract_id}_adj{upper_bound});\n",
 //                                   fmt::arg("op_id", op.id),
 //                                   fmt::arg("iter_id", dep),
 //                                   fmt::arg("subtract_id", subtract_id),
 //                                   fmt::arg("upper_bound", subtract_bound));
-                    out += fmt::format(".subtract(i{subtract_id}_adj{upper_bound})",
-                                       fmt::arg("op_id", op.id),
-                                       fmt::arg("iter_id", dep),
-                                       fmt::arg("subtract_id", subtract_id),
+                    out += fmt::format(".subtract({subtract_adj}{upper_bound})",
+                                       fmt::arg("subtract_adj", gen_adj_name(subtract_id, op.label())),
                                        fmt::arg("upper_bound", subtract_bound));
 
                 } else { // EdgeInduced
@@ -438,26 +797,26 @@ namespace minigraph {
 //                                           fmt::arg("op_id", op.id),
 //                                           fmt::arg("iter_id", dep),
 //                                           fmt::arg("subtract_id", subtract_id));
-                        out += fmt::format(".bounded(i{subtract_id}_adj.vid())",
-                                           fmt::arg("op_id", op.id),
-                                           fmt::arg("iter_id", dep),
-                                           fmt::arg("subtract_id", subtract_id));
+                        out += fmt::format(".bounded({}.vid())", gen_adj_name(subtract_id, op.label()));
                     } else {
 //                        out += fmt::format("s{op_id} = s{op_id}.remove(i{subtract_id}_adj.vid());\n",
 //                                           fmt::arg("op_id", op.id),
 //                                           fmt::arg("iter_id", dep),
 //                                           fmt::arg("subtract_id", subtract_id));
-                        out += fmt::format(".remove(i{subtract_id}_adj.vid())",
-                                           fmt::arg("op_id", op.id),
-                                           fmt::arg("iter_id", dep),
-                                           fmt::arg("subtract_id", subtract_id));
+                        out += fmt::format(".remove({}.vid())", gen_adj_name(subtract_id, op.label()));
                     }
                 }
             }
+            if (removes && !is_set_view(plan, op)) out += ".materialize()";
             out += ";\n";
-            out += gen_indent(dep) + fmt::format("if (s{op_id}.size() == 0) continue;\n", fmt::arg("op_id", op.id));
+            // an empty set only ends the iteration if every op of this loop belongs to the same pattern
+            if (!EnableBatch)
+                out += gen_indent(dep) + fmt::format("if (s{op_id}.size() == 0) continue;\n", fmt::arg("op_id", op.id));
             if (plan.is_last_op(op)) {
-                out += fmt::format("counter += s{op_id}.size();\n", fmt::arg("op_id", op.id));
+                if (EnableBatch) out += gen_indent(dep) + fmt::format("const uint64_t c{op_id} = s{op_id}.size();\n", fmt::arg("op_id", op.id));
+                else if (EnableEnumeration) out += gen_indent(dep) + gen_code_emit(plan, op);
+                else if (EnableLocalCount) out += gen_indent(dep) + gen_code_local(plan, op);
+                else out += gen_indent(dep) + fmt::format("counter += s{op_id}.size();\n", fmt::arg("op_id", op.id));
             }
         }
 
@@ -483,51 +842,123 @@ namespace minigraph {
         return false;
     }
 
+    /* brief Parent of a last op that counts the intersection (difference) of two adjacency lists of one MiniGraph
+     * The parent is read directly from the MiniGraph the op is pruned by, so both operands are rows of a
+     * MiniGraphBitset and the count is a popcount over its local index space.
+     * */
+    std::optional<VertexSetIR> bitset_parent(const PlanIR &plan, const VertexSetIR &op) {
+        if (EnableProfling || EnableBatch || EnableEnumeration || EnableLocalCount) return {};
+        if (plan.iep_num > 0 || !plan.labels.empty() || !plan.is_last_op(op) || op.loop_depth() == 0) return {};
+        std::optional<MiniGraphIR> mg = plan.get_parent_mg(op);
+        if (!mg.has_value() || !mg_should_eager(plan, mg.value())) return {};
+        if (mg->computed(plan.iter_set.at(op.loop_depth() - 1), op)) return {};
+        std::optional<VertexSetIR> parent = plan.get_parent_vset(op);
+        if (!parent.has_value() || parent->loop_depth() == 0) return {};
+        std::optional<MiniGraphIR> parent_mg = plan.get_parent_mg(parent.value());
+        if (!parent_mg.has_value() || !(parent_mg.value() == mg.value())) return {};
+        if (!mg->computed(plan.iter_set.at(parent->loop_depth() - 1), parent.value())) return {};
+        return parent;
+    }
+
+    bool is_bitset_parent(const PlanIR &plan, const VertexSetIR &vset) {
+        for (const auto &ops: plan.set_ops) {
+            for (const auto &op: ops) {
+                auto parent = bitset_parent(plan, op);
+                if (parent.has_value() && parent.value() == vset) return true;
+            }
+        }
+        return false;
+    }
+
+    bool mg_use_bitset(const PlanIR &plan, const MiniGraphIR &mg) {
+        for (const auto &ops: plan.set_ops) {
+            for (const auto &op: ops) {
+                if (bitset_parent(plan, op).has_value() && plan.get_parent_mg(op).value() == mg) return true;
+            }
+        }
+        return false;
+    }
+
+    // concrete MiniGraph type: template on the bounded-ness and on the type of the MiniGraph it is pruned from
     std::string gen_mg_type(const PlanIR& plan, const MiniGraphIR &mg) {
-        return mg_should_eager(plan, mg) ? "MiniGraphEager" : "MiniGraphType";
+        std::string mg_class;
+        if (mg_use_bitset(plan, mg)) {
+            mg_class = "MiniGraphBitset";
+        } else if (mg_should_eager(plan, mg)) {
+            mg_class = "MiniGraphEager";
+        } else {
+            switch (CurConfig.pruningType) {
+                case (PruningType::Static):
+                    mg_class = "MiniGraphLazy";
+                    break;
+                case (PruningType::Online):
+                    mg_class = "MiniGraphOnline";
+                    break;
+                case (PruningType::CostModel):
+                    mg_class = "MiniGraphCostModel";
+                    break;
+                default:
+                    mg_class = "MiniGraphEager";
+                    break;
+            }
+        }
+        std::optional<MiniGraphIR> parent_mg = plan.get_parent_mg(mg);
+        std::string parent_type = parent_mg.has_value() ? gen_mg_type(plan, parent_mg.value()) : "void";
+        return fmt::format("{}<{}, {}>", mg_class, plan.is_bounded(mg), parent_type);
     }
 
     std::string gen_code_mg_init(const PlanIR &plan, const MiniGraphIR &mg) {
 //        const VertexSetIR &iter = plan.iter_set.at(mg.loop_depth());
         std::string mgType = gen_mg_type(plan, mg);
-        return fmt::format("{mg_type} m{mg_id}({_bounded},{_par});\n",
+        return fmt::format("{mg_type} m{mg_id}({_par});\n",
                            fmt::arg("mg_id", mg.id),
                            fmt::arg("mg_type", mgType),
-                           fmt::arg("_bounded", plan.is_bounded(mg)),
                            fmt::arg("_par", plan.is_par(mg)));
     }
 
+    /* brief The MiniGraph whose index map in the set iterated by the loop-th loop is used for mg
+     * MiniGraphs with the same vertices have the same map, so it is computed once per iteration, for the first of
+     * them in plan.mg_used.
+     * */
+    const MiniGraphIR &indices_owner(const PlanIR &plan, const MiniGraphIR &mg, int loop) {
+        for (const auto &other: plan.mg_used.at(loop)) {
+            if (other.vset_id() == mg.vset_id()) return other;
+        }
+        return mg;
+    }
+
+    bool is_indices_owner(const PlanIR &plan, const MiniGraphIR &mg, int loop) {
+        return indices_owner(plan, mg, loop).id == mg.id;
+    }
+
+    // index of the dep-th matched vertex in the vertices of mg
+    std::string gen_mg_adj_idx(const PlanIR &plan, const MiniGraphIR &mg, int dep) {
+        const VertexSetIR &iter = plan.iter_set.at(dep - 1);
+        auto &vertices = mg.m_vertices;
+        bool same_address = true;
+        if (iter.loop_depth() == vertices.loop_depth()) {
+            for (int i = 0; i <= iter.loop_depth(); i++) {
+                if (iter.is_edge(i) != vertices.is_edge(i)) same_address = false;
+            }
+        } else {
+            same_address = false;
+        }
+        if (same_address) return fmt::format("i{dep}_idx", fmt::arg("dep", dep));
+        return fmt::format("m{mg_id}_s{iter_id}[i{dep}_idx]",
+                           fmt::arg("mg_id", indices_owner(plan, mg, dep).id),
+                           fmt::arg("iter_id", iter.id),
+                           fmt::arg("dep", dep));
+    }
+
     std::string gen_code_mg_adj(const PlanIR &plan, int dep, int indent_dep = -1) {
         if (dep == 0) return "";
         std::string indent = (indent_dep == -1) ? gen_indent(dep) : gen_indent_tbb(dep);
-        const VertexSetIR &iter = plan.iter_set.at(dep - 1);
         std::string out;
         for (const auto &mg: plan.mg_used.at(dep)) {
-            auto &vertices = mg.m_vertices;
-            bool same_address = true;
-            if (iter.loop_depth() == vertices.loop_depth()) {
-                for (int i = 0; i <= iter.loop_depth(); i++) {
-                    if (iter.is_edge(i) != vertices.is_edge(i)) same_address = false;
-                }
-            } else {
-                same_address = false;
-            }
-
-            if (same_address) {
-                out += indent;
-                out += fmt::format("VertexSet m{mg_id}_adj = m{mg_id}.N(i{dep}_idx);\n",
-                                   fmt::arg("mg_id", mg.id),
-                                   fmt::arg("dep", dep));
-            } else {
-                std::string v_idx = fmt::format("m{mg_id}_s{iter_id}[i{dep}_idx]",
-                                                fmt::arg("mg_id", mg.id),
-                                                fmt::arg("iter_id", iter.id),
-                                                fmt::arg("dep", dep));
-                out += indent;
-                out += fmt::format("VertexSet m{mg_id}_adj = m{mg_id}.N({v_idx});\n",
-                                   fmt::arg("mg_id", mg.id),
-                                   fmt::arg("v_idx", v_idx));
-            }
+            out += indent;
+            out += fmt::format("VertexSet m{mg_id}_adj = m{mg_id}.N({v_idx});\n",
+                               fmt::arg("mg_id", mg.id),
+                               fmt::arg("v_idx", gen_mg_adj_idx(plan, mg, dep)));
         }
         return out;
     }
@@ -549,12 +980,30 @@ namespace minigraph {
         if (skip_build_indices(plan, mg, iter))
             return fmt::format("//skip building indices for m{mg_id} because they can be obtained directly\n",
                                fmt::arg("mg_id", mg.id)); // skip
+        else if (!is_indices_owner(plan, mg, dep + 1))
+            return fmt::format("//m{mg_id} shares the indices of m{owner_id} in s{iter_id}\n",
+                               fmt::arg("mg_id", mg.id),
+                               fmt::arg("owner_id", indices_owner(plan, mg, dep + 1).id),
+                               fmt::arg("iter_id", iter.id));
         else
             return fmt::format("auto m{mg_id}_s{iter_id} = m{mg_id}.indices(s{iter_id});\n",
                                fmt::arg("mg_id", mg.id),
                                fmt::arg("iter_id", iter.id));
     };
 
+    // name of the index map of parent in the vertices of mg if the plan computes it before building mg, else ""
+    std::string gen_shared_parent_indices(const PlanIR &plan, const MiniGraphIR &mg, const MiniGraphIR &parent) {
+        int dep = mg.loop_depth();
+        const VertexSetIR &iter = plan.iter_set.at(dep);
+        if (mg.vset_id() != iter.id || parent.loop_depth() >= dep) return "";
+        if (skip_build_indices(plan, parent, iter)) return "";
+        for (const auto &used: plan.mg_used.at(dep + 1)) {
+            if (used.id == parent.id)
+                return fmt::format("m{}_s{}", indices_owner(plan, parent, dep + 1).id, iter.id);
+        }
+        return "";
+    }
+
     std::string gen_code_mg_est_visits(const PlanIR &plan, const MiniGraphIR &mg, int iter_dep) {
         int iter_id = plan.iter_set.at(mg.loop_depth()).id;
         std::string out = fmt::format("s{}.size()", iter_id);
@@ -564,6 +1013,12 @@ namespace minigraph {
             if (parent.has_value()) {
                 double p1 = 1.0 * plan.meta.num_edge / plan.meta.num_vertex / plan.meta.num_vertex;
                 double p2 = 1.0 * plan.meta.num_triangle * 6 * plan.meta.num_vertex / plan.meta.num_edge / plan.meta.num_edge;
+                if (plan.meta.stats.collected) {
+                    // matched vertices are at most a few hops apart, where neighborhoods overlap far more than in a
+                    // uniform random graph
+                    p1 = plan.meta.stats.wedge_closure();
+                    p2 = plan.meta.stats.edge_closure();
+                }
                 double rate = 1.0;
                 for (int adj_dep = mg.loop_depth(); adj_dep < cur_iter.loop_depth(); adj_dep++){
                     auto &adj_iter = plan.iter_set.at(adj_dep);
@@ -579,6 +1034,7 @@ namespace minigraph {
                                    fmt::arg("rate", rate));
             } else {
                 double avg_deg = 1.0 * plan.meta.num_edge / plan.meta.num_vertex;
+                if (plan.meta.stats.collected) avg_deg = plan.meta.stats.edge_degree();
                 out += fmt::format(" * {}", avg_deg);
             }
         }
@@ -617,15 +1073,24 @@ namespace minigraph {
                 // assert(total_reuse > 0);
                 out += factor;
                 out += gen_indent(mg.loop_depth());
-                out += fmt::format("m{mg_id}.set_reuse_multiplier(m{mg_id}_factor); ",
-                                   fmt::arg("mg_id", mg.id));
+                // profiling plans report the uncorrected estimate, it is what calibrate compares the observed visits to
+                double reuse_scale = EnableProfling ? 1.0 : plan.meta.cost.reuse_scale;
+                if (reuse_scale != 1.0) {
+                    out += fmt::format("m{mg_id}.set_reuse_multiplier(m{mg_id}_factor * {reuse_scale}); ",
+                                       fmt::arg("mg_id", mg.id), fmt::arg("reuse_scale", reuse_scale));
+                } else {
+                    out += fmt::format("m{mg_id}.set_reuse_multiplier(m{mg_id}_factor); ",
+                                       fmt::arg("mg_id", mg.id));
+                }
         }
 
         if (parent_mg.has_value()) {
-            out += fmt::format("m{mg_id}.build(&m{parent_id}, s{vset_id}, s{vint_id}, s{iter_id});\n",
+            std::string shared = gen_shared_parent_indices(plan, mg, parent_mg.value());
+            out += fmt::format("m{mg_id}.build(&m{parent_id}, s{vset_id}, s{vint_id}, s{iter_id}{shared});\n",
                                fmt::arg("parent_id", parent_mg->id),
                                fmt::arg("mg_id", mg.id), fmt::arg("vset_id", mg.vset_id()),
-                               fmt::arg("vint_id", mg.vint_id()), fmt::arg("iter_id", iter_id));
+                               fmt::arg("vint_id", mg.vint_id()), fmt::arg("iter_id", iter_id),
+                               fmt::arg("shared", shared.empty() ? "" : ", &" + shared));
         } else {
             out += fmt::format("m{mg_id}.build(s{vset_id}, s{vint_id}, s{iter_id});\n",
                                fmt::arg("mg_id", mg.id), fmt::arg("vset_id", mg.vset_id()),
@@ -634,6 +1099,90 @@ namespace minigraph {
         return out;
     };
 
+    /* brief Probes of analyze plans are numbered by set op id, then MiniGraph id, then the IEP block
+     * explain_plan maps the statistics back to the plan with the same numbering.
+     * */
+    int num_set_probes(const PlanIR &plan) {
+        int out = 0;
+        for (const auto &ops: plan.set_ops) {
+            for (const auto &op: ops) out = std::max(out, op.id + 1);
+        }
+        return out;
+    }
+
+    int mg_probe(const PlanIR &plan, const MiniGraphIR &mg) { return num_set_probes(plan) + mg.id; }
+
+    int iep_probe(const PlanIR &plan) {
+        int num_mg = 0;
+        for (const auto &mgs: plan.mg_ops) {
+            for (const auto &mg: mgs) num_mg = std::max(num_mg, mg.id + 1);
+        }
+        return num_set_probes(plan) + num_mg;
+    }
+
+    // times code (whose first line is indented by the caller) in analyze plans
+    std::string gen_code_probe(int probe, const std::string &input, const std::string &code, const std::string &output,
+                               const std::string &indent) {
+        if (!EnableAnalyze) return code;
+        return fmt::format("OpProbe probe{id}(an, {id}, {input}, counter.count);\n", fmt::arg("id", probe),
+                           fmt::arg("input", input))
+               + indent + code
+               + indent + fmt::format("probe{id}.done({output});\n", fmt::arg("id", probe), fmt::arg("output", output));
+    }
+
+    // an op starts from its parent, or from the adjacency list of the vertex matched at its loop
+    std::string gen_code_probe(const PlanIR &plan, const VertexSetIR &op, const std::string &code) {
+        auto parent = plan.get_parent_vset(op);
+        std::string input = parent.has_value() ? fmt::format("s{}.size()", parent->id)
+                                               : fmt::format("{}.size()", gen_adj_name(op.loop_depth(), op.label()));
+        std::string output = plan.is_last_op(op) ? fmt::format("counter.count - probe{}.start_count", op.id)
+                                                 : fmt::format("s{}.size()", op.id);
+        return gen_code_probe(op.id, input, code, output, gen_indent(op.loop_depth()));
+    }
+
+    /* brief The MiniGraphs built at dep and the index maps used by the next loop
+     * The maps of the MiniGraphs built before dep come first, so the builds from them can share the maps.
+     * */
+    std::string gen_code_mg_depth(const PlanIR &plan, int dep, const std::string &indent) {
+        std::ostringstream out;
+        auto built_here = [&plan, dep](const MiniGraphIR &mg) {
+            for (const auto &op: plan.mg_ops.at(dep)) {
+                if (op.id == mg.id) return true;
+            }
+            return false;
+        };
+        for (const auto &mg: plan.mg_used.at(dep + 1)) {
+            if (!built_here(mg)) out << indent << gen_code_mg_indice(plan, mg, dep);
+        }
+        for (const auto &mg: plan.mg_ops.at(dep)) {
+            out << indent << gen_code_mg_init(plan, mg);
+            out << indent << mg;
+            out << indent << gen_code_probe(mg_probe(plan, mg), fmt::format("s{}.size()", mg.vset_id()),
+                                            gen_code_mg_build(plan, mg), fmt::format("s{}.size()", mg.vint_id()), indent);
+        }
+        for (const auto &mg: plan.mg_used.at(dep + 1)) {
+            if (built_here(mg)) out << indent << gen_code_mg_indice(plan, mg, dep);
+        }
+        return out.str();
+    }
+
+    std::string gen_code_bitset_cnt(const PlanIR &plan, const VertexSetIR &op, const MiniGraphIR &mg,
+                                    const VertexSetIR &parent, const std::string &kernel, const std::string &upper_bound) {
+        std::string limit = fmt::format("s{}_lim", parent.id);
+        if (op.is_restricted(op.loop_depth())) {
+            limit = fmt::format("std::min(s{parent_id}_lim, m{mg_id}.local_bound(m{mg_id}_adj.vid()))",
+                                fmt::arg("parent_id", parent.id), fmt::arg("mg_id", mg.id));
+        }
+        return fmt::format("counter += m{mg_id}.has_bits() ? m{mg_id}.{kernel}_cnt(s{parent_id}_row, {row}, {limit})"
+                           " : s{parent_id}.{kernel}_cnt(m{mg_id}_adj{upper_bound});\n",
+                           fmt::arg("mg_id", mg.id),
+                           fmt::arg("kernel", kernel),
+                           fmt::arg("parent_id", parent.id),
+                           fmt::arg("row", gen_mg_adj_idx(plan, mg, op.loop_depth())),
+                           fmt::arg("limit", limit),
+                           fmt::arg("upper_bound", upper_bound));
+    }
+
     std::string gen_code_mg_op(const PlanIR &plan, const VertexSetIR &op) {
         std::optional<MiniGraphIR> mg = plan.get_parent_mg(op);
         if (!mg.has_value()) return gen_code_op(plan, op);
@@ -660,6 +1209,16 @@ namespace minigraph {
 
             CHECK(!plan.is_last_op(op))
                 << "\nLogic error (vset should not be the last op if it can be read directly from a pruned graph)";
+            if (is_bitset_parent(plan, op)) {
+                // later ops count with the bitset row and the local bound of this set
+                std::string limit = op.is_restricted(op.loop_depth())
+                                    ? fmt::format("m{}.local_bound(i{}_id)", mg->id, dep)
+                                    : fmt::format("m{}.local_size()", mg->id);
+                out += gen_indent(dep) + fmt::format("const IdType s{op_id}_row = {row}; const size_t s{op_id}_lim = {limit};\n",
+                                                     fmt::arg("op_id", op.id),
+                                                     fmt::arg("row", gen_mg_adj_idx(plan, mg.value(), dep)),
+                                                     fmt::arg("limit", limit));
+            }
         } else if (op.is_edge(op.loop_depth())) {
             std::string upper_bound;
             if (op.is_restricted(op.loop_depth())) {
@@ -673,12 +1232,13 @@ namespace minigraph {
                         fmt::arg("parent_id", parent->id),
                         fmt::arg("mg_id", mg->id),
                         fmt::arg("upper_bound", upper_bound));
+            } else if (bitset_parent(plan, op).has_value()) {
+                // intersect and return counter: popcount of two bitset rows of the MiniGraph
+                out += gen_code_bitset_cnt(plan, op, mg.value(), parent.value(), "intersect", upper_bound);
             } else {
                 // intersect and return counter
-                out += fmt::format("counter += s{parent_id}.intersect_cnt(m{mg_id}_adj{upper_bound});\n",
-                                   fmt::arg("parent_id", parent->id),
-                                   fmt::arg("mg_id", mg->id),
-                                   fmt::arg("upper_bound", upper_bound));
+                out += gen_code_last_op(plan, op, fmt::format("s{}.intersect", parent->id),
+                                        fmt::format("m{}_adj{}", mg->id, upper_bound));
             }
         } else {
             // VertexInduced: subtraction | EdgeInduced: remove one (should not arrive here)
@@ -696,12 +1256,13 @@ namespace minigraph {
                         fmt::arg("parent_id", parent->id),
                         fmt::arg("mg_id", mg->id),
                         fmt::arg("upper_bound", upper_bound));
+            } else if (bitset_parent(plan, op).has_value()) {
+                // subtract and return counter: popcount of two bitset rows of the MiniGraph
+                out += gen_code_bitset_cnt(plan, op, mg.value(), parent.value(), "subtract", upper_bound);
             } else {
                 // subtract and return counter
-                out += fmt::format("counter += s{parent_id}.subtract_cnt(m{mg_id}_adj{upper_bound});\n",
-                                   fmt::arg("parent_id", parent->id),
-                                   fmt::arg("mg_id", mg->id),
-                                   fmt::arg("upper_bound", upper_bound));
+                out += gen_code_last_op(plan, op, fmt::format("s{}.subtract", parent->id),
+                                        fmt::format("m{}_adj{}", mg->id, upper_bound));
             }
         }
         if (!plan.is_last_op(op))
@@ -709,44 +1270,6 @@ namespace minigraph {
         return out;
     };
 
-    std::string gen_code_iep(const PlanIR &plan, size_t group_id) {
-        int val = plan.iep_vals.at(group_id);
-        const auto &group = plan.iep_groups.at(group_id);
-        std::string out = fmt::format("counter += {}ll", val);
-        for (size_t set_id = 0; set_id < group.size(); set_id++) {
-            const auto &set = group.at(set_id);
-            if (set.size() == 1) {
-                int set_id = set.at(0);
-                const VertexSetIR &left = plan.iep_set.at(set_id);
-                out += fmt::format(" * s{left_id}.size()",
-                                   fmt::arg("left_id", left.id));
-            } else if (set.size() == 2) {
-                const VertexSetIR &left = plan.iep_set.at(set.at(0));
-                const VertexSetIR &right = plan.iep_set.at(set.at(1));
-                if (left == right) {
-                    out += fmt::format(" * s{left_id}.size()",
-                                       fmt::arg("left_id", left.id));
-                } else {
-                    out += fmt::format(" * s{left_id}.intersect_cnt(s{right_id})",
-                                       fmt::arg("left_id", left.id),
-                                       fmt::arg("right_id", right.id));
-                }
-
-            } else {
-                const VertexSetIR &left = plan.iep_set.at(set.at(0));
-                out += fmt::format(" * s{left_id}", fmt::arg("left_id", left.id));
-                for (size_t i = 1; i < set.size() - 1; ++i) {
-                    const VertexSetIR &right = plan.iep_set.at(set.at(i));
-                    out += fmt::format(".intersect(s{right_id})", fmt::arg("right_id", right.id));
-                }
-                const VertexSetIR &right = plan.iep_set.at(set.at(set.size() - 1));
-                out += fmt::format(".intersect_cnt(s{right_id})", fmt::arg("right_id", right.id));
-            }
-        }
-        out += ";\n";
-        return out;
-    }
-
     std::string gen_comment_iep(const PlanIR &plan, size_t group_id) {
         int val = plan.iep_vals.at(group_id);
         std::string group_str, comp_str;
@@ -775,6 +1298,130 @@ namespace minigraph {
                            fmt::arg("val", val), fmt::arg("group_str", group_str), fmt::arg("compute_str", comp_str));
     }
 
+    /* brief Counting statements of the IEP groups, with every distinct intersection of the IEP sets computed once
+     * The subsets are the factors of all groups, by the ids of their sets (equal IEP sets collapse). A subset of 2+
+     * sets is counted as |T & s| from a materialized subset T of one set less, preferring a T that another factor
+     * materializes already; the materialized subsets are built the same way from smaller ones. The intersections
+     * are evaluated once per iteration of the IEP loop, before the groups multiply them.
+     * */
+    std::string gen_code_iep(const PlanIR &plan, const std::string &indent) {
+        typedef std::vector<int> Subset; // sorted ids of the IEP sets
+        auto to_subset = [&plan](const std::vector<int> &set) {
+            Subset out;
+            for (int set_id: set) out.push_back(plan.iep_set.at(set_id).id);
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+            return out;
+        };
+        auto smaller = [](const Subset &l, const Subset &r) {
+            return l.size() < r.size() || (l.size() == r.size() && l < r);
+        };
+        std::set<Subset, decltype(smaller)> counted(smaller);
+        for (const auto &group: plan.iep_groups) {
+            for (const auto &set: group) {
+                Subset subset = to_subset(set);
+                if (subset.size() > 1) counted.insert(subset);
+            }
+        }
+
+        // base[S]: the subset S is computed from, one set less
+        std::map<Subset, Subset> base;
+        std::set<Subset, decltype(smaller)> materialized(smaller);
+        std::function<void(const Subset &)> add_base = [&](const Subset &subset) {
+            if (subset.size() <= 2 || base.count(subset)) return;
+            Subset choice;
+            for (size_t i = subset.size(); i-- > 0 && choice.empty();) {
+                Subset rest = subset;
+                rest.erase(rest.begin() + i);
+                if (materialized.count(rest)) choice = rest;
+            }
+            if (choice.empty()) {
+                choice = Subset(subset.begin(), subset.end() - 1);
+                add_base(choice);
+                materialized.insert(choice);
+            }
+            base[subset] = choice;
+        };
+        for (const Subset &subset: counted) add_base(subset);
+
+        std::map<Subset, std::string> names;
+        std::ostringstream out;
+        // the ids missing from base[subset] (exactly one)
+        auto last = [&base](const Subset &subset) {
+            Subset rest;
+            const Subset &from = base.at(subset);
+            std::set_difference(subset.begin(), subset.end(), from.begin(), from.end(), std::back_inserter(rest));
+            return rest.at(0);
+        };
+        for (const Subset &subset: materialized) {
+            std::string name = fmt::format("iep_s{}", names.size());
+            if (subset.size() == 2) {
+                out << indent << fmt::format("VertexSet {} = s{}.intersect(s{});\n", name, subset.at(0), subset.at(1));
+            } else {
+                out << indent << fmt::format("VertexSet {} = {}.intersect(s{});\n", name, names.at(base.at(subset)),
+                                             last(subset));
+            }
+            names[subset] = name;
+        }
+        std::map<Subset, std::string> counts;
+        for (const Subset &subset: counted) {
+            if (materialized.count(subset)) {
+                counts[subset] = names.at(subset) + ".size()";
+                continue;
+            }
+            std::string name = fmt::format("iep_c{}", counts.size());
+            if (subset.size() == 2) {
+                out << indent << fmt::format("const size_t {} = s{}.intersect_cnt(s{});\n", name, subset.at(0),
+                                             subset.at(1));
+            } else {
+                out << indent << fmt::format("const size_t {} = {}.intersect_cnt(s{});\n", name,
+                                             names.at(base.at(subset)), last(subset));
+            }
+            counts[subset] = name;
+        }
+
+        for (size_t group_id = 0; group_id < plan.iep_groups.size(); group_id++) {
+            out << indent << fmt::format("counter += {}ll", plan.iep_vals.at(group_id));
+            for (const auto &set: plan.iep_groups.at(group_id)) {
+                Subset subset = to_subset(set);
+                if (subset.size() == 1) out << fmt::format(" * s{}.size()", subset.at(0));
+                else out << " * " << counts.at(subset);
+            }
+            out << ";\n";
+            out << indent << gen_comment_iep(plan, group_id);
+        }
+        return out.str();
+    }
+
+    // the IEP block of an analyze plan is one probe, which starts from the sets it intersects
+    std::string gen_code_iep_probe(const PlanIR &plan, int dep) {
+        std::string indent = gen_indent(dep);
+        std::string code = gen_code_iep(plan, indent);
+        if (!EnableAnalyze) return code;
+        std::set<int> ids;
+        for (const auto &vset: plan.iep_set) ids.insert(vset.id);
+        std::string input;
+        for (int id: ids) input += (input.empty() ? "" : " + ") + fmt::format("s{}.size()", id);
+        return indent + gen_code_probe(iep_probe(plan), input, code.substr(indent.size()),
+                                       fmt::format("counter.count - probe{}.start_count", iep_probe(plan)), indent);
+    }
+
+    // per-element costs of MiniGraphCostModel::should_prune calibrated for the graph (see calibrate)
+    std::string gen_code_cost_params(const PlanIR &plan) {
+        if (CurConfig.pruningType != PruningType::CostModel || !plan.meta.cost.calibrated) return "";
+        const CostModelParams &cost = plan.meta.cost;
+        return fmt::format("\t\tMiniGraphIF::COST = {{{}, {}, {}}};\n", cost.build_ns, cost.scan_ns, cost.large_degree_factor);
+    }
+
+    std::string gen_code_check_sink() {
+        if (EnableLocalCount)
+            return "\t\tif (ctx.local_counts == nullptr) throw std::runtime_error(\"This plan counts per vertex but Context::local_counts is not set\");\n";
+        return "\t\tif (ctx.embeddings == nullptr) throw std::runtime_error(\"This plan enumerates embeddings but Context::embeddings is not set\");\n";
+    }
+
+    // the tbb loops of enumeration and local count plans need the vertices matched by the enclosing loops
+    bool need_matched_ids() { return EnableEnumeration || EnableLocalCount; }
+
     std::string gen_code_omp(PlanIR plan, CodeGenConfig config) {
         Timer t;
         std::ostringstream out;
@@ -782,34 +1429,33 @@ namespace minigraph {
         else out << "#include \"plan.h\"\n";
         out << "namespace minigraph {\n";
         out << "\tuint64_t pattern_size() {return " << plan.p_size << ";}\n";
+        out << "\tuint64_t num_orbits() {return " << plan.num_orbits() << ";}\n";
+        out << "\tuint64_t min_core() {return " << *std::min_element(plan.degrees.begin(), plan.degrees.end()) << ";}\n";
         out << "\tvoid plan(const GraphType* graph, Context& ctx){\n";
         if (EnableProfling) out << "\t\tVertexSet::profiler = ctx.profiler;\n";
 
-        switch (config.pruningType) {
-            case (PruningType::Eager):
-                out << "\t\tusing MiniGraphType = MiniGraphEager;\n";
-                break;
-            case (PruningType::Static):
-                out << "\t\tusing MiniGraphType = MiniGraphLazy;\n";
-                break;
-            case (PruningType::Online):
-                out << "\t\tusing MiniGraphType = MiniGraphOnline;\n";
-                break;
-            case (PruningType::CostModel):
-                out << "\t\tusing MiniGraphType = MiniGraphCostModel;\n";
-                break;
-            default:
-                break;
-        }
         if (config.pruningType != PruningType::None) out << "\t\tMiniGraphIF::DATA_GRAPH = graph;\n";
+        out << gen_code_cost_params(plan);
         out << "\t\tVertexSetType::MAX_DEGREE = graph->get_maxdeg();\n";
+        out << gen_code_filters();
+        if (EnableEnumeration || EnableLocalCount) out << gen_code_check_sink();
+        if (EnableAnalyze) {
+            out << "\t\tif (ctx.analyzer == nullptr) throw std::runtime_error(\"This plan records op statistics but Context::analyzer is not set\");\n";
+            out << "\t\tctx.analyzer->init(" << iep_probe(plan) + 1 << ");\n";
+        }
         out << "#pragma omp parallel num_threads(ctx.num_threads) default(none) shared(ctx, graph)\n\t\t{ // pragma parallel \n";
         out << "\t\t\tcc &counter = ctx.per_thread_result.at(omp_get_thread_num());\n";
         out << "\t\t\tcc &handled = ctx.per_thread_handled.at(omp_get_thread_num());\n";
+        if (EnableAnalyze) out << "\t\t\tPlanAnalyzer::Buffer &an = ctx.analyzer->buffer(omp_get_thread_num());\n";
+        if (EnableEnumeration)
+            out << "\t\t\tEmbeddingSink::Buffer &emb = ctx.embeddings->buffer(omp_get_thread_num());\n";
+        if (EnableLocalCount)
+            out << "\t\t\tLocalCounter::Buffer &lc = ctx.local_counts->buffer(omp_get_thread_num());\n";
         out << "\t\t\tdouble start = omp_get_wtime();\n";
         out << "\t\t\tctx.iep_redundency = " << plan.iep_redundancy << ";\n";
         out << "#pragma omp for schedule(dynamic, 1) nowait\n";
-        out << "\t\t\tfor (IdType i0_id = 0; i0_id < graph->get_vnum(); i0_id++) { // loop-0 begin\n";
+        out << "\t\t\tfor (size_t i0_idx = 0; i0_idx < ctx.num_roots(graph->get_vnum()); i0_idx++) { // loop-0 begin\n";
+        out << "\t\t\tconst IdType i0_id = ctx.root(i0_idx);\n";
         int max_dep = plan.p_size - 1;
         const auto &set_ops = plan.set_ops;
         switch (config.pruningType) {
@@ -821,7 +1467,7 @@ namespace minigraph {
                         // code for computation at this loop
                         const auto &ops = set_ops.at(dep);
                         for (const auto &op: ops) {
-                            out << gen_indent(dep) << gen_code_op(plan, op);
+                            out << gen_indent(dep) << gen_code_probe(plan, op, gen_code_op(plan, op));
                             out << gen_indent(dep) << op;
                         }
                         // code for iterating next loop
@@ -836,7 +1482,7 @@ namespace minigraph {
                         // code for computation at this loop
                         const auto &ops = set_ops.at(dep);
                         for (const auto &op: ops) {
-                            out << gen_indent(dep) << gen_code_op(plan, op);
+                            out << gen_indent(dep) << gen_code_probe(plan, op, gen_code_op(plan, op));
                             out << gen_indent(dep) << op;
                         }
                         // code for iterating next loop
@@ -849,14 +1495,11 @@ namespace minigraph {
                     // code for computation at this loop
                     const auto &ops = set_ops.at(dep);
                     for (const auto &op: ops) {
-                        out << gen_indent(dep) << gen_code_op(plan, op);
+                        out << gen_indent(dep) << gen_code_probe(plan, op, gen_code_op(plan, op));
                         out << gen_indent(dep) << op;
                     }
 
-                    for (size_t group_id = 0; group_id < plan.iep_groups.size(); group_id++) {
-                        out << gen_indent(dep) << gen_code_iep(plan, group_id);
-                        out << gen_indent(dep) << gen_comment_iep(plan, group_id);
-                    }
+                    out << gen_code_iep_probe(plan, dep);
                 }
                 break;
 
@@ -869,21 +1512,12 @@ namespace minigraph {
                         // code for computation at this loop
                         const auto &ops = set_ops.at(dep);
                         for (const auto &op: ops) {
-                            out << gen_indent(dep) << gen_code_mg_op(plan, op);
+                            out << gen_indent(dep) << gen_code_probe(plan, op, gen_code_mg_op(plan, op));
                             out << gen_indent(dep) << op;
                         }
                         if (dep == plan.p_size - 2) continue;
-                        // code for building pruned graphs
-                        const auto &mgs = plan.mg_ops.at(dep);
-                        for (const auto &mg: mgs) {
-                            out << gen_indent(dep) << gen_code_mg_init(plan, mg);
-                            out << gen_indent(dep) << mg;
-                            out << gen_indent(dep) << gen_code_mg_build(plan, mg);
-                        }
-
-                        for (const auto &mg: plan.mg_used.at(dep + 1)) {
-                            out << gen_indent(dep) << gen_code_mg_indice(plan, mg, dep);
-                        }
+                        // code for building pruned graphs and their indices in the next loop
+                        out << gen_code_mg_depth(plan, dep, gen_indent(dep));
                         // code for iterating next loop
                         out << gen_indent(dep) << gen_code_iter(plan, dep);
                     }
@@ -896,21 +1530,12 @@ namespace minigraph {
                         // code for computation at this loop
                         const auto &ops = set_ops.at(dep);
                         for (const auto &op: ops) {
-                            out << gen_indent(dep) << gen_code_mg_op(plan, op);
+                            out << gen_indent(dep) << gen_code_probe(plan, op, gen_code_mg_op(plan, op));
                             out << gen_indent(dep) << op;
                         }
                         if (dep == plan.p_size - 2) continue;
-                        // code for building pruned graphs
-                        const auto &mgs = plan.mg_ops.at(dep);
-                        for (const auto &mg: mgs) {
-                            out << gen_indent(dep) << gen_code_mg_init(plan, mg);
-                            out << gen_indent(dep) << mg;
-                            out << gen_indent(dep) << gen_code_mg_build(plan, mg);
-                        }
-
-                        for (const auto &mg: plan.mg_used.at(dep + 1)) {
-                            out << gen_indent(dep) << gen_code_mg_indice(plan, mg, dep);
-                        }
+                        // code for building pruned graphs and their indices in the next loop
+                        out << gen_code_mg_depth(plan, dep, gen_indent(dep));
                         // code for iterating next loop
                         out << gen_indent(dep) << gen_code_iter(plan, dep);
                     }
@@ -920,14 +1545,11 @@ namespace minigraph {
                     // code for computation at this loop
                     const auto &ops = set_ops.at(dep);
                     for (const auto &op: ops) {
-                        out << gen_indent(dep) << gen_code_mg_op(plan, op);
+                        out << gen_indent(dep) << gen_code_probe(plan, op, gen_code_mg_op(plan, op));
                         out << gen_indent(dep) << op;
                     }
 
-                    for (size_t group_id = 0; group_id < plan.iep_groups.size(); group_id++) {
-                        out << gen_indent(dep) << gen_code_iep(plan, group_id);
-                        out << gen_indent(dep) << gen_comment_iep(plan, group_id);
-                    }
+                    out << gen_code_iep_probe(plan, dep);
                 }
                 break;
         }
@@ -953,6 +1575,56 @@ namespace minigraph {
         return out.str();
     };
 
+    // patterns of at least this many vertices are counted by CliqueCounter with pivoting
+    constexpr int kCliquePivotSize = 6;
+
+    // whether gen_code counts the pattern with CliqueCounter instead of matching it loop by loop
+    bool use_clique_engine(const std::string &adj_mat, const std::vector<int> &labels, const CodeGenConfig &config) {
+        if (!config.cliqueEngine || !labels.empty() || config.runnerType != RunnerType::Benchmark) return false;
+        int p_size = (int) std::sqrt(adj_mat.size());
+        for (int i = 0; i < p_size; i++) {
+            for (int j = 0; j < p_size; j++) {
+                if (i != j && adj_mat.at(VEC_INDEX(i, j, p_size)) != '1') return false;
+            }
+        }
+        return true;
+    }
+
+    /* brief Plan counting the p_size-cliques with CliqueCounter
+     * A clique is vertex-induced by itself and has no symmetry left to break, so every AdjMatType and pruning counts
+     * the same; the plan always runs on OpenMP threads, one root vertex per iteration.
+     * */
+    std::string gen_code_clique(int p_size) {
+        Timer t;
+        bool pivot = p_size >= kCliquePivotSize;
+        std::ostringstream out;
+        out << "#include \"plan.h\"\n";
+        out << "namespace minigraph {\n";
+        out << "\tuint64_t pattern_size() {return " << p_size << ";}\n";
+        out << "\tuint64_t num_orbits() {return 0;}\n";
+        out << "\tuint64_t min_core() {return " << p_size - 1 << ";}\n";
+        out << "\tvoid plan(const GraphType* graph, Context& ctx){\n";
+        out << "\t\tctx.iep_redundency = 1;\n";
+        out << "\t\tconst CliqueCounter cliques(graph, " << p_size << ", " << (pivot ? "true" : "false") << ");\n";
+        out << "#pragma omp parallel num_threads(ctx.num_threads) default(none) shared(ctx, graph, cliques)\n\t\t{ // pragma parallel \n";
+        out << "\t\t\tcc &counter = ctx.per_thread_result.at(omp_get_thread_num());\n";
+        out << "\t\t\tcc &handled = ctx.per_thread_handled.at(omp_get_thread_num());\n";
+        out << "\t\t\tCliqueCounter::Workspace ws;\n";
+        out << "\t\t\tdouble start = omp_get_wtime();\n";
+        out << "#pragma omp for schedule(dynamic, 1) nowait\n";
+        out << "\t\t\tfor (size_t i0_idx = 0; i0_idx < ctx.num_roots(graph->get_vnum()); i0_idx++) { // loop-0 begin\n";
+        out << "\t\t\t\tcounter += cliques.count(ctx.root(i0_idx), ws);\n";
+        out << "\t\t\t\thandled += 1;\n";
+        out << "\t\t\t} // loop-0 end\n";
+        out << "\t\t\tctx.per_thread_time.at(omp_get_thread_num()) = omp_get_wtime() - start;\n";
+        out << "\t\t} // pragma parallel\n";
+        out << "\t} // plan\n";
+        out << "} // namespace minigraph \n";
+        out << "extern \"C\" void plan(const minigraph::GraphType* graph, minigraph::Context& ctx){return minigraph::plan(graph, ctx);};";
+        LOG(INFO) << "Code Generation Time: " << t.Passed() << "s";
+        return out.str();
+    }
+
     // all the mingraphs used inside the loop-th loop
     std::vector<MiniGraphIR> gen_used_mg(const PlanIR& plan, const CodeGenConfig& config, int loop){
         std::vector<MiniGraphIR> used_mg;
@@ -1058,8 +1730,13 @@ namespace minigraph {
                            fmt::arg("dep", loop));
         // Args
         out << "(ctx";
+        if (need_matched_ids()) {
+            for (int dep = 0; dep < loop; dep++) {
+                out << fmt::format(", i{}_id", dep);
+            }
+        }
         for (int dep: used_adj) {
-            out << fmt::format(", i{}_adj", dep);
+            for (int label: gen_adj_labels(plan, dep)) out << ", " << gen_adj_name(dep, label);
         }
 
         for (auto set: used_set) {
@@ -1070,7 +1747,8 @@ namespace minigraph {
 
         if (config.pruningType != PruningType::None) {
             for (auto mg: plan.mg_used.at(loop)) {
-                if (!skip_build_indices(plan, mg, iter)) out << fmt::format(", m{}_s{}", mg.id, iter_id);
+                if (!skip_build_indices(plan, mg, iter) && is_indices_owner(plan, mg, loop))
+                    out << fmt::format(", m{}_s{}", mg.id, iter_id);
             }
 
             for (auto mg: used_mg) {
@@ -1101,14 +1779,20 @@ namespace minigraph {
         out << "\tprivate:\n";
         out << "\t\tContext& ctx;\n";
 
+        if (need_matched_ids() && loop > 0) out << "\t\t// Matched Vertices\n";
+        for (int dep = 0; need_matched_ids() && dep < loop; dep++) {
+            out << fmt::format("\t\tconst IdType i{}_id;\n", dep);
+        }
+
         if (!used_adj.empty()) out << "\t\t// Adjacent Lists\n";
         for (int dep: used_adj) {
-            out << fmt::format("\t\tVertexSet& i{}_adj;\n", dep);
+            for (int label: gen_adj_labels(plan, dep))
+                out << fmt::format("\t\tVertexSet& {};\n", gen_adj_name(dep, label));
         }
 
         if (!used_set.empty()) out << "\t\t// Parent Intermediates\n";
         for (auto set: used_set) {
-            out << fmt::format("\t\tVertexSet& s{};\n", set.id);
+            out << fmt::format("\t\t{}& s{};\n", gen_set_type(plan, set), set.id);
         }
 
         if (loop > 0) out << "\t\t// Iterate Set\n" << fmt::format("\t\tVertexSet& s{};\n", iter_id);
@@ -1116,7 +1800,7 @@ namespace minigraph {
         if (config.pruningType != PruningType::None) {
             if (!plan.mg_used.at(loop).empty()) out << "\t\t// MiniGraphs Indices\n";
             for (auto mg: plan.mg_used.at(loop)) {
-                if (!skip_build_indices(plan, mg, iter))
+                if (!skip_build_indices(plan, mg, iter) && is_indices_owner(plan, mg, loop))
                     out << fmt::format("\t\tManagedContainer& m{}_s{};\n", mg.id, iter_id);
             }
 
@@ -1131,19 +1815,24 @@ namespace minigraph {
         // Args
         out << "\t\tLoop" << loop << "(Context& _ctx";
 
+        for (int dep = 0; need_matched_ids() && dep < loop; dep++) {
+            out << fmt::format(", IdType _i{}_id", dep);
+        }
+
         for (int dep: used_adj) {
-            out << fmt::format(", VertexSet& _i{}_adj", dep);
+            for (int label: gen_adj_labels(plan, dep))
+                out << fmt::format(", VertexSet& _{}", gen_adj_name(dep, label));
         }
 
         for (auto set: used_set) {
-            out << fmt::format(", VertexSet& _s{}", set.id);
+            out << fmt::format(", {}& _s{}", gen_set_type(plan, set), set.id);
         }
 
         if (loop > 0) out << ", VertexSet& _s" << iter_id;
 
         if (config.pruningType != PruningType::None) {
             for (auto mg: plan.mg_used.at(loop)) {
-                if (!skip_build_indices(plan, mg, iter))
+                if (!skip_build_indices(plan, mg, iter) && is_indices_owner(plan, mg, loop))
                     out << fmt::format(", ManagedContainer& _m{}_s{}", mg.id, iter_id);
             }
 
@@ -1157,8 +1846,15 @@ namespace minigraph {
         // Initialization
         out << ":ctx{_ctx}";
 
+        for (int dep = 0; need_matched_ids() && dep < loop; dep++) {
+            out << fmt::format(", i{}_id", dep) << "{" << fmt::format("_i{}_id", dep) << "}";
+        }
+
         for (int dep: used_adj) {
-            out << fmt::format(", i{}_adj", dep) << "{" << fmt::format("_i{}_adj", dep) << "}";
+            for (int label: gen_adj_labels(plan, dep)) {
+                std::string adj = gen_adj_name(dep, label);
+                out << ", " << adj << "{_" << adj << "}";
+            }
         }
 
         for (auto set: used_set) {
@@ -1169,7 +1865,7 @@ namespace minigraph {
 
         if (config.pruningType != PruningType::None) {
             for (auto mg: plan.mg_used.at(loop)) {
-                if (!skip_build_indices(plan, mg, iter))
+                if (!skip_build_indices(plan, mg, iter) && is_indices_owner(plan, mg, loop))
                     out << fmt::format(", m{}_s{}", mg.id, iter_id) << "{" << fmt::format(" _m{}_s{}", mg.id, iter_id)
                         << "}";
             }
@@ -1184,6 +1880,8 @@ namespace minigraph {
         out << "\t\tvoid operator()(const tbb::blocked_range<size_t> &r) const {// operator begin\n";
         out << "\t\t\tconst int worker_id = tbb::this_task_arena::current_thread_index();\n";
         out << "\t\t\tcc& counter = ctx.per_thread_result.at(worker_id);\n";
+        if (EnableEnumeration) out << "\t\t\tEmbeddingSink::Buffer& emb = ctx.embeddings->buffer(worker_id);\n";
+        if (EnableLocalCount) out << "\t\t\tLocalCounter::Buffer& lc = ctx.local_counts->buffer(worker_id);\n";
         if (loop > 0) {
             out << "\t\t\t" << fmt::format("for (size_t i{loop}_idx = r.begin(); i{loop}_idx < r.end(); i{loop}_idx++)",
                                            fmt::arg("loop", loop));
@@ -1191,10 +1889,11 @@ namespace minigraph {
 //            out << "\t\t\tcc& handled = ctx.per_thread_handled.at(worker_id);\n";
 //            out << "\t\t\t" << "double& time = ctx.per_thread_time.at(worker_id);\n";
 //            out << "\t\t\t" << "tick_count t1 = tick_count::now();\n";
-            out << "\t\t\t" << fmt::format("for (size_t i{loop}_id = r.begin(); i{loop}_id < r.end(); i{loop}_id++)",
+            out << "\t\t\t" << fmt::format("for (size_t i{loop}_idx = r.begin(); i{loop}_idx < r.end(); i{loop}_idx++)",
                                            fmt::arg("loop", loop));
         }
         out << " { // loop-" << loop << "begin\n";
+        if (loop == 0) out << "\t\t\tconst IdType i0_id = ctx.root(i0_idx);\n";
         int max_dep = plan.p_size - 1;
         const auto &set_ops = plan.set_ops;
         switch (config.pruningType) {
@@ -1253,10 +1952,7 @@ namespace minigraph {
                         out << gen_indent_tbb(indent_dep) << op;
                     }
 
-                    for (size_t group_id = 0; group_id < plan.iep_groups.size(); group_id++) {
-                        out << gen_indent_tbb(indent_dep) << gen_code_iep(plan, group_id);
-                        out << gen_indent_tbb(indent_dep) << gen_comment_iep(plan, group_id);
-                    }
+                    out << gen_code_iep(plan, gen_indent_tbb(indent_dep));
                 }
                 break;
 
@@ -1274,17 +1970,8 @@ namespace minigraph {
                             out << gen_indent_tbb(indent_dep) << op;
                         }
                         if (dep == plan.p_size - 2) continue;
-                        // code for building pruned graphs
-                        const auto &mgs = plan.mg_ops.at(dep);
-                        for (const auto &mg: mgs) {
-                            out << gen_indent_tbb(indent_dep) << gen_code_mg_init(plan, mg);
-                            out << gen_indent_tbb(indent_dep) << mg;
-                            out << gen_indent_tbb(indent_dep) << gen_code_mg_build(plan, mg);
-                        }
-
-                        for (const auto &mg: plan.mg_used.at(dep + 1)) {
-                            out << gen_indent_tbb(indent_dep) << gen_code_mg_indice(plan, mg, dep);
-                        }
+                        // code for building pruned graphs and their indices in the next loop
+                        out << gen_code_mg_depth(plan, dep, gen_indent_tbb(indent_dep));
 
                         // code for calling parallel nested loop
                         out << gen_code_tbb_call(plan, config, dep + 1, indent_dep);
@@ -1306,17 +1993,8 @@ namespace minigraph {
                             out << gen_indent_tbb(indent_dep) << op;
                         }
                         if (dep == plan.p_size - 2) continue;
-                        // code for building pruned graphs
-                        const auto &mgs = plan.mg_ops.at(dep);
-                        for (const auto &mg: mgs) {
-                            out << gen_indent_tbb(indent_dep) << gen_code_mg_init(plan, mg);
-                            out << gen_indent_tbb(indent_dep) << mg;
-                            out << gen_indent_tbb(indent_dep) << gen_code_mg_build(plan, mg);
-                        }
-
-                        for (const auto &mg: plan.mg_used.at(dep + 1)) {
-                            out << gen_indent_tbb(indent_dep) << gen_code_mg_indice(plan, mg, dep);
-                        }
+                        // code for building pruned graphs and their indices in the next loop
+                        out << gen_code_mg_depth(plan, dep, gen_indent_tbb(indent_dep));
 
                         // code for calling parallel nested loop
                         out << gen_code_tbb_call(plan, config, dep + 1, indent_dep);
@@ -1335,10 +2013,7 @@ namespace minigraph {
                         out << gen_indent_tbb(indent_dep) << op;
                     }
 
-                    for (size_t group_id = 0; group_id < plan.iep_groups.size(); group_id++) {
-                        out << gen_indent_tbb(indent_dep) << gen_code_iep(plan, group_id);
-                        out << gen_indent_tbb(indent_dep) << gen_comment_iep(plan, group_id);
-                    }
+                    out << gen_code_iep(plan, gen_indent_tbb(indent_dep));
                 }
                 break;
         }
@@ -1370,24 +2045,10 @@ namespace minigraph {
         // out << "#include \"oneapi/tbb/parallel_for.h\"\n";
         out << "namespace minigraph {\n";
         out << "\tuint64_t pattern_size() {return " << plan.p_size << ";}\n";
+        out << "\tuint64_t num_orbits() {return " << plan.num_orbits() << ";}\n";
+        out << "\tuint64_t min_core() {return " << *std::min_element(plan.degrees.begin(), plan.degrees.end()) << ";}\n";
         out << "\tstatic const Graph * graph;\n";
 
-        switch (config.pruningType) {
-            case (PruningType::Eager):
-                out << "\tusing MiniGraphType = MiniGraphEager;\n";
-                break;
-            case (PruningType::Static):
-                out << "\tusing MiniGraphType = MiniGraphLazy;\n";
-                break;
-            case (PruningType::Online):
-                out << "\tusing MiniGraphType = MiniGraphOnline;\n";
-                break;
-            case (PruningType::CostModel):
-                out << "\tusing MiniGraphType = MiniGraphCostModel;\n";
-                break;
-            default:
-                break;
-        }
         for (int loop = plan.get_serial_loop() - 1; loop >= 0; loop--) {
             out << gen_code_tbb_loop(plan, config, loop);
         }
@@ -1398,17 +2059,225 @@ namespace minigraph {
         out << "\t\tctx.tick_begin = tbb::tick_count::now();\n";
         out << "\t\tctx.iep_redundency = " << plan.iep_redundancy << ";\n";
         out << "\t\tgraph = _graph;\n";
+        if (EnableEnumeration || EnableLocalCount) out << gen_code_check_sink();
         if (config.pruningType != PruningType::None) out << "\t\tMiniGraphIF::DATA_GRAPH = graph;\n";
+        out << gen_code_cost_params(plan);
         out << "\t\tVertexSetType::MAX_DEGREE = graph->get_maxdeg();\n";
-        out << "\t\ttbb::parallel_for(tbb::blocked_range<size_t>(0, graph->get_vnum()), Loop0(ctx), tbb::simple_partitioner());\n";
+        out << gen_code_filters();
+        out << "\t\ttbb::parallel_for(tbb::blocked_range<size_t>(0, ctx.num_roots(graph->get_vnum())), Loop0(ctx), tbb::simple_partitioner());\n";
         out << "\t} // plan\n";
         out << "} // minigraph\n";
         return out.str();
     }
 
+    struct BatchStats {
+        size_t num_ops{0}; // set operations of the individual plans
+        size_t merged_ops{0}; // set operations of the merged plan
+    };
+
+    /* brief Loop dep of a multi-pattern plan
+     * patterns: the plans sharing the loops [0, dep) of merged (same iterated sets, hence the same i0_id ... i{dep}_id)
+     * The loop computes the union of their ops, counts the patterns ending here and opens one nested loop per
+     * distinct set the remaining patterns iterate over, so the patterns form a trie over their loop prefixes.
+     * */
+    void gen_code_batch_loop(const std::vector<PlanIR> &plans, const std::vector<int> &patterns, PlanIR merged,
+                             int dep, int &next_id, BatchStats &stats, std::ostringstream &out) {
+        std::vector<VertexSetIR> ops;
+        std::vector<int> ending, continuing;
+        for (int k: patterns) {
+            const PlanIR &plan = plans.at(k);
+            for (const auto &op: plan.set_ops.at(dep)) {
+                if (std::find(ops.begin(), ops.end(), op) == ops.end()) ops.push_back(op);
+            }
+            stats.num_ops += plan.set_ops.at(dep).size();
+            if (plan.p_size - 2 == dep) ending.push_back(k);
+            else continuing.push_back(k);
+        }
+        // a bounded op is computed from the op it is bounded from, which has one restriction less
+        std::stable_sort(ops.begin(), ops.end(), [](const VertexSetIR &l, const VertexSetIR &r) {
+            return std::make_pair(l.edge_num(), l.restrict_num()) < std::make_pair(r.edge_num(), r.restrict_num());
+        });
+        for (auto &op: ops) op.id = next_id++;
+        stats.merged_ops += ops.size();
+        merged.set_ops.at(dep) = ops;
+        auto merged_op = [&ops](const VertexSetIR &op) { return *std::find(ops.begin(), ops.end(), op); };
+
+        // ops that no remaining pattern computes from are only counted
+        for (const auto &op: ops) {
+            bool counted_only = true;
+            for (int k: continuing) {
+                const auto &k_ops = plans.at(k).set_ops.at(dep);
+                if (std::find(k_ops.begin(), k_ops.end(), op) != k_ops.end()) counted_only = false;
+            }
+            for (const auto &child: ops) {
+                auto parent = merged.get_parent_vset(child);
+                if (parent.has_value() && parent->id == op.id) counted_only = false;
+            }
+            if (counted_only) merged.last_ops.push_back(op.id);
+        }
+
+        out << gen_indent(dep) << gen_code_read_adj(merged, dep);
+        for (const auto &op: ops) {
+            out << gen_indent(dep) << gen_code_op(merged, op);
+            out << gen_indent(dep) << op;
+        }
+        for (int k: ending) {
+            const auto &k_ops = plans.at(k).set_ops.at(dep);
+            CHECK(k_ops.size() == 1) << "The last loop of pattern " << k << " computes " << k_ops.size() << " sets";
+            VertexSetIR last = merged_op(k_ops.front());
+            std::string cnt = merged.is_last_op(last) ? fmt::format("c{}", last.id) : fmt::format("s{}.size()", last.id);
+            out << gen_indent(dep) << fmt::format("pattern_counter[{}] += {};\n", k, cnt);
+        }
+
+        // patterns iterating over the same set share the next loop
+        std::vector<std::pair<VertexSetIR, std::vector<int>>> groups;
+        for (int k: continuing) {
+            VertexSetIR iter = merged_op(plans.at(k).iter_set.at(dep));
+            auto group = std::find_if(groups.begin(), groups.end(), [&iter](const auto &g) { return g.first.id == iter.id; });
+            if (group == groups.end()) groups.push_back({iter, {k}});
+            else group->second.push_back(k);
+        }
+        for (const auto &[iter, group]: groups) {
+            PlanIR child = merged;
+            child.iter_set.at(dep) = iter;
+            out << gen_indent(dep) << fmt::format(
+                    "for (size_t i{dep}_idx = 0; i{dep}_idx < s{iter_id}.size(); i{dep}_idx++) {left} // loop-{dep} begin\n",
+                    fmt::arg("left", "{"),
+                    fmt::arg("iter_id", iter.id),
+                    fmt::arg("dep", dep + 1));
+            gen_code_batch_loop(plans, group, child, dep + 1, next_id, stats, out);
+            out << gen_indent(dep) << "} // loop-" << std::to_string(dep + 1) << " end\n";
+        }
+    }
+
+    std::string gen_code_batch_omp(const std::vector<PlanIR> &plans, const std::vector<std::string> &adj_mats) {
+        Timer t;
+        std::ostringstream out;
+        int max_p_size = 0;
+        for (const auto &plan: plans) max_p_size = std::max(max_p_size, plan.p_size);
+        // every op is counted through last_ops since the patterns end at different loops
+        PlanIR merged;
+        merged.p_size = max_p_size + 1;
+        merged.meta = plans.front().meta;
+        merged.set_ops.resize(max_p_size);
+        merged.iter_set.resize(max_p_size);
+        std::vector<int> patterns;
+        for (size_t k = 0; k < plans.size(); k++) patterns.push_back(k);
+
+        out << "#include \"plan.h\"\n";
+        for (size_t k = 0; k < adj_mats.size(); k++) out << "// pattern " << k << ": " << adj_mats.at(k) << "\n";
+        out << "namespace minigraph {\n";
+        out << "\tuint64_t pattern_size() {return " << max_p_size << ";}\n";
+        out << "\tuint64_t num_orbits() {return 0;}\n";
+        int min_core = std::numeric_limits<int>::max();
+        for (const auto &plan: plans) min_core = std::min(min_core, *std::min_element(plan.degrees.begin(), plan.degrees.end()));
+        out << "\tuint64_t min_core() {return " << min_core << ";}\n";
+        out << "\tvoid plan(const GraphType* graph, Context& ctx){\n";
+        out << "\t\tVertexSetType::MAX_DEGREE = graph->get_maxdeg();\n";
+        out << "\t\tctx.init_patterns(" << plans.size() << ");\n";
+        out << "#pragma omp parallel num_threads(ctx.num_threads) default(none) shared(ctx, graph)\n\t\t{ // pragma parallel \n";
+        out << "\t\t\tstd::vector<cc> &pattern_counter = ctx.per_thread_pattern_result.at(omp_get_thread_num());\n";
+        out << "\t\t\tcc &handled = ctx.per_thread_handled.at(omp_get_thread_num());\n";
+        out << "\t\t\tdouble start = omp_get_wtime();\n";
+        out << "#pragma omp for schedule(dynamic, 1) nowait\n";
+        out << "\t\t\tfor (size_t i0_idx = 0; i0_idx < ctx.num_roots(graph->get_vnum()); i0_idx++) { // loop-0 begin\n";
+        out << "\t\t\tconst IdType i0_id = ctx.root(i0_idx);\n";
+        int next_id = 0;
+        BatchStats stats;
+        gen_code_batch_loop(plans, patterns, merged, 0, next_id, stats, out);
+        out << gen_indent(0) << "handled+=1;\n";
+        out << gen_indent(0) << "} // loop-0 end\n";
+        out << "\t\t\tctx.per_thread_time.at(omp_get_thread_num()) = omp_get_wtime() - start;\n";
+        out << "\t\t} // pragma parallel\n";
+        out << "\t} // plan\n";
+        out << "} // namespace minigraph \n";
+
+        out << "extern \"C\" void plan(const minigraph::GraphType* graph, minigraph::Context& ctx){return minigraph::plan(graph, ctx);};";
+        LOG(MSG) << "SHARED_SET_OPS=" << stats.num_ops - stats.merged_ops << "/" << stats.num_ops;
+        LOG(INFO) << "Code Generation Time: " << t.Passed() << "s";
+        return out.str();
+    }
+
+    std::string read_pattern(const std::string &path, std::vector<int> &labels) {
+        std::ifstream in(path);
+        CHECK(in.is_open()) << "Cannot open pattern file: " << path;
+        labels.clear();
+        std::string tag;
+        int p_size = 0, num_edge = 0;
+        std::vector<std::pair<int, int>> edges;
+        std::set<int> edge_labels;
+        CHECK(in >> tag) << "Empty pattern file: " << path;
+        if (tag == "t") {
+            // labeled format: "t #vertices #edges", "v id label degree", "e src dst label"
+            in >> p_size >> num_edge;
+            labels.resize(p_size, -1);
+            while (in >> tag) {
+                if (tag == "v") {
+                    int vid, label, degree;
+                    in >> vid >> label >> degree;
+                    CHECK(vid >= 0 && vid < p_size) << "Invalid vertex " << vid << " in " << path;
+                    labels.at(vid) = label;
+                } else if (tag == "e") {
+                    int src, dst, label;
+                    in >> src >> dst >> label;
+                    edges.emplace_back(src, dst);
+                    edge_labels.insert(label);
+                } else {
+                    LOG(FATAL) << "Unknown line '" << tag << "' in " << path;
+                }
+            }
+            CHECK(std::find(labels.begin(), labels.end(), -1) == labels.end()) << "Unlabeled vertex in " << path;
+        } else {
+            // unlabeled format (queries/convert_query_format.py): "#vertices" followed by "src dst" lines
+            p_size = std::stoi(tag);
+            int src, dst;
+            while (in >> src >> dst) edges.emplace_back(src, dst);
+        }
+        // the data graphs carry vertex labels only
+        CHECK(edge_labels.size() <= 1) << "Edge-labeled patterns are not supported: " << path;
+        std::string adj_mat(p_size * p_size, '0');
+        for (auto [src, dst]: edges) {
+            CHECK(src >= 0 && src < p_size && dst >= 0 && dst < p_size && src != dst)
+                << "Invalid edge (" << src << ", " << dst << ") in " << path;
+            adj_mat.at(VEC_INDEX(src, dst, p_size)) = '1';
+            adj_mat.at(VEC_INDEX(dst, src, p_size)) = '1';
+        }
+        return adj_mat;
+    }
+
     std::string gen_code(const std::string &adj_mat, CodeGenConfig config, MetaData meta) {
+        return gen_code(adj_mat, {}, config, meta);
+    }
+
+    std::string gen_code(const std::string &adj_mat, const std::vector<int> &labels, CodeGenConfig config,
+                         MetaData meta) {
+        if (config.runnerType == RunnerType::Enumeration && config.adjMatType == AdjMatType::EdgeInducedIEP) {
+            // IEP derives the count of the last loops without visiting their vertices
+            LOG(WARNING) << "Enumeration does not support IEP, fall back to EdgeInduced";
+            config.adjMatType = AdjMatType::EdgeInduced;
+        }
+        if ((config.runnerType == RunnerType::LocalCount || config.runnerType == RunnerType::OrbitCount)
+            && config.adjMatType == AdjMatType::EdgeInducedIEP) {
+            LOG(WARNING) << "Local counts do not support IEP, fall back to EdgeInduced";
+            config.adjMatType = AdjMatType::EdgeInduced;
+        }
+        if (!labels.empty() && config.adjMatType == AdjMatType::EdgeInducedIEP) {
+            // GraphPi's IEP groups are derived from the unlabeled automorphisms
+            LOG(WARNING) << "Labeled patterns do not support IEP, fall back to EdgeInduced";
+            config.adjMatType = AdjMatType::EdgeInduced;
+        }
+        if (config.runnerType == RunnerType::Analyze && config.parType != ParallelType::OpenMP) {
+            // probes are only emitted by the OpenMP generator
+            LOG(WARNING) << "Analyze plans only support OpenMP, fall back to OpenMP";
+            config.parType = ParallelType::OpenMP;
+        }
+        if (use_clique_engine(adj_mat, labels, config)) {
+            int p_size = (int) std::sqrt(adj_mat.size());
+            LOG(MSG) << "ParallelType=OpenMP CliqueEngine k=" << p_size << (p_size >= kCliquePivotSize ? " pivot" : "");
+            return gen_code_clique(p_size);
+        }
         VertexSetIR::adjMatType = config.adjMatType;
-        PlanIR plan = create_plan(adj_mat, config, meta);
+        PlanIR plan = create_plan(adj_mat, labels, config, meta);
         CurConfig = config;
         if (config.pruningType != PruningType::None) {
             plan = create_plan_mg(plan, config);
@@ -1418,6 +2287,10 @@ namespace minigraph {
         } else {
             EnableProfling = false;
         }
+        EnableEnumeration = config.runnerType == RunnerType::Enumeration;
+        EnableLocalCount = config.runnerType == RunnerType::LocalCount || config.runnerType == RunnerType::OrbitCount;
+        EnableAnalyze = config.runnerType == RunnerType::Analyze;
+        plan_filters(plan, config);
         if (config.parType == ParallelType::OpenMP) {
             LOG(MSG) << "ParallelType=OpenMP";
             return gen_code_omp(plan, config);
@@ -1438,4 +2311,202 @@ namespace minigraph {
             return ""; // TODO distributed
         }
     };
-}
\ No newline at end of file
+
+    // the op in terms of its parent (or an adjacency list) and the matched vertices, e.g. s3 = s1 & N(i2) | < i1
+    std::string explain_op(const PlanIR &plan, const VertexSetIR &op) {
+        int dep = op.loop_depth();
+        auto parent = plan.get_parent_vset(op);
+        std::optional<MiniGraphIR> mg;
+        if (CurConfig.pruningType != PruningType::None) mg = plan.get_parent_mg(op);
+        std::string adj = mg.has_value() ? fmt::format("m{}.N(i{})", mg->id, dep) : fmt::format("N(i{})", dep);
+        bool vertex_induced = VertexSetIR::adjMatType == AdjMatType::VertexInduced;
+        std::string out = fmt::format("s{} = ", op.id);
+        if (parent.has_value() && parent->loop_depth() == dep) {
+            out += fmt::format("s{}", parent->id);
+        } else if (parent.has_value()) {
+            if (op.is_edge(dep)) out += fmt::format("s{} & {}", parent->id, adj);
+            else if (vertex_induced) out += fmt::format("s{} - {}", parent->id, adj);
+            else out += fmt::format("s{} - {{i{}}}", parent->id, dep);
+        } else {
+            out += adj;
+            for (int prev = 0; prev < dep; prev++) {
+                if (vertex_induced) out += fmt::format(" - N(i{})", prev);
+                else if (!op.is_restricted(prev)) out += fmt::format(" - {{i{}}}", prev);
+            }
+        }
+        std::string bounds;
+        for (int prev = 0; prev <= dep; prev++) {
+            if (op.is_restricted(prev)) bounds += fmt::format("{}i{}", bounds.empty() ? "" : ", ", prev);
+        }
+        if (!bounds.empty()) out += " | < " + bounds;
+        if (op.is_labeled()) out += fmt::format(" | label {}", op.label());
+        return out;
+    }
+
+    /* brief Expected sizes of the sets of a plan
+     * A candidate set adjacent to k matched vertices holds degree * closure^(k-1) vertices, where closure is the
+     * probability that a neighbor of one matched vertex is adjacent to another; every restriction halves it and a
+     * label keeps one in num_label of the vertices.
+     * */
+    struct SizeModel {
+        double num_vertex{1}, degree{1}, closure{1}, label_rate{1};
+
+        explicit SizeModel(const MetaData &meta) {
+            num_vertex = std::max<double>(1, meta.num_vertex);
+            degree = meta.stats.collected ? meta.stats.edge_degree() : (double) meta.num_edge / num_vertex;
+            closure = meta.stats.collected ? meta.stats.edge_closure()
+                                           : 6.0 * meta.num_triangle / num_vertex / std::max(1.0, degree * degree);
+            closure = std::clamp(closure, 1e-9, 1.0);
+            if (meta.num_label > 0) label_rate = 1.0 / meta.num_label;
+        }
+
+        double size(const VertexSetIR &vset) const {
+            double out = degree * std::pow(closure, std::max(0, vset.edge_num() - 1));
+            out /= std::pow(2.0, vset.restrict_num());
+            if (vset.is_labeled()) out *= label_rate;
+            return std::min(out, num_vertex);
+        }
+    };
+
+    std::string explain_plan(const std::string &adj_mat, const std::vector<int> &labels, CodeGenConfig config,
+                             MetaData meta, const std::vector<ProbeStats> &analyzed) {
+        if (!labels.empty() && config.adjMatType == AdjMatType::EdgeInducedIEP) config.adjMatType = AdjMatType::EdgeInduced;
+        VertexSetIR::adjMatType = config.adjMatType;
+        PlanIR plan = create_plan(adj_mat, labels, config, meta);
+        CurConfig = config;
+        if (config.pruningType != PruningType::None) plan = create_plan_mg(plan, config);
+        EnableProfling = false;
+        plan_filters(plan, config);
+        const int num_probes = iep_probe(plan) + 1;
+        CHECK(analyzed.empty() || (int) analyzed.size() == num_probes)
+            << "The statistics have " << analyzed.size() << " probes but the plan has " << num_probes;
+        SizeModel model(meta);
+        bool iep = config.adjMatType == AdjMatType::EdgeInducedIEP && plan.iep_num > 1;
+        int last_dep = iep ? plan.iep_depth : plan.p_size - 2;
+
+        struct Node {
+            int dep;
+            std::string text;
+            double rows, calls, cost;
+            int probe; // for loops: the probe of the iterated set, -1 for the root loop
+            bool loop;
+        };
+        std::vector<Node> nodes;
+        double calls = model.num_vertex;
+        if (!plan.labels.empty()) calls *= model.label_rate;
+        for (int dep = 0; dep <= last_dep; dep++) {
+            std::string loop = fmt::format("Loop {}: i{} in {}", dep, dep,
+                                           dep == 0 ? "V" : fmt::format("s{}", plan.iter_set.at(dep - 1).id));
+            if (LoopFilter.size() > (size_t) dep && LoopFilter.at(dep) >= 0) {
+                auto [min_degree, min_triangle] = Filters.at(LoopFilter.at(dep));
+                loop += fmt::format(" | degree >= {}, wedges >= {}", min_degree, min_triangle);
+                calls *= 1 - meta.stats.pruned_fraction(min_degree, min_triangle, dep > 0);
+            }
+            nodes.push_back({dep, loop, calls, calls, 0, dep == 0 ? -1 : plan.iter_set.at(dep - 1).id, true});
+            for (const auto &op: plan.set_ops.at(dep)) {
+                auto parent = plan.get_parent_vset(op);
+                double input = parent.has_value() ? model.size(parent.value()) : model.degree;
+                // intersections and subtractions merge an adjacency list, remove() and bounded() only scan
+                bool merges = !parent.has_value() || (parent->loop_depth() < dep
+                                                      && (op.is_edge(dep) || VertexSetIR::adjMatType == AdjMatType::VertexInduced));
+                double cost = calls * (input + (merges && parent.has_value() ? model.degree : 0));
+                if (!parent.has_value() && VertexSetIR::adjMatType == AdjMatType::VertexInduced) cost *= dep + 1;
+                nodes.push_back({dep + 1, explain_op(plan, op), model.size(op) * calls, calls, cost, op.id, false});
+            }
+            if (config.pruningType != PruningType::None && dep < (int) plan.mg_ops.size() && dep < last_dep) {
+                for (const auto &mg: plan.mg_ops.at(dep)) {
+                    double vertices = model.size(mg.m_vertices), intersect = model.size(mg.m_intersect);
+                    nodes.push_back({dep + 1, fmt::format("m{} = MiniGraph(rows s{}, pruned to s{}){}", mg.id,
+                                                          mg.vset_id(), mg.vint_id(), plan.is_bounded(mg) ? " | bounded" : ""),
+                                     vertices * calls, calls, calls * vertices * (model.degree + intersect),
+                                     mg_probe(plan, mg), false});
+                }
+            }
+            if (iep && dep == last_dep) {
+                double input = 0;
+                for (const auto &vset: plan.iep_set) input += model.size(vset);
+                std::string groups;
+                for (size_t group_id = 0; group_id < plan.iep_groups.size(); group_id++) {
+                    std::string comment = gen_comment_iep(plan, group_id);
+                    size_t begin = comment.find("Comp: ");
+                    size_t end = comment.rfind(" */");
+                    std::string comp = begin == std::string::npos ? comment : comment.substr(begin + 6, end - begin - 6);
+                    int val = plan.iep_vals.at(group_id);
+                    groups += fmt::format("{}{}{}", groups.empty() ? (val < 0 ? "-" : "") : (val < 0 ? " - " : " + "),
+                                          std::abs(val) == 1 ? "" : std::to_string(std::abs(val)) + "*", comp);
+                }
+                nodes.push_back({dep + 1, fmt::format("IEP / {}: {}", plan.iep_redundancy, groups), 0, calls,
+                                 calls * input * plan.iep_groups.size(), iep_probe(plan), false});
+            }
+            if (dep < last_dep) calls *= model.size(plan.iter_set.at(dep));
+        }
+
+        double total_cost = 0, total_seconds = 0;
+        for (const auto &node: nodes) total_cost += node.cost;
+        for (const auto &stats: analyzed) total_seconds += stats.seconds;
+        std::ostringstream out;
+        out << fmt::format("Plan of {} ({}, pruning {}), estimated with degree {:.3g} and closure {:.3g}\n", adj_mat,
+                           config.adjMatType == AdjMatType::VertexInduced ? "vertex-induced"
+                           : iep ? "edge-induced with IEP" : "edge-induced",
+                           static_cast<int>(config.pruningType), model.degree, model.closure);
+        if (use_clique_engine(adj_mat, labels, config))
+            out << "run counts this pattern with the clique engine (degeneracy-ordered DAG and bitsets), not this plan\n";
+        for (const auto &node: nodes) {
+            std::string line = std::string(2 * node.dep, ' ') + node.text;
+            if (node.loop) {
+                line += fmt::format("  (est iterations={:.3g})", node.rows);
+                // the iterations of a loop are the elements produced by the op of its set
+                if (!analyzed.empty() && node.probe >= 0)
+                    line += fmt::format("  (actual iterations={})", analyzed.at(node.probe).output);
+            } else {
+                line += fmt::format("  (est calls={:.3g} rows={:.3g} cost={:.3g} {:.1f}%)", node.calls, node.rows,
+                                    node.cost, 100.0 * node.cost / std::max(total_cost, 1e-9));
+                if (!analyzed.empty()) {
+                    const ProbeStats &stats = analyzed.at(node.probe);
+                    line += fmt::format("  (actual calls={} in={} rows={} time={:.3g}s {:.1f}%)", stats.calls,
+                                        stats.input, stats.output, stats.seconds,
+                                        100.0 * stats.seconds / std::max(total_seconds, 1e-9));
+                }
+            }
+            out << line << "\n";
+        }
+        return out.str();
+    }
+
+    std::string gen_code(const std::vector<std::string> &adj_mats, CodeGenConfig config, MetaData meta) {
+        CHECK(!adj_mats.empty()) << "No pattern to generate code for";
+        if (adj_mats.size() == 1) return gen_code(adj_mats.front(), config, meta);
+        if (config.runnerType != RunnerType::Benchmark) {
+            LOG(WARNING) << "Multi-pattern plans only count, fall back to Benchmark";
+            config.runnerType = RunnerType::Benchmark;
+        }
+        if (config.adjMatType == AdjMatType::EdgeInducedIEP) {
+            // IEP replaces the last loops of every pattern by its own formula, which leaves no loop to share
+            LOG(WARNING) << "Multi-pattern plans do not support IEP, fall back to EdgeInduced";
+            config.adjMatType = AdjMatType::EdgeInduced;
+        }
+        if (config.pruningType != PruningType::None) {
+            LOG(WARNING) << "Multi-pattern plans do not support pruning, fall back to None";
+            config.pruningType = PruningType::None;
+        }
+        if (config.parType != ParallelType::OpenMP) {
+            LOG(WARNING) << "Multi-pattern plans only support OpenMP, fall back to OpenMP";
+            config.parType = ParallelType::OpenMP;
+        }
+        VertexSetIR::adjMatType = config.adjMatType;
+        CurConfig = config;
+        EnableProfling = false;
+        EnableEnumeration = false;
+        EnableLocalCount = false;
+        EnableAnalyze = false;
+        LoopFilter.clear();
+        Filters.clear();
+        std::vector<PlanIR> plans;
+        for (const auto &adj_mat: adj_mats) plans.push_back(create_plan(adj_mat, {}, config, meta));
+        LOG(MSG) << "ParallelType=OpenMP Patterns=" << plans.size();
+        EnableBatch = true;
+        std::string code = gen_code_batch_omp(plans, adj_mats);
+        EnableBatch = false;
+        return code;
+    }
+}
@@ -0,0 +1,267 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#include "decompose.h"
+#include "logging.h"
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
+namespace minigraph {
+    namespace {
+        int num_vertices(const std::string &adj_mat) {
+            int p_size = (int) std::sqrt(adj_mat.size());
+            CHECK((size_t) p_size * p_size == adj_mat.size()) << "Invalid adj matrix size, it must be a square number";
+            return p_size;
+        }
+
+        bool has_edge(const std::string &adj_mat, int p_size, int i, int j) {
+            return adj_mat.at(i * p_size + j) == '1';
+        }
+
+        int label_of(const std::vector<int> &labels, int vid) {
+            return labels.empty() ? -1 : labels.at(vid);
+        }
+
+        std::vector<int> degrees(const std::string &adj_mat, int p_size) {
+            std::vector<int> out(p_size, 0);
+            for (int i = 0; i < p_size; i++) {
+                for (int j = 0; j < p_size; j++) out.at(i) += has_edge(adj_mat, p_size, i, j);
+            }
+            return out;
+        }
+
+        /* brief Number of label-preserving isomorphisms from pattern a to pattern b, stopping at limit
+         * fix_first: only count the ones mapping vertex 0 to vertex 0
+         * Vertices of a are mapped in BFS order so that most candidates are cut by an already mapped neighbour.
+         * */
+        uint64_t count_isomorphisms(const std::string &a, const std::vector<int> &a_labels, const std::string &b,
+                                    const std::vector<int> &b_labels, bool fix_first,
+                                    uint64_t limit = std::numeric_limits<uint64_t>::max()) {
+            int p_size = num_vertices(a);
+            if (num_vertices(b) != p_size) return 0;
+            std::vector<int> a_deg = degrees(a, p_size), b_deg = degrees(b, p_size);
+            std::vector<int> order;
+            std::vector<bool> seen(p_size, false);
+            for (int root = 0; root < p_size; root++) {
+                if (seen.at(root)) continue;
+                std::queue<int> q;
+                q.push(root);
+                seen.at(root) = true;
+                while (!q.empty()) {
+                    int vid = q.front();
+                    q.pop();
+                    order.push_back(vid);
+                    for (int nb = 0; nb < p_size; nb++) {
+                        if (has_edge(a, p_size, vid, nb) && !seen.at(nb)) {
+                            seen.at(nb) = true;
+                            q.push(nb);
+                        }
+                    }
+                }
+            }
+            std::vector<int> perm(p_size, -1);
+            std::vector<bool> used(p_size, false);
+            uint64_t out = 0;
+            std::function<void(int)> extend = [&](int pos) {
+                if (out >= limit) return;
+                if (pos == p_size) {
+                    out++;
+                    return;
+                }
+                int vid = order.at(pos);
+                for (int img = 0; img < p_size; img++) {
+                    if (used.at(img) || a_deg.at(vid) != b_deg.at(img)) continue;
+                    if (label_of(a_labels, vid) != label_of(b_labels, img)) continue;
+                    if (fix_first && (vid == 0) != (img == 0)) continue;
+                    bool valid = true;
+                    for (int prev = 0; prev < pos && valid; prev++) {
+                        int u = order.at(prev);
+                        valid = has_edge(a, p_size, vid, u) == has_edge(b, p_size, img, perm.at(u));
+                    }
+                    if (!valid) continue;
+                    used.at(img) = true;
+                    perm.at(vid) = img;
+                    extend(pos + 1);
+                    used.at(img) = false;
+                }
+            };
+            extend(0);
+            return out;
+        }
+
+        // connected components of the pattern without vertex cut
+        std::vector<std::vector<int>> components_without(const std::string &adj_mat, int p_size, int cut) {
+            std::vector<std::vector<int>> out;
+            std::vector<bool> seen(p_size, false);
+            seen.at(cut) = true;
+            for (int root = 0; root < p_size; root++) {
+                if (seen.at(root)) continue;
+                std::vector<int> comp{root};
+                seen.at(root) = true;
+                for (size_t i = 0; i < comp.size(); i++) {
+                    for (int nb = 0; nb < p_size; nb++) {
+                        if (has_edge(adj_mat, p_size, comp.at(i), nb) && !seen.at(nb)) {
+                            seen.at(nb) = true;
+                            comp.push_back(nb);
+                        }
+                    }
+                }
+                out.push_back(comp);
+            }
+            return out;
+        }
+
+        // subgraph induced by vids, renumbered in the order of vids
+        std::pair<std::string, std::vector<int>> induced(const std::string &adj_mat, const std::vector<int> &labels,
+                                                          const std::vector<int> &vids) {
+            int p_size = num_vertices(adj_mat);
+            int size = vids.size();
+            std::string out(size * size, '0');
+            std::vector<int> out_labels;
+            for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                    if (has_edge(adj_mat, p_size, vids.at(i), vids.at(j))) out.at(i * size + j) = '1';
+                }
+                if (!labels.empty()) out_labels.push_back(labels.at(vids.at(i)));
+            }
+            return {out, out_labels};
+        }
+
+        // matchings between the non-cut vertices of the sides that only pair vertices of the same label
+        double num_matchings(const std::vector<int> &labels, const std::vector<int> &side0, const std::vector<int> &side1) {
+            std::map<int, std::pair<int, int>> groups;
+            for (size_t i = 1; i < side0.size(); i++) groups[label_of(labels, side0.at(i))].first++;
+            for (size_t i = 1; i < side1.size(); i++) groups[label_of(labels, side1.at(i))].second++;
+            double out = 1;
+            for (const auto &[label, sizes]: groups) {
+                // sum_k C(a, k) * C(b, k) * k!
+                double sum = 0, term = 1;
+                for (int k = 0; k <= std::min(sizes.first, sizes.second); k++) {
+                    sum += term;
+                    term *= (double) (sizes.first - k) * (sizes.second - k) / (k + 1);
+                }
+                out *= sum;
+            }
+            return out;
+        }
+
+        // (label, degree) multiset; isomorphic patterns share it
+        std::string invariant(const std::string &adj_mat, const std::vector<int> &labels) {
+            int p_size = num_vertices(adj_mat);
+            std::vector<std::pair<int, int>> keys;
+            std::vector<int> deg = degrees(adj_mat, p_size);
+            for (int vid = 0; vid < p_size; vid++) keys.emplace_back(label_of(labels, vid), deg.at(vid));
+            std::sort(keys.begin(), keys.end());
+            std::string out = std::to_string(p_size);
+            for (auto [label, degree]: keys) out += " " + std::to_string(label) + ":" + std::to_string(degree);
+            return out;
+        }
+    }
+
+    bool decompose_pattern(const std::string &adj_mat, const std::vector<int> &labels, PatternDecomposition &out,
+                           uint64_t max_matchings) {
+        int p_size = num_vertices(adj_mat);
+        // smaller patterns would need quotients of two vertices, which are not plans
+        if (p_size < 4) return false;
+        int min_side = labels.empty() ? 2 : 3;
+        std::tuple<int, double, int> best{p_size + 1, 0, -1};
+        std::array<std::vector<int>, 2> best_sides;
+        for (int cut = 0; cut < p_size; cut++) {
+            std::vector<std::vector<int>> comps = components_without(adj_mat, p_size, cut);
+            if (comps.size() < 2) continue;
+            // the largest components first, each to the currently smaller side
+            std::sort(comps.begin(), comps.end(), [](const auto &l, const auto &r) { return l.size() > r.size(); });
+            std::array<std::vector<int>, 2> sides{std::vector<int>{cut}, std::vector<int>{cut}};
+            for (const auto &comp: comps) {
+                auto &side = sides[0].size() <= sides[1].size() ? sides[0] : sides[1];
+                side.insert(side.end(), comp.begin(), comp.end());
+            }
+            if ((int) std::min(sides[0].size(), sides[1].size()) < min_side) continue;
+            for (auto &side: sides) std::sort(side.begin() + 1, side.end());
+            double matchings = num_matchings(labels, sides[0], sides[1]);
+            if (matchings > max_matchings) continue;
+            std::tuple<int, double, int> cand{std::max(sides[0].size(), sides[1].size()), matchings, cut};
+            if (cand < best) {
+                best = cand;
+                best_sides = sides;
+            }
+        }
+        if (std::get<2>(best) < 0) return false;
+
+        out = PatternDecomposition{};
+        out.cut = std::get<2>(best);
+        out.num_automorphisms = count_isomorphisms(adj_mat, labels, adj_mat, labels, false);
+        for (int s = 0; s < 2; s++) {
+            std::tie(out.side_mats[s], out.side_labels[s]) = induced(adj_mat, labels, best_sides[s]);
+            if (best_sides[s].size() > 2) {
+                out.side_stabilizer[s] = count_isomorphisms(out.side_mats[s], out.side_labels[s], out.side_mats[s],
+                                                            out.side_labels[s], true);
+            }
+        }
+
+        // every non-empty matching of side-0 and side-1 vertices identifies them into a quotient pattern
+        const std::vector<int> &side0 = best_sides[0], &side1 = best_sides[1];
+        std::vector<int> partner(p_size, -1); // side-1 vertex -> the side-0 vertex it is identified with
+        std::vector<bool> taken(p_size, false);
+        std::multimap<std::string, size_t> classes;
+        std::function<void(size_t, bool)> extend = [&](size_t i, bool matched) {
+            if (i == side0.size()) {
+                if (!matched) return;
+                std::vector<int> rep(p_size), vids;
+                std::iota(rep.begin(), rep.end(), 0);
+                for (int vid = 0; vid < p_size; vid++) {
+                    if (partner.at(vid) >= 0) rep.at(vid) = partner.at(vid);
+                    else vids.push_back(vid);
+                }
+                std::vector<int> idx(p_size, -1);
+                for (size_t k = 0; k < vids.size(); k++) idx.at(vids.at(k)) = k;
+                int q_size = vids.size();
+                QuotientPattern q;
+                q.adj_mat.assign(q_size * q_size, '0');
+                for (int u = 0; u < p_size; u++) {
+                    for (int v = 0; v < p_size; v++) {
+                        if (has_edge(adj_mat, p_size, u, v))
+                            q.adj_mat.at(idx.at(rep.at(u)) * q_size + idx.at(rep.at(v))) = '1';
+                    }
+                }
+                if (!labels.empty()) {
+                    for (int vid: vids) q.labels.push_back(labels.at(vid));
+                }
+                std::string key = invariant(q.adj_mat, q.labels);
+                auto range = classes.equal_range(key);
+                for (auto itr = range.first; itr != range.second; itr++) {
+                    QuotientPattern &other = out.quotients.at(itr->second);
+                    if (count_isomorphisms(q.adj_mat, q.labels, other.adj_mat, other.labels, false, 1) > 0) {
+                        other.multiplicity++;
+                        return;
+                    }
+                }
+                q.num_automorphisms = count_isomorphisms(q.adj_mat, q.labels, q.adj_mat, q.labels, false);
+                q.multiplicity = 1;
+                classes.emplace(key, out.quotients.size());
+                out.quotients.push_back(q);
+                return;
+            }
+            extend(i + 1, matched);
+            int u = side0.at(i);
+            for (size_t j = 1; j < side1.size(); j++) {
+                int v = side1.at(j);
+                if (taken.at(v) || label_of(labels, u) != label_of(labels, v)) continue;
+                taken.at(v) = true;
+                partner.at(v) = u;
+                extend(i + 1, true);
+                partner.at(v) = -1;
+                taken.at(v) = false;
+            }
+        };
+        extend(1, false);
+        return true;
+    }
+}
@@ -8,8 +8,8 @@
 namespace minigraph
 {
 
-    VertexSetIR::VertexSetIR(const EdgeIR &edges, const EdgeRestrictIR restricts, int loop_depth) :
-            m_loop_depth{loop_depth} {
+    VertexSetIR::VertexSetIR(const EdgeIR &edges, const EdgeRestrictIR restricts, int loop_depth, int label) :
+            m_loop_depth{loop_depth}, m_label{label} {
         for (int i = 0; i <= loop_depth; i++) {
             m_edges[i] = edges[i];
             m_restricts[i] = restricts[i];
@@ -27,7 +27,8 @@ namespace minigraph
     bool VertexSetIR::operator==(const VertexSetIR &rhs) const {
         return m_edges == rhs.m_edges &&
                m_restricts == rhs.m_restricts &&
-               m_loop_depth == rhs.m_loop_depth;
+               m_loop_depth == rhs.m_loop_depth &&
+               m_label == rhs.m_label;
     }
 
     bool VertexSetIR::same_iep_computation(const VertexSetIR &rhs) const {
@@ -36,6 +37,7 @@ namespace minigraph
                 return false;
 
             default:
+                if (m_label != rhs.m_label) return false;
                 int min_dep = std::min(rhs.loop_depth(), loop_depth());
                 for (int i = 0; i <= min_dep; ++i) {
                     if (is_edge(i) != rhs.is_edge(i) || is_restricted(i) != rhs.is_restricted(i)) return false;
@@ -64,11 +66,12 @@ namespace minigraph
                 return true;
             }
         }
-        return false;
+        return m_label < rhs.m_label;
     }
 
     bool VertexSetIR::is_superset_of(const VertexSetIR &rhs) const {
         if (m_loop_depth > rhs.m_loop_depth) return false;
+        if (m_label != rhs.m_label) return false; // candidates of different labels are disjoint
         for (int i = 0; i <= m_loop_depth; i++) {
             if (adjMatType == AdjMatType::VertexInduced) {
                 if ((rhs.is_edge(i) != is_edge(i)) ||
@@ -98,6 +101,7 @@ namespace minigraph
         for (int dep = 0; dep <= v.loop_depth(); dep++){
             if (v.m_restricts[dep]) out << dep << " ";
         }
+        if (v.is_labeled()) out << "Label: " << v.m_label << " ";
         out << "*/\n";
         return out;
     };
@@ -218,7 +222,8 @@ namespace minigraph
         return vset.is_restricted(vset.loop_depth());
     };
     bool PlanIR::is_last_op(const VertexSetIR &op) const {
-        return op.loop_depth() == p_size - 2;
+        if (op.loop_depth() == p_size - 2) return true;
+        return std::find(last_ops.begin(), last_ops.end(), op.id) != last_ops.end();
     };
 
     bool PlanIR::is_par(const MiniGraphIR& mg) const {
@@ -1,8 +1,9 @@
 #include "plan.h"
 namespace minigraph {
 uint64_t pattern_size() { return 7; }
+uint64_t num_orbits() { return 0; }
+uint64_t min_core() { return 0; }
 static const Graph *graph;
-using MiniGraphType = MiniGraphCostModel;
 class Loop4 {
 private:
   Context &ctx;
@@ -14,12 +15,12 @@ private:
   // MiniGraphs Indices
   ManagedContainer &m4_s11;
   // MiniGraphs
-  MiniGraphType &m4;
-  MiniGraphType &m5;
+  MiniGraphCostModel<false, MiniGraphCostModel<false, void>> &m4;
+  MiniGraphCostModel<false, void> &m5;
 
 public:
   Loop4(Context &_ctx, VertexSet &_s9, VertexSet &_s10, VertexSet &_s11,
-        ManagedContainer &_m4_s11, MiniGraphType &_m4, MiniGraphType &_m5)
+        ManagedContainer &_m4_s11, MiniGraphCostModel<false, MiniGraphCostModel<false, void>> &_m4, MiniGraphCostModel<false, void> &_m5)
       : ctx{_ctx}, s9{_s9}, s10{_s10}, s11{_s11}, m4_s11{_m4_s11}, m4{_m4},
         m5{_m5} {};
   void operator()(const tbb::blocked_range<size_t> &r) const { // operator begin
@@ -62,15 +63,15 @@ private:
   ManagedContainer &m2_s8;
   ManagedContainer &m1_s8;
   // MiniGraphs
-  MiniGraphType &m2;
-  MiniGraphType &m1;
-  MiniGraphType &m4;
+  MiniGraphCostModel<false, void> &m2;
+  MiniGraphCostModel<false, void> &m1;
+  MiniGraphCostModel<false, MiniGraphCostModel<false, void>> &m4;
 
 public:
   Loop3(Context &_ctx, VertexSet &_i0_adj, VertexSet &_i1_adj,
         VertexSet &_i2_adj, VertexSet &_s6, VertexSet &_s7, VertexSet &_s8,
-        ManagedContainer &_m2_s8, ManagedContainer &_m1_s8, MiniGraphType &_m2,
-        MiniGraphType &_m1, MiniGraphType &_m4)
+        ManagedContainer &_m2_s8, ManagedContainer &_m1_s8, MiniGraphCostModel<false, void> &_m2,
+        MiniGraphCostModel<false, void> &_m1, MiniGraphCostModel<false, MiniGraphCostModel<false, void>> &_m4)
       : ctx{_ctx}, i0_adj{_i0_adj}, i1_adj{_i1_adj}, i2_adj{_i2_adj}, s6{_s6},
         s7{_s7}, s8{_s8}, m2_s8{_m2_s8}, m1_s8{_m1_s8}, m2{_m2}, m1{_m1},
         m4{_m4} {};
@@ -94,7 +95,7 @@ public:
       if (s11.size() == 0)
         continue;
       /* VSet(11, 3) In-Edges: 0 Restricts: */
-      MiniGraphType m5(false, false);
+      MiniGraphCostModel<false, void> m5(false);
       /* Vertices = VSet(10) In-Edges: 1 2 Restricts: 0  | Intersect = VSet(9)
        * In-Edges: 3 Restricts: */
       double m5_factor = 0;
@@ -145,16 +146,16 @@ private:
   // MiniGraphs Indices
   ManagedContainer &m0_s5;
   // MiniGraphs
-  MiniGraphType &m3;
-  MiniGraphType &m0;
-  MiniGraphType &m2;
-  MiniGraphType &m1;
+  MiniGraphCostModel<false, void> &m3;
+  MiniGraphCostModel<false, void> &m0;
+  MiniGraphCostModel<false, void> &m2;
+  MiniGraphCostModel<false, void> &m1;
 
 public:
   Loop2(Context &_ctx, VertexSet &_i0_adj, VertexSet &_i1_adj, VertexSet &_s3,
         VertexSet &_s4, VertexSet &_s2, VertexSet &_s5,
-        ManagedContainer &_m0_s5, MiniGraphType &_m3, MiniGraphType &_m0,
-        MiniGraphType &_m2, MiniGraphType &_m1)
+        ManagedContainer &_m0_s5, MiniGraphCostModel<false, void> &_m3, MiniGraphCostModel<false, void> &_m0,
+        MiniGraphCostModel<false, void> &_m2, MiniGraphCostModel<false, void> &_m1)
       : ctx{_ctx}, i0_adj{_i0_adj}, i1_adj{_i1_adj}, s3{_s3}, s4{_s4}, s2{_s2},
         s5{_s5}, m0_s5{_m0_s5}, m3{_m3}, m0{_m0}, m2{_m2}, m1{_m1} {};
   void operator()(const tbb::blocked_range<size_t> &r) const { // operator begin
@@ -175,7 +176,7 @@ public:
       /* VSet(7, 2) In-Edges: 0 Restricts: */
       VertexSet s8 = s2.intersect(i2_adj);
       /* VSet(8, 2) In-Edges: 1 2 Restricts: */
-      MiniGraphType m4(false, false);
+      MiniGraphCostModel<false, MiniGraphCostModel<false, void>> m4(false);
       /* Vertices = VSet(7) In-Edges: 0 Restricts:  | Intersect = VSet(6)
        * In-Edges: 1 2 Restricts: 0 */
       double m4_factor = 0;
@@ -209,7 +210,7 @@ public:
         if (s11.size() == 0)
           continue;
         /* VSet(11, 3) In-Edges: 0 Restricts: */
-        MiniGraphType m5(false, false);
+        MiniGraphCostModel<false, void> m5(false);
         /* Vertices = VSet(10) In-Edges: 1 2 Restricts: 0  | Intersect = VSet(9)
          * In-Edges: 3 Restricts: */
         double m5_factor = 0;
@@ -258,11 +259,11 @@ private:
   VertexSet &s1;
   // MiniGraphs Indices
   // MiniGraphs
-  MiniGraphType &m0;
+  MiniGraphCostModel<false, void> &m0;
 
 public:
   Loop1(Context &_ctx, VertexSet &_i0_adj, VertexSet &_s0, VertexSet &_s1,
-        MiniGraphType &_m0)
+        MiniGraphCostModel<false, void> &_m0)
       : ctx{_ctx}, i0_adj{_i0_adj}, s0{_s0}, s1{_s1}, m0{_m0} {};
   void operator()(const tbb::blocked_range<size_t> &r) const { // operator begin
     const int worker_id = tbb::this_task_arena::current_thread_index();
@@ -287,21 +288,21 @@ public:
       if (s5.size() == 0)
         continue;
       /* VSet(5, 1) In-Edges: 0 Restricts: 0 1 */
-      MiniGraphType m1(false, false);
+      MiniGraphCostModel<false, void> m1(false);
       /* Vertices = VSet(2) In-Edges: 1 Restricts:  | Intersect = VSet(4)
        * In-Edges: 0 Restricts: */
       double m1_factor = 0;
       m1_factor += s5.size() * s2.size() * 0.75 * 1;
       m1.set_reuse_multiplier(m1_factor);
       m1.build(s2, s4, s5);
-      MiniGraphType m2(false, false);
+      MiniGraphCostModel<false, void> m2(false);
       /* Vertices = VSet(2) In-Edges: 1 Restricts:  | Intersect = VSet(3)
        * In-Edges: 1 Restricts: 0 */
       double m2_factor = 0;
       m2_factor += s5.size() * s2.size() * 0.75 * 1;
       m2.set_reuse_multiplier(m2_factor);
       m2.build(s2, s3, s5);
-      MiniGraphType m3(false, false);
+      MiniGraphCostModel<false, void> m3(false);
       /* Vertices = VSet(4) In-Edges: 0 Restricts:  | Intersect = VSet(3)
        * In-Edges: 1 Restricts: 0 */
       double m3_factor = 0;
@@ -332,7 +333,7 @@ public:
         /* VSet(7, 2) In-Edges: 0 Restricts: */
         VertexSet s8 = s2.intersect(i2_adj);
         /* VSet(8, 2) In-Edges: 1 2 Restricts: */
-        MiniGraphType m4(false, false);
+        MiniGraphCostModel<false, MiniGraphCostModel<false, void>> m4(false);
         /* Vertices = VSet(7) In-Edges: 0 Restricts:  | Intersect = VSet(6)
          * In-Edges: 1 2 Restricts: 0 */
         double m4_factor = 0;
@@ -366,7 +367,7 @@ public:
           if (s11.size() == 0)
             continue;
           /* VSet(11, 3) In-Edges: 0 Restricts: */
-          MiniGraphType m5(false, false);
+          MiniGraphCostModel<false, void> m5(false);
           /* Vertices = VSet(10) In-Edges: 1 2 Restricts: 0  | Intersect =
            * VSet(9) In-Edges: 3 Restricts: */
           double m5_factor = 0;
@@ -423,7 +424,7 @@ public:
       /* VSet(0, 0) In-Edges: 0 Restricts: */
       VertexSet s1 = s0.bounded(i0_id);
       /* VSet(1, 0) In-Edges: 0 Restricts: 0 */
-      MiniGraphType m0(false, false);
+      MiniGraphCostModel<false, void> m0(false);
       /* Vertices = VSet(1) In-Edges: 0 Restricts: 0  | Intersect = VSet(0)
        * In-Edges: 0 Restricts: */
       double m0_factor = 0;
@@ -457,21 +458,21 @@ public:
         if (s5.size() == 0)
           continue;
         /* VSet(5, 1) In-Edges: 0 Restricts: 0 1 */
-        MiniGraphType m1(false, false);
+        MiniGraphCostModel<false, void> m1(false);
         /* Vertices = VSet(2) In-Edges: 1 Restricts:  | Intersect = VSet(4)
          * In-Edges: 0 Restricts: */
         double m1_factor = 0;
         m1_factor += s5.size() * s2.size() * 0.75 * 1;
         m1.set_reuse_multiplier(m1_factor);
         m1.build(s2, s4, s5);
-        MiniGraphType m2(false, false);
+        MiniGraphCostModel<false, void> m2(false);
         /* Vertices = VSet(2) In-Edges: 1 Restricts:  | Intersect = VSet(3)
          * In-Edges: 1 Restricts: 0 */
         double m2_factor = 0;
         m2_factor += s5.size() * s2.size() * 0.75 * 1;
         m2.set_reuse_multiplier(m2_factor);
         m2.build(s2, s3, s5);
-        MiniGraphType m3(false, false);
+        MiniGraphCostModel<false, void> m3(false);
         /* Vertices = VSet(4) In-Edges: 0 Restricts:  | Intersect = VSet(3)
          * In-Edges: 1 Restricts: 0 */
         double m3_factor = 0;
@@ -502,7 +503,7 @@ public:
           /* VSet(7, 2) In-Edges: 0 Restricts: */
           VertexSet s8 = s2.intersect(i2_adj);
           /* VSet(8, 2) In-Edges: 1 2 Restricts: */
-          MiniGraphType m4(false, false);
+          MiniGraphCostModel<false, MiniGraphCostModel<false, void>> m4(false);
           /* Vertices = VSet(7) In-Edges: 0 Restricts:  | Intersect = VSet(6)
            * In-Edges: 1 2 Restricts: 0 */
           double m4_factor = 0;
@@ -537,7 +538,7 @@ public:
             if (s11.size() == 0)
               continue;
             /* VSet(11, 3) In-Edges: 0 Restricts: */
-            MiniGraphType m5(false, false);
+            MiniGraphCostModel<false, void> m5(false);
             /* Vertices = VSet(10) In-Edges: 1 2 Restricts: 0  | Intersect =
              * VSet(9) In-Edges: 3 Restricts: */
             double m5_factor = 0;
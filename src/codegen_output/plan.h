@@ -6,4 +6,6 @@ namespace minigraph
     using VertexSetType = VertexSet;
     void plan(const GraphType* graph, Context& ctx);
     uint64_t pattern_size();
+    uint64_t num_orbits(); // columns of Context::local_counts; 0 if the plan does not count per vertex
+    uint64_t min_core(); // minimum degree of the pattern: the plan only matches inside this core of the graph
 }
@@ -0,0 +1,99 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+#include "codegen.h"
+#include "logging.h"
+#include "configure.h"
+#include "common.h"
+#include "frontend.h"
+#include <vector>
+#include <iostream>
+#include <fmt/format.h>
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+using namespace minigraph;
+
+// <key><value> line printed by the runner
+std::string parse_value(const std::string &run_results, const std::string &key) {
+    size_t pos = run_results.find(key);
+    CHECK(pos != std::string::npos) << "Missing " << key << " in the runner output:\n" << run_results;
+    return run_results.substr(pos + key.size(), run_results.find('\n', pos) - pos - key.size());
+}
+
+// lines "probe calls input output nanoseconds" saved by PlanAnalyzer
+std::vector<ProbeStats> read_analyze(const std::filesystem::path &path) {
+    std::ifstream in(path);
+    CHECK(in.is_open()) << "Failed to open " << path;
+    std::vector<ProbeStats> out;
+    size_t probe;
+    uint64_t nanos;
+    ProbeStats stats;
+    while (in >> probe >> stats.calls >> stats.input >> stats.output >> nanos) {
+        stats.seconds = nanos / 1e9;
+        out.resize(std::max(out.size(), probe + 1));
+        out.at(probe) = stats;
+    }
+    return out;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 7) {
+        std::cout << "./explain [graph_name] [graph_dir] [query_name] [query] [adj_type] [prun_type] [analyze=0 (optional)]\n";
+        std::cout << "Prints the plan run would generate for a query as a tree of loops, set operations, MiniGraphs and\n"
+                     "IEP groups with their estimated calls, sizes and share of the cost.\n";
+        std::cout << "analyze=1: also runs the plan with every op instrumented (OpenMP, OMP_NUM_THREADS threads) and\n"
+                     "prints the actual calls, sizes and time next to the estimates.\n";
+        std::cout << "query: adjacency matrix of the pattern or a pattern file, as for run\n";
+        std::cout << "adj_type: 0=VertexInduced; 1=EdgeInduced; 2=EdgeInducedIEP\n";
+        std::cout << "prun_type: 0=None; 1=Static; 2=Eager; 3=Online; 4=CostModel\n";
+        std::cout << "For example:\n./build/bin/explain wiki ./dataset/GraphMini/wiki P1 0111101111011110 0 4 1\n";
+        return 0;
+    }
+    std::string graph_name{argv[1]};
+    std::string graph_dir{argv[2]};
+    std::string query_name{argv[3]};
+    std::string query_str{argv[4]};
+    int adjmat_type_int = std::atoi(argv[5]);
+    int prun_type_int = std::atoi(argv[6]);
+    bool analyze = argc >= 8 && std::atoi(argv[7]) != 0;
+
+    std::string pat;
+    std::vector<int> labels;
+    if (std::filesystem::is_regular_file(query_str)) {
+        pat = read_pattern(query_str, labels);
+    } else {
+        pat = query_str;
+    }
+    CHECK(pat.find(',') == std::string::npos) << "Multi-pattern queries are not supported";
+
+    MetaData meta;
+    meta.read(graph_dir);
+    CodeGenConfig conf;
+    conf.adjMatType = static_cast<AdjMatType>(adjmat_type_int);
+    conf.pruningType = static_cast<PruningType>(prun_type_int);
+    conf.parType = ParallelType::OpenMP;
+    LOG(MSG) << "Graph=" << graph_name << " Query=" << query_name;
+    if (!analyze) {
+        std::cout << explain_plan(pat, labels, conf, meta);
+        return 0;
+    }
+
+    conf.runnerType = RunnerType::Analyze;
+    std::ofstream out_file(code_path());
+    out_file << gen_code(pat, labels, conf, meta);
+    out_file.close();
+    auto compile_cmd = compile_runner_cmd();
+    if (system(compile_cmd.c_str()) != 0) exit(-1 && "compilation error");
+
+    std::filesystem::path stats_path = std::filesystem::path(PROJECT_PLAN_DIR) / "analyze.txt";
+    std::filesystem::create_directories(stats_path.parent_path());
+    auto run_cmd = fmt::format("MINIGRAPH_ANALYZE={stats_path} {bin_path} -1 {data_dir}",
+                               fmt::arg("stats_path", stats_path.string()), fmt::arg("bin_path", runner_path().string()),
+                               fmt::arg("data_dir", graph_dir));
+    std::string run_results = exec(run_cmd.c_str());
+    LOG(MSG) << "RESULT=" << parse_value(run_results, "RESULT=")
+             << " CODE_EXECUTION_TIME(s)=" << parse_value(run_results, "CODE_EXECUTION_TIME(s)=");
+    std::cout << explain_plan(pat, labels, conf, meta, read_analyze(stats_path));
+}
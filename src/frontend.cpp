@@ -0,0 +1,41 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#include "frontend.h"
+#include "configure.h"
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+namespace minigraph
+{
+    std::string exec(const char *cmd) {
+        std::array<char, 128> buffer;
+        std::string result;
+        std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
+        if (!pipe) {
+            throw std::runtime_error("popen() failed!");
+        }
+        while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
+            result += buffer.data();
+        }
+        return result;
+    }
+
+    std::filesystem::path code_path() {
+        std::filesystem::path code_file(PROJECT_SOURCE_DIR);
+        code_file /= "src";
+        code_file /= "codegen_output";
+        code_file /= "plan.cpp";
+        return code_file;
+    }
+
+    std::filesystem::path runner_path() {
+        return std::filesystem::path(CMAKE_RUNTIME_OUTPUT_DIRECTORY) / "runner";
+    }
+
+    std::string compile_runner_cmd() {
+        return std::string("cmake --build ") + PROJECT_BINARY_DIR + " --target runner 1>>/dev/null 2>>/dev/null";
+    }
+}
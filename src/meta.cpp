@@ -12,6 +12,8 @@
 #include <vector>
 #include <iterator>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
 namespace minigraph
 {
 
@@ -25,6 +27,7 @@ namespace minigraph
         meta << Constant::kMetaMaxDegree << "\t" << max_degree << "\n";
         meta << Constant::kMetaMaxOffset << "\t" << max_offset << "\n";
         meta << Constant::kMetaMaxTriangle << "\t" << max_triangle << "\n";
+        meta << Constant::kMetaNumLabel << "\t" << num_label << "\n";
         meta.close();
     }
 
@@ -56,6 +59,165 @@ namespace minigraph
         max_degree = items[Constant::kMetaMaxDegree];
         max_offset = items[Constant::kMetaMaxOffset];
         max_triangle = items[Constant::kMetaMaxTriangle];
+        if (items.count(Constant::kMetaNumLabel) > 0) num_label = items[Constant::kMetaNumLabel];
         num_triangle /= 6; // remove automorphism to make it in consistent with GraphPi
+        cost.read(in_dir);
+        stats.read(in_dir);
     }
-}
\ No newline at end of file
+
+    void CostModelParams::save(std::string in_dir) {
+        std::filesystem::path path = in_dir;
+        path /= Constant::kCostModelFile;
+        std::ofstream file(path, std::ios_base::out);
+        file << Constant::kCostBuildNs << "\t" << build_ns << "\n";
+        file << Constant::kCostScanNs << "\t" << scan_ns << "\n";
+        file << Constant::kCostReuseScale << "\t" << reuse_scale << "\n";
+        file << Constant::kCostLargeDegreeFactor << "\t" << large_degree_factor << "\n";
+        file.close();
+    }
+
+    void CostModelParams::read(std::string in_dir) {
+        std::filesystem::path path = in_dir;
+        path /= Constant::kCostModelFile;
+        if (!std::filesystem::is_regular_file(path)) return;
+        std::ifstream file(path);
+        std::string line;
+        std::unordered_map<std::string, double> items;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::vector<std::string> kv{std::istream_iterator<std::string>{iss},
+                                        std::istream_iterator<std::string>{}};
+            if (kv.size() < 2) {
+                break;
+            }
+            items[kv[0]] = std::stod(kv[1]);
+        }
+        calibrated = true;
+        if (items.count(Constant::kCostBuildNs) > 0) build_ns = items[Constant::kCostBuildNs];
+        if (items.count(Constant::kCostScanNs) > 0) scan_ns = items[Constant::kCostScanNs];
+        if (items.count(Constant::kCostReuseScale) > 0) reuse_scale = items[Constant::kCostReuseScale];
+        if (items.count(Constant::kCostLargeDegreeFactor) > 0) large_degree_factor = items[Constant::kCostLargeDegreeFactor];
+    }
+
+    void GraphStats::save(std::string in_dir) {
+        std::filesystem::path path = in_dir;
+        path /= Constant::kStatsFile;
+        std::ofstream file(path, std::ios_base::out);
+        for (size_t b = 0; b < buckets.size(); b++) {
+            const Bucket &bucket = buckets.at(b);
+            file << Constant::kStatsBucket << "\t" << b << "\t" << bucket.num_vertex << "\t" << bucket.sum_degree
+                 << "\t" << bucket.sum_degree2 << "\t" << bucket.sum_triangle << "\n";
+        }
+        for (auto [key, dist]: {std::pair<std::string, const Distribution *>{Constant::kStatsEdgeCommon, &edge_common},
+                                {Constant::kStatsWedgeCommon, &wedge_common},
+                                {Constant::kStatsTwoHop, &two_hop}}) {
+            file << key << "\t" << dist->mean << "\t" << dist->p50 << "\t" << dist->p90 << "\t" << dist->p99 << "\n";
+        }
+        file.close();
+    }
+
+    void GraphStats::read(std::string in_dir) {
+        std::filesystem::path path = in_dir;
+        path /= Constant::kStatsFile;
+        if (!std::filesystem::is_regular_file(path)) return;
+        std::ifstream file(path);
+        std::string line;
+        buckets.clear();
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string key;
+            iss >> key;
+            if (key == Constant::kStatsBucket) {
+                size_t b;
+                Bucket bucket;
+                iss >> b >> bucket.num_vertex >> bucket.sum_degree >> bucket.sum_degree2 >> bucket.sum_triangle;
+                if (buckets.size() <= b) buckets.resize(b + 1);
+                buckets.at(b) = bucket;
+            } else {
+                Distribution dist;
+                iss >> dist.mean >> dist.p50 >> dist.p90 >> dist.p99;
+                if (key == Constant::kStatsEdgeCommon) edge_common = dist;
+                else if (key == Constant::kStatsWedgeCommon) wedge_common = dist;
+                else if (key == Constant::kStatsTwoHop) two_hop = dist;
+            }
+        }
+        collected = !buckets.empty();
+    }
+
+    double GraphStats::edge_degree() const {
+        double sum_degree = 0, sum_degree2 = 0;
+        for (const Bucket &bucket: buckets) {
+            sum_degree += bucket.sum_degree;
+            sum_degree2 += bucket.sum_degree2;
+        }
+        return sum_degree == 0 ? 0 : sum_degree2 / sum_degree;
+    }
+
+    double GraphStats::edge_closure() const {
+        double sum_triangle = 0, sum_wedge = 0;
+        for (const Bucket &bucket: buckets) {
+            sum_triangle += bucket.sum_triangle;
+            sum_wedge += (double) bucket.sum_degree2 - bucket.sum_degree;
+        }
+        return sum_wedge == 0 ? 0 : sum_triangle / sum_wedge;
+    }
+
+    double GraphStats::wedge_closure() const {
+        double degree = edge_degree();
+        return degree == 0 ? 0 : std::min(1.0, wedge_common.mean / degree);
+    }
+
+    double GraphStats::pruned_fraction(uint64_t min_degree, uint64_t min_triangle, bool per_endpoint) const {
+        double pruned = 0, total = 0;
+        for (size_t b = 0; b < buckets.size(); b++) {
+            const Bucket &bucket = buckets.at(b);
+            if (bucket.num_vertex == 0) continue;
+            const double low = std::pow(2.0, b);
+            double below_degree = std::clamp((min_degree - low) / low, 0.0, 1.0);
+            double mean_triangle = (double) bucket.sum_triangle / bucket.num_vertex;
+            double below_triangle = min_triangle == 0 ? 0 : mean_triangle == 0 ? 1 : std::min(1.0, min_triangle / (2 * mean_triangle));
+            double weight = per_endpoint ? bucket.sum_degree : bucket.num_vertex;
+            pruned += weight * (1 - (1 - below_degree) * (1 - below_triangle));
+            total += weight;
+        }
+        return total == 0 ? 0 : pruned / total;
+    }
+
+    std::string TuningRecords::pattern_key(const std::string &adj_mat, const std::vector<int> &labels) {
+        std::string out = adj_mat;
+        for (size_t i = 0; i < labels.size(); i++) out += (i == 0 ? ":" : ",") + std::to_string(labels.at(i));
+        return out;
+    }
+
+    void TuningRecords::save(std::string in_dir) {
+        std::filesystem::path path = in_dir;
+        path /= Constant::kTuneFile;
+        std::ofstream file(path, std::ios_base::out);
+        for (const auto &[key, decision]: decisions) {
+            const auto &[pattern, adj_type, num_threads] = key;
+            file << Constant::kTuneDecision << "\t" << pattern << "\t" << adj_type << "\t" << num_threads << "\t"
+                 << decision.pruning_type << "\t" << decision.parallel_type << "\t" << decision.order_rank << "\t"
+                 << decision.estimated_seconds << "\n";
+        }
+        file.close();
+    }
+
+    void TuningRecords::read(std::string in_dir) {
+        std::filesystem::path path = in_dir;
+        path /= Constant::kTuneFile;
+        decisions.clear();
+        if (!std::filesystem::is_regular_file(path)) return;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string key, pattern;
+            int adj_type, num_threads;
+            Decision decision;
+            iss >> key >> pattern >> adj_type >> num_threads >> decision.pruning_type >> decision.parallel_type
+                >> decision.order_rank >> decision.estimated_seconds;
+            if (!iss || key != Constant::kTuneDecision) continue;
+            decisions[{pattern, adj_type, num_threads}] = decision;
+        }
+    }
+}
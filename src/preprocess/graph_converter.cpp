@@ -128,6 +128,7 @@ namespace minigraph {
         t.Reset();
 
         v_num = nextID;
+        load_labels(idMap);
         // build indices
         degrees.resize(v_num, 0);
         offsets.resize(v_num, 0);
@@ -168,12 +169,134 @@ namespace minigraph {
         max_offset = parallel_max(offsets);
         max_tri = parallel_max(triangles);
         LOG(INFO) << "Finished counting triangles in: " << t.Passed() << " seconds";
+        build_label_index();
     }
 
+    void GraphConverter::load_labels(const std::vector<uint64_t> &idMap) {
+        if (!std::filesystem::is_regular_file(label_file)) return;
+        LOG(INFO) << "Loading labels from file: " << label_file;
+        labels.resize(v_num, 0); // vertices missing from labels.txt get label 0
+        uint64_t vid = 0, label = 0, max_label = 0;
+        std::string line;
+        std::istringstream iss;
+        std::ifstream infile(label_file.c_str());
+        while (nextSNAPline(infile, line, iss, vid, label)) {
+            // isolated vertices never appear in snap.txt and are not part of the graph
+            if (vid >= idMap.size() || idMap.at(vid) == Constant::EmptyID<uint64_t>()) continue;
+            labels.at(idMap.at(vid)) = label;
+            max_label = std::max(max_label, label);
+        }
+        CHECK(max_label < std::numeric_limits<uint32_t>::max()) << "Label out of range: " << max_label;
+        l_num = max_label + 1;
+    }
+
+    void GraphConverter::build_label_index() {
+        if (l_num == 0) return;
+        Timer t;
+        label_indices.resize(indices.size());
+        label_offsets.resize(v_num * l_num);
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, v_num), [this](tbb::blocked_range<uint64_t> r) {
+            for (uint64_t i = r.begin(); i != r.end(); i++) {
+                auto v1_start = label_indices.begin() + indptr.at(i);
+                auto v1_end = label_indices.begin() + indptr.at(i + 1);
+                std::copy(indices.cbegin() + indptr.at(i), indices.cbegin() + indptr.at(i + 1), v1_start);
+                // ids are sorted already, so a stable sort keeps every label range sorted by id
+                std::stable_sort(v1_start, v1_end, [this](uint64_t a, uint64_t b) { return labels[a] < labels[b]; });
+                uint64_t *v1_offsets = &label_offsets.at(i * l_num);
+                uint64_t pos = 0;
+                for (uint64_t label = 0; label < l_num; label++) {
+                    while (v1_start + pos != v1_end && labels[v1_start[pos]] < label) pos++;
+                    v1_offsets[label] = pos;
+                }
+            }
+        });
+        LOG(INFO) << "Finished building label index (" << l_num << " labels) in: " << t.Passed() << " seconds";
+    }
+
+
+    inline GraphStats::Distribution summarize(std::vector<uint64_t> &samples) {
+        GraphStats::Distribution out;
+        if (samples.empty()) return out;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (uint64_t sample: samples) sum += sample;
+        out.mean = sum / samples.size();
+        out.p50 = samples.at(samples.size() * 50 / 100);
+        out.p90 = samples.at(samples.size() * 90 / 100);
+        out.p99 = samples.at(samples.size() * 99 / 100);
+        return out;
+    }
+
+    void GraphConverter::collect_stats() {
+        Timer t;
+        stats = GraphStats{};
+        for (uint64_t v = 0; v < v_num; v++) {
+            const uint64_t d = degrees.at(v);
+            if (d == 0) continue;
+            const size_t b = 63 - __builtin_clzll(d);
+            if (stats.buckets.size() <= b) stats.buckets.resize(b + 1);
+            GraphStats::Bucket &bucket = stats.buckets.at(b);
+            bucket.num_vertex++;
+            bucket.sum_degree += d;
+            bucket.sum_degree2 += d * d;
+            bucket.sum_triangle += triangles.at(v);
+        }
+
+        // edges and 2-paths are sampled the way plans reach them: from a random vertex along random edges
+        constexpr size_t kNumSamples = 1 << 16;
+        constexpr uint64_t kNoSample = Constant::EmptyID<uint64_t>();
+        std::vector<uint64_t> edge_common(kNumSamples), wedge_common(kNumSamples), two_hop(kNumSamples);
+        auto common = [this](uint64_t u, uint64_t v) {
+            Counter counter{};
+            std::set_intersection(indices.cbegin() + indptr.at(u), indices.cbegin() + indptr.at(u + 1),
+                                  indices.cbegin() + indptr.at(v), indices.cbegin() + indptr.at(v + 1),
+                                  std::back_inserter(counter));
+            return (uint64_t) counter.count;
+        };
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, e_num > 0 ? kNumSamples : 0), [&](tbb::blocked_range<size_t> r) {
+            for (size_t i = r.begin(); i < r.end(); i++) {
+                // splitmix64, seeded by the sample index so the sketch does not depend on the scheduling
+                uint64_t state = i;
+                auto rng = [&state]() {
+                    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+                    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                    return z ^ (z >> 31);
+                };
+                // a random edge (v, u) and a second neighbor w of v
+                const uint64_t e = rng() % e_num;
+                const uint64_t v = std::upper_bound(indptr.cbegin(), indptr.cend(), e) - indptr.cbegin() - 1;
+                const uint64_t u = indices.at(e);
+                edge_common.at(i) = common(u, v);
+                wedge_common.at(i) = kNoSample;
+                if (degrees.at(v) > 1) {
+                    uint64_t w = u;
+                    while (w == u) w = indices.at(indptr.at(v) + rng() % degrees.at(v));
+                    wedge_common.at(i) = common(u, w);
+                }
+                const uint64_t x = rng() % v_num;
+                uint64_t sum = 0;
+                for (uint64_t j = indptr.at(x); j < indptr.at(x + 1); j++) sum += degrees.at(indices.at(j));
+                two_hop.at(i) = sum;
+            }
+        });
+        if (e_num == 0) {
+            edge_common.clear();
+            two_hop.clear();
+        }
+        wedge_common.erase(std::remove(wedge_common.begin(), wedge_common.end(), kNoSample), wedge_common.end());
+        stats.edge_common = summarize(edge_common);
+        stats.wedge_common = summarize(wedge_common);
+        stats.two_hop = summarize(two_hop);
+        stats.collected = true;
+        LOG(INFO) << "Finished collecting statistics in: " << t.Passed() << " seconds";
+    }
 
     void GraphConverter::save_meta() {
         MetaData meta(v_num, e_num, tri_num, max_deg, max_offset, max_tri);
+        meta.num_label = l_num;
         meta.save(in_dir);
+        stats.save(in_dir);
     }
 
     std::vector<uint32_t> to_32(const std::vector<uint64_t>& data) {
@@ -210,6 +333,8 @@ namespace minigraph {
         if (max_deg < std::numeric_limits<uint32_t>::max()) save_u32(degreePath, to_32(degrees));
         if (max_offset < std::numeric_limits<uint32_t>::max()) save_u32(offsetPath, to_32(offsets));
         if (max_tri < std::numeric_limits<uint32_t>::max()) save_u32(trianglePath, to_32(triangles));
+        if (l_num > 0 && v_num < std::numeric_limits<uint32_t>::max())
+            save_u32(in_dir / Constant::kLabelIndicesU32File, to_32(label_indices));
     }
 
     void GraphConverter::save_bin() {
@@ -224,6 +349,13 @@ namespace minigraph {
         save_u64(trianglePath, triangles);
         save_u64(degreePath, degrees);
         save_u64(offsetPath, offsets);
+        if (l_num > 0) {
+            // label offsets are relative to the vertex's first neighbor, so they always fit in 32 bits
+            CHECK(max_deg < std::numeric_limits<uint32_t>::max()) << "Degree too large for label offsets";
+            save_u32(in_dir / Constant::kLabelU32File, to_32(labels));
+            save_u32(in_dir / Constant::kLabelOffsetU32File, to_32(label_offsets));
+            save_u64(in_dir / Constant::kLabelIndicesU64File, label_indices);
+        }
 
 //        std::ofstream outfile;
 //        outfile.open(indicesPath, std::ios::binary | std::ios::out);
@@ -253,6 +385,7 @@ namespace minigraph {
     void GraphConverter::convert(std::filesystem::path input_dir) {
         in_dir = input_dir;
         data_file = in_dir / "snap.txt";
+        label_file = in_dir / Constant::kLabelFile;
         CHECK(std::filesystem::is_regular_file(data_file)) << "Cannot find file: " << data_file;
 
         indices.clear();
@@ -260,8 +393,13 @@ namespace minigraph {
         triangles.clear();
         offsets.clear();
         degrees.clear();
+        labels.clear();
+        label_indices.clear();
+        label_offsets.clear();
+        l_num = 0;
 
         load_txt();
+        collect_stats();
         save_meta();
         save_bin();
     }
@@ -5,6 +5,7 @@
 #ifndef MINIGRAPH_GRAPH_CONVERTER_H
 #define MINIGRAPH_GRAPH_CONVERTER_H
 #include "typedef.h"
+#include "meta.h"
 #include <stdint.h>
 #include <filesystem>
 #include <vector>
@@ -12,10 +13,20 @@ namespace minigraph {
     class GraphConverter {
     private:
         std::vector<uint64_t> indices, indptr, triangles, offsets, degrees;
-        uint64_t v_num{0}, e_num{0}, tri_num{0}, max_deg{0}, max_offset{0}, max_tri{0};
+        // vertex labels: label of each vertex, neighbors sorted by (label, id) and the begin of every label's range
+        std::vector<uint64_t> labels, label_indices, label_offsets;
+        uint64_t v_num{0}, e_num{0}, tri_num{0}, max_deg{0}, max_offset{0}, max_tri{0}, l_num{0};
         std::filesystem::path in_dir;
         std::filesystem::path data_file;
+        std::filesystem::path label_file;
         void load_txt();
+        // read "vid label" lines of labels.txt (vertex ids as in snap.txt)
+        void load_labels(const std::vector<uint64_t> &idMap);
+        // partition each adjacency list by the labels of the neighbors
+        void build_label_index();
+        GraphStats stats;
+        // degree buckets and sampled neighborhood overlaps for estimating set sizes
+        void collect_stats();
         void save_meta();
         // save indices to unsigned 32-bit integer format
         void save_bin_u32();
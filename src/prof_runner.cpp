@@ -51,11 +51,17 @@ namespace minigraph {
         out->max_offset = m_meta.max_offset;
         out->max_degree = m_meta.max_degree;
         out->max_triangle = m_meta.max_triangle;
+        out->num_label = m_meta.num_label;
 
         std::filesystem::path indicesFile = _in_dir;
-        if (sizeof(IdType) == sizeof(uint64_t)) indicesFile /= Constant::kIndicesU64File;
-        else if (sizeof(IdType) == sizeof(uint32_t)) indicesFile /= Constant::kIndicesU32File;
-        else exit(-1 && "unsupported IdType");
+        std::filesystem::path labelIndicesFile = _in_dir;
+        if (sizeof(IdType) == sizeof(uint64_t)) {
+            indicesFile /= Constant::kIndicesU64File;
+            labelIndicesFile /= Constant::kLabelIndicesU64File;
+        } else if (sizeof(IdType) == sizeof(uint32_t)) {
+            indicesFile /= Constant::kIndicesU32File;
+            labelIndicesFile /= Constant::kLabelIndicesU32File;
+        } else exit(-1 && "unsupported IdType");
 
         read_file<uint64_t>(std::filesystem::path{_in_dir} / Constant::kIndptrU64File, out->m_indptr,
                             m_meta.num_vertex + 1);
@@ -68,6 +74,17 @@ namespace minigraph {
         } else {
             read_file<IdType>(indicesFile, out->m_indices, m_meta.num_edge);
         }
+        if (m_meta.num_label > 0) {
+            read_file<uint32_t>(std::filesystem::path{_in_dir} / Constant::kLabelU32File, out->m_labels,
+                                m_meta.num_vertex);
+            read_file<uint32_t>(std::filesystem::path{_in_dir} / Constant::kLabelOffsetU32File, out->m_label_offset,
+                                m_meta.num_vertex * m_meta.num_label);
+            if (_mmap) {
+                mmap_file<IdType>(labelIndicesFile, out->m_label_indices, m_meta.num_edge);
+            } else {
+                read_file<IdType>(labelIndicesFile, out->m_label_indices, m_meta.num_edge);
+            }
+        }
         return out;
     }
 
@@ -195,6 +212,8 @@ int main(int argc, char *argv[]){
         LOG(MSG) << "TimeSTD\t" << sqrt(ctx.get_var_time());
         LOG(MSG) << "VertexSetAllocated\t" << ToReadableSize(VertexSetType::TOTAL_ALLOCATED);
         LOG(MSG) << "MiniGraphAllocated\t" << ToReadableSize(MiniGraphPool::TOTAL_ALLOCATED);
+        LOG(MSG) << "MGReuseEstimated\t" << MiniGraphIF::REUSE_ESTIMATED;
+        LOG(MSG) << "MGReuseObserved\t" << MiniGraphIF::REUSE_OBSERVED;
 
         uint64_t *VID_TO_DEG = new uint64_t [graph->get_vnum()];
         uint64_t *VID_TO_OFFSET = graph->m_offset;
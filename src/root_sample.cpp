@@ -0,0 +1,77 @@
+//
+// Created by ubuntu on 10/19/26.
+//
+
+#include "root_sample.h"
+#include "constant.h"
+#include "logging.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <algorithm>
+#include <numeric>
+namespace minigraph
+{
+    std::vector<RootStratum> sample_roots(const std::string &graph_dir, uint64_t num_vertex, size_t sample_size) {
+        std::filesystem::path path = std::filesystem::path{graph_dir} / Constant::kIndptrU64File;
+        std::vector<uint64_t> indptr(num_vertex + 1);
+        std::ifstream file(path, std::ios::binary | std::ios::in);
+        file.read(reinterpret_cast<char *>(indptr.data()), indptr.size() * sizeof(uint64_t));
+        CHECK(file.gcount() == (long int) (indptr.size() * sizeof(uint64_t))) << "Failed to read " << path;
+
+        std::vector<std::vector<uint64_t>> buckets;
+        std::vector<double> bucket_degree;
+        for (uint64_t v = 0; v < num_vertex; v++) {
+            uint64_t degree = indptr[v + 1] - indptr[v];
+            if (degree == 0) continue;
+            size_t b = 63 - __builtin_clzll(degree);
+            if (buckets.size() <= b) {
+                buckets.resize(b + 1);
+                bucket_degree.resize(b + 1, 0);
+            }
+            buckets[b].push_back(v);
+            bucket_degree[b] += degree;
+        }
+        double total_degree = std::accumulate(bucket_degree.begin(), bucket_degree.end(), 0.0);
+        std::mt19937_64 rng(0);
+        std::vector<RootStratum> out;
+        for (size_t b = buckets.size(); b-- > 0;) {
+            std::vector<uint64_t> &bucket = buckets[b];
+            if (bucket.empty()) continue;
+            size_t num = std::clamp<size_t>(std::llround(sample_size * bucket_degree[b] / total_degree), 1,
+                                            bucket.size());
+            std::shuffle(bucket.begin(), bucket.end(), rng);
+            RootStratum stratum;
+            stratum.weight = (double) bucket.size() / num;
+            stratum.roots.assign(bucket.begin(), bucket.begin() + num);
+            std::sort(stratum.roots.begin(), stratum.roots.end());
+            out.push_back(std::move(stratum));
+        }
+        return out;
+    }
+
+    void save_root_sample(const std::string &path, const std::vector<RootStratum> &strata) {
+        std::ofstream file(path);
+        CHECK(file.is_open()) << "Failed to write root sample: " << path;
+        for (const RootStratum &stratum: strata) {
+            file << stratum.weight;
+            for (uint64_t v: stratum.roots) file << " " << v;
+            file << "\n";
+        }
+    }
+
+    std::vector<RootStratum> read_root_sample(const std::string &path) {
+        std::ifstream file(path);
+        CHECK(file.is_open()) << "Failed to open root sample: " << path;
+        std::vector<RootStratum> out;
+        for (std::string line; std::getline(file, line);) {
+            std::istringstream iss(line);
+            RootStratum stratum;
+            if (!(iss >> stratum.weight)) continue;
+            for (uint64_t v; iss >> v;) stratum.roots.push_back(v);
+            if (!stratum.roots.empty()) out.push_back(std::move(stratum));
+        }
+        return out;
+    }
+}
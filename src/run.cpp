@@ -5,11 +5,15 @@
 #include "logging.h"
 #include "configure.h"
 #include "common.h"
+#include "frontend.h"
+#include "root_sample.h"
+#include "decompose.h"
 #include <vector>
 #include <iostream>
 #include <fmt/format.h>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
 #include <cstdio>
 #include <stdexcept>
 #include <string>
@@ -18,19 +22,6 @@
 #include <thread>
 using namespace minigraph;
 
-std::string exec(const char *cmd) {
-    std::array<char, 128> buffer;
-    std::string result;
-    std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
-    if (!pipe) {
-        throw std::runtime_error("popen() failed!");
-    }
-    while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-        result += buffer.data();
-    }
-    return result;
-}
-
 
 struct AppConfig {
     int exp_id;
@@ -38,7 +29,13 @@ struct AppConfig {
     std::string data_name;
     std::string pattern_name;
     std::string pat;
+    std::vector<int> labels; // vertex labels of pat; empty if unlabeled
+    std::vector<std::string> pats; // adjacency matrices of a multi-pattern query (pat lists them comma-separated)
     std::string graph_dir;
+    std::string embedding_out; // empty: count only
+    uint64_t embedding_limit{0};
+    std::string local_out; // file of the per-vertex counts (RunnerType::LocalCount/OrbitCount)
+    size_t pgo_sample{0}; // roots of the training run of a profile-guided build (MINIGRAPH_PGO); 0: regular build
 };
 
 std::filesystem::path output_dir(AppConfig config) {
@@ -77,12 +74,63 @@ std::filesystem::path output_log(AppConfig config) {
     return out;
 }
 
-std::filesystem::path code_path() {
-    std::filesystem::path code_file(PROJECT_SOURCE_DIR);
-    code_file /= "src";
-    code_file /= "codegen_output";
-    code_file /= "plan.cpp";
-    return code_file;
+// profiles are kept per graph and generated plan, next to the plans
+std::filesystem::path pgo_dir(AppConfig config, const std::string &code) {
+    std::filesystem::path out(PROJECT_PLAN_DIR);
+    out /= "pgo";
+    // the name alone may be reused by another graph
+    auto graph_dir = std::filesystem::weakly_canonical(config.graph_dir).string();
+    out /= fmt::format("{}_{:016x}_{:016x}", config.data_name, std::hash<std::string>{}(graph_dir),
+                       std::hash<std::string>{}(code));
+    return out;
+}
+
+// PLAN_PGO of src/codegen_output/CMakeLists.txt
+void configure_pgo(const std::string &mode, const std::filesystem::path &dir) {
+    auto configure_cmd = fmt::format("cmake {binary_dir} -DPLAN_PGO={mode} -DPLAN_PGO_DIR={dir} 1>>/dev/null 2>>/dev/null",
+                                     fmt::arg("binary_dir", PROJECT_BINARY_DIR),
+                                     fmt::arg("mode", mode),
+                                     fmt::arg("dir", dir.string()));
+    if (system(configure_cmd.c_str()) != 0) exit(-1 && "cmake configure error");
+}
+
+bool has_profile(const std::filesystem::path &dir) {
+    if (!std::filesystem::is_directory(dir)) return false;
+    for (const auto &entry: std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".gcda" || entry.path().filename() == "plan.profdata") return true;
+    }
+    return false;
+}
+
+/* brief Profile of the plan on a sample of the roots, for the profile-guided build
+ * The plan is built instrumented and run on roots sampled by degree; gcc writes the profile to dir when the runner
+ * exits, clang writes raw profiles that are merged into dir/plan.profdata.
+ * */
+void train_pgo(AppConfig config, const std::filesystem::path &dir, const std::string &compile_cmd) {
+    Timer t;
+    std::filesystem::create_directories(dir);
+    MetaData meta;
+    meta.read(config.graph_dir);
+    std::filesystem::path sample_path = dir / "roots.txt";
+    save_root_sample(sample_path, sample_roots(config.graph_dir, meta.num_vertex, config.pgo_sample));
+    configure_pgo("GENERATE", dir);
+    if (system(compile_cmd.c_str()) != 0) exit(-1 && "compilation error");
+    auto run_cmd = fmt::format("MINIGRAPH_ROOT_SAMPLE={sample} {bin_path} {exp_id} {data_dir}",
+                               fmt::arg("sample", sample_path.string()),
+                               fmt::arg("bin_path", runner_path().string()),
+                               fmt::arg("exp_id", config.exp_id),
+                               fmt::arg("data_dir", config.graph_dir));
+    std::string run_results = exec(run_cmd.c_str());
+    CHECK(run_results.find("ESTIMATED_EXECUTION_TIME") != std::string::npos)
+        << "Training run of the instrumented plan failed:\n" << run_results;
+    bool raw = false;
+    for (const auto &entry: std::filesystem::directory_iterator(dir)) raw |= entry.path().extension() == ".profraw";
+    if (raw) {
+        auto merge_cmd = fmt::format("llvm-profdata merge -o {dir}/plan.profdata {dir}/*.profraw",
+                                     fmt::arg("dir", dir.string()));
+        if (system(merge_cmd.c_str()) != 0) exit(-1 && "llvm-profdata merge error");
+    }
+    LOG(MSG) << "PGO_TRAINING_TIME(s)=" << t.Passed();
 }
 
 void compile(AppConfig config) {
@@ -90,7 +138,8 @@ void compile(AppConfig config) {
     MetaData meta;
     meta.read(config.graph_dir);
     Timer t;
-    std::string code = gen_code(config.pat, config.codegen, meta);
+    std::string code = config.pats.size() > 1 ? gen_code(config.pats, config.codegen, meta)
+                                              : gen_code(config.pat, config.labels, config.codegen, meta);
     auto codegen_t = t.Passed();
     t.Reset();
     std::ofstream out_file(code_path());
@@ -111,8 +160,17 @@ void compile(AppConfig config) {
     LOG(MSG) << "CODE_GENERATION_TIME(s)=" << codewrite_t + codegen_t;
 
     // compile and run
-    auto compile_cmd = fmt::format("cmake --build {compile_path} --target runner 1>>/dev/null 2>>/dev/null",
-                                   fmt::arg("compile_path", PROJECT_BINARY_DIR));
+    auto compile_cmd = compile_runner_cmd();
+    std::filesystem::path profile_dir;
+    if (config.pgo_sample > 0) {
+        profile_dir = pgo_dir(config, code);
+        if (has_profile(profile_dir)) {
+            LOG(MSG) << "Reusing the profile at: " << profile_dir;
+        } else {
+            train_pgo(config, profile_dir, compile_cmd);
+        }
+        configure_pgo("USE", profile_dir);
+    }
     // LOG(MSG) << "CMD: " << compile_cmd;
     t.Reset();
     int flag = system(compile_cmd.c_str());
@@ -125,13 +183,15 @@ void compile(AppConfig config) {
     if (flag != 0) exit(-1 && "compilation error");
     auto compile_t = t.Passed();
     LOG(MSG) << "COMPILATION_TIME(s)=" << compile_t;
+    // later builds of the plan are regular ones again
+    if (config.pgo_sample > 0) configure_pgo("OFF", profile_dir);
     auto mkdir_cmd = fmt::format("mkdir -p {bin_dir}",
                                  fmt::arg("bin_dir", "/Users/williampark/graphmini-o/build/plan"));
     LOG(MSG) << "CMD: " << mkdir_cmd;
     flag = system(mkdir_cmd.c_str());
     if (flag != 0) exit(-1 && "mkdir error");
 
-    std::filesystem::path bin_path = std::filesystem::path(CMAKE_RUNTIME_OUTPUT_DIRECTORY) / "runner";
+    std::filesystem::path bin_path = runner_path();
     std::filesystem::path dst_path = std::filesystem::path(PROJECT_PLAN_DIR) / "0";
     auto mv_cmd = fmt::format("mv {bin_path} {dst_path}",
                               fmt::arg("bin_path", bin_path.string()),
@@ -148,35 +208,161 @@ void compile(AppConfig config) {
     log.parallelType = config.codegen.parType;
     log.adjMatType = config.codegen.adjMatType;
     log.patternAdj = config.pat;
+    if (config.pats.size() > 1) {
+        // the log is comma-separated
+        log.patternSize = 0;
+        log.patternAdj.clear();
+        for (const auto &pat: config.pats) {
+            log.patternSize = std::max<int>(log.patternSize, sqrt(pat.size()));
+            log.patternAdj += (log.patternAdj.empty() ? "" : ";") + pat;
+        }
+    }
     log.patternName = config.pattern_name;
     log.dataName = config.data_name;
     log.save(PROJECT_LOG_DIR);
 };
 
-void run(AppConfig config) {
-    std::filesystem::path bin_path = std::filesystem::path(PROJECT_PLAN_DIR) / "0";
+std::string run(AppConfig config) {
     auto run_cmd = fmt::format("{bin_path} {exp_id} {data_dir}",
-                               fmt::arg("bin_path", bin_path.string()),
+                               fmt::arg("bin_path", runner_path().string()),
                                fmt::arg("data_dir", config.graph_dir),
                                fmt::arg("exp_id", config.exp_id));
-    std::string run_results = exec(run_cmd.c_str());
-    LOG(MSG) << run_results;
+    if (config.codegen.runnerType == RunnerType::Enumeration) {
+        run_cmd += fmt::format(" '{}' {}", config.embedding_out, config.embedding_limit);
+    } else if (config.codegen.runnerType == RunnerType::LocalCount
+               || config.codegen.runnerType == RunnerType::OrbitCount) {
+        run_cmd += fmt::format(" '{}'", config.local_out);
+    }
+    return exec(run_cmd.c_str());
 }
 
 void compile_and_run(AppConfig config) {
     compile(config);
     using namespace std::chrono_literals;
     std::this_thread::sleep_for(500ms);
-    run(config);
+    LOG(MSG) << run(config);
+}
+
+// <key>=<count> line printed by the runner
+long long parse_count(const std::string &run_results, const std::string &key) {
+    std::stringstream ss(run_results);
+    for (std::string line; std::getline(ss, line);) {
+        size_t pos = line.find(key + "=");
+        if (pos != std::string::npos) return std::stoll(line.substr(pos + key.size() + 1));
+    }
+    LOG(FATAL) << "Missing " << key << " in the runner output:\n" << run_results;
+    return -1;
+}
+
+// e(v) of PatternDecomposition: the embeddings of side s mapping the cut vertex to v
+std::vector<uint64_t> side_counts(AppConfig config, const PatternDecomposition &dec, int s, uint64_t num_vertex) {
+    std::vector<uint64_t> out(num_vertex, 0);
+    if (dec.side_mats[s].size() == 4) {
+        // the edge (c, leaf)
+        std::vector<uint64_t> indptr(num_vertex + 1);
+        std::ifstream file(std::filesystem::path{config.graph_dir} / Constant::kIndptrU64File, std::ios::binary);
+        file.read(reinterpret_cast<char *>(indptr.data()), indptr.size() * sizeof(uint64_t));
+        CHECK(file.gcount() == (long int) (indptr.size() * sizeof(uint64_t))) << "Failed to read the degrees";
+        for (uint64_t v = 0; v < num_vertex; v++) out.at(v) = indptr.at(v + 1) - indptr.at(v);
+        return out;
+    }
+    config.pat = dec.side_mats[s];
+    config.labels = dec.side_labels[s];
+    config.pats.clear();
+    config.codegen.adjMatType = AdjMatType::EdgeInduced;
+    config.codegen.runnerType = RunnerType::OrbitCount;
+    config.codegen.orderRank = 0;
+    config.local_out = (std::filesystem::path(PROJECT_PLAN_DIR) / fmt::format("side_{}.bin", s)).string();
+    std::filesystem::create_directories(std::filesystem::path(config.local_out).parent_path());
+    compile(config);
+    std::string run_results = run(config);
+    LOG(INFO) << run_results;
+    CHECK(run_results.find("LOCAL_COUNTS") != std::string::npos) << "Side " << s << " failed:\n" << run_results;
+    // the cut vertex is vertex 0 of the side, so its orbit is column 0
+    uint64_t width = std::filesystem::file_size(config.local_out) / sizeof(uint64_t) / num_vertex;
+    std::vector<uint64_t> counts(num_vertex * width);
+    std::ifstream file(config.local_out, std::ios::binary);
+    file.read(reinterpret_cast<char *>(counts.data()), counts.size() * sizeof(uint64_t));
+    CHECK(file.gcount() == (long int) (counts.size() * sizeof(uint64_t))) << "Failed to read " << config.local_out;
+    for (uint64_t v = 0; v < num_vertex; v++) out.at(v) = counts.at(v * width) * dec.side_stabilizer[s];
+    return out;
+}
+
+// embeddings of every quotient pattern; unlabeled quotients are counted together by one multi-pattern plan
+std::vector<long long> quotient_embeddings(AppConfig config, const PatternDecomposition &dec) {
+    config.codegen.adjMatType = AdjMatType::EdgeInduced;
+    config.codegen.runnerType = RunnerType::Benchmark;
+    config.codegen.orderRank = 0;
+    std::vector<long long> out;
+    if (dec.quotients.empty()) return out;
+    if (config.labels.empty() && dec.quotients.size() > 1) {
+        config.pats.clear();
+        config.pat.clear();
+        for (const QuotientPattern &q: dec.quotients) {
+            config.pats.push_back(q.adj_mat);
+            config.pat += (config.pat.empty() ? "" : ",") + q.adj_mat;
+        }
+        config.codegen.pruningType = PruningType::None;
+        config.codegen.parType = ParallelType::OpenMP;
+        compile(config);
+        std::string run_results = run(config);
+        LOG(INFO) << run_results;
+        for (size_t k = 0; k < dec.quotients.size(); k++) {
+            out.push_back(parse_count(run_results, fmt::format("RESULT_{}", k)) * dec.quotients.at(k).num_automorphisms);
+        }
+        return out;
+    }
+    for (const QuotientPattern &q: dec.quotients) {
+        config.pat = q.adj_mat;
+        config.labels = q.labels;
+        config.pats = {q.adj_mat};
+        compile(config);
+        std::string run_results = run(config);
+        LOG(INFO) << run_results;
+        out.push_back(parse_count(run_results, "RESULT") * q.num_automorphisms);
+    }
+    return out;
+}
+
+/* brief Count the pattern through a cut vertex instead of enumerating it (see PatternDecomposition)
+ * Both sides are compiled as orbit-counting plans, whose per-vertex counts are joined on the cut vertex; the
+ * quotient patterns correcting for colliding sides are then counted and subtracted.
+ * */
+void run_decomposed(AppConfig config, const PatternDecomposition &dec) {
+    Timer t;
+    MetaData meta;
+    meta.read(config.graph_dir);
+    LOG(MSG) << "CUT_VERTEX=" << dec.cut << " SIDES=" << dec.side_mats[0] << "," << dec.side_mats[1]
+             << " QUOTIENTS=" << dec.quotients.size();
+    std::vector<uint64_t> e0 = side_counts(config, dec, 0, meta.num_vertex);
+    std::vector<uint64_t> e1 = side_counts(config, dec, 1, meta.num_vertex);
+    __int128 embeddings = 0;
+    for (uint64_t v = 0; v < meta.num_vertex; v++) embeddings += (__int128) e0.at(v) * e1.at(v);
+    std::vector<long long> quotients = quotient_embeddings(config, dec);
+    for (size_t k = 0; k < quotients.size(); k++) {
+        embeddings -= (__int128) quotients.at(k) * dec.quotients.at(k).multiplicity;
+    }
+    CHECK(embeddings >= 0 && embeddings % dec.num_automorphisms == 0)
+        << "Logic error: the decomposition does not add up to whole subgraphs";
+    LOG(MSG) << "DECOMPOSITION_TIME(s)=" << t.Passed();
+    LOG(MSG) << "RESULT=" << (long long) (embeddings / dec.num_automorphisms);
 }
 
 int main(int argc, char *argv[]) {
     using namespace minigraph;
     if (argc < 8) {
-        std::cout << "./run [graph_name] [graph_dir] [query_name] [query] [adj_type] [prun_type] [par_type] [exp_id=-1 (optional)]\n";
+        std::cout << "./run [graph_name] [graph_dir] [query_name] [query] [adj_type] [prun_type] [par_type] [exp_id=-1 (optional)] [output (optional)] [embedding_limit=0 (optional)]\n";
+        std::cout << "query: adjacency matrix of the pattern, or a pattern file (e.g. queries/dblp/small_sparse/query_sparse_8_1.graph); vertex labels in the file are matched against the labels of the graph\n"
+                     "       comma-separated adjacency matrices are counted together by one plan (RESULT_<k> is the count of the k-th one)\n";
         std::cout << "adj_type: 0=VertexInduced; 1=EdgeInduced; 2=EdgeInducedIEP\n";
-        std::cout << "prun_type: 0=None; 1=Static; 2=Eager; 3=Online; 4=CostModel\n";
-        std::cout << "par_type: 0=OpenMP; 1=TbbTop; 2=Nested; 3=NestedRt\n";
+        std::cout << "prun_type: 0=None; 1=Static; 2=Eager; 3=Online; 4=CostModel; auto=as recorded by autotune\n";
+        std::cout << "par_type: 0=OpenMP; 1=TbbTop; 2=Nested; 3=NestedRt; auto=as recorded by autotune\n";
+        std::cout << "output: a binary file (or |cmd to pipe into cmd) to enumerate the embeddings into instead of only counting them;\n"
+                     "        local:<file> to write the number of matched subgraphs containing each vertex;\n"
+                     "        orbit:<file> to write these counts per orbit of the pattern vertices\n";
+        std::cout << "embedding_limit: stop after this many embeddings; 0=unlimited\n";
+        std::cout << "MINIGRAPH_DECOMPOSE=1: count an edge-induced pattern with a cut vertex from the per-vertex counts of its two sides\n";
+        std::cout << "MINIGRAPH_CLIQUE=0: match cliques with the generated plans instead of the clique engine\n";
         std::cout << "For example:\n./MiniGraph/build/bin/run wiki ./Datasets/MiniGraph/wiki/ P1 0111101111011110 0 4 3\n";
         return 0;
     }
@@ -186,10 +372,63 @@ int main(int argc, char *argv[]) {
     std::string query_name={argv[3]};
     std::string query_str={argv[4]};
     int adjmat_type_int = std::atoi(argv[5]);
-    int prun_type_int = std::atoi(argv[6]);
-    int par_type_int = std::atoi(argv[7]);
+    bool auto_prun = std::string{argv[6]} == "auto";
+    bool auto_par = std::string{argv[7]} == "auto";
+    int prun_type_int = auto_prun ? 0 : std::atoi(argv[6]);
+    int par_type_int = auto_par ? 0 : std::atoi(argv[7]);
     int exp_id = -1;
-    if (argc == 9) exp_id = std::atoi(argv[8]);
+    if (argc >= 9) exp_id = std::atoi(argv[8]);
+    std::string embedding_out;
+    uint64_t embedding_limit = 0;
+    std::string local_out;
+    RunnerType runner_type = RunnerType::Benchmark;
+    if (argc >= 10) {
+        std::string output{argv[9]};
+        if (output.rfind("local:", 0) == 0) {
+            local_out = output.substr(6);
+            runner_type = RunnerType::LocalCount;
+        } else if (output.rfind("orbit:", 0) == 0) {
+            local_out = output.substr(6);
+            runner_type = RunnerType::OrbitCount;
+        } else if (!output.empty()) {
+            embedding_out = output;
+            runner_type = RunnerType::Enumeration;
+        }
+    }
+    if (argc >= 11) embedding_limit = std::stoull(argv[10]);
+
+    AppConfig config;
+    config.exp_id = exp_id;
+    config.pattern_name = query_name;
+    if (std::filesystem::is_regular_file(query_str)) {
+        config.pat = read_pattern(query_str, config.labels);
+    } else {
+        config.pat = query_str;
+        std::stringstream ss(query_str);
+        for (std::string pat; std::getline(ss, pat, ',');) config.pats.push_back(pat);
+    }
+
+    int order_rank = 0;
+    if (auto_prun || auto_par) {
+        // decisions are made for the number of threads the runner is going to use
+        int num_threads = getenv("OMP_NUM_THREADS") != NULL ? std::atoi(getenv("OMP_NUM_THREADS")) : 1;
+        TuningRecords records;
+        records.read(graph_dir);
+        auto itr = records.decisions.find({TuningRecords::pattern_key(config.pat, config.labels), adjmat_type_int,
+                                           num_threads});
+        if (itr != records.decisions.end()) {
+            if (auto_prun) prun_type_int = itr->second.pruning_type;
+            if (auto_par) par_type_int = itr->second.parallel_type;
+            order_rank = itr->second.order_rank;
+            LOG(MSG) << "Tuned prun_type=" << prun_type_int << " par_type=" << par_type_int
+                     << " order_rank=" << order_rank;
+        } else {
+            if (auto_prun) prun_type_int = static_cast<int>(PruningType::CostModel);
+            if (auto_par) par_type_int = static_cast<int>(ParallelType::NestedRt);
+            LOG(WARNING) << "No autotune decision for " << query_name << " with " << num_threads
+                         << " threads; using prun_type=" << prun_type_int << " par_type=" << par_type_int;
+        }
+    }
 
     AdjMatType adjmat_type = (AdjMatType) (adjmat_type_int);
     PruningType prun_type = static_cast<PruningType>(prun_type_int);
@@ -199,13 +438,36 @@ int main(int argc, char *argv[]) {
     conf.adjMatType  = adjmat_type;
     conf.pruningType = prun_type;
     conf.parType     = par_type;
+    conf.runnerType  = runner_type;
+    conf.orderRank   = order_rank;
+    // MINIGRAPH_CLIQUE=0 matches cliques with the generic plans
+    const char* clique_env = getenv("MINIGRAPH_CLIQUE");
+    conf.cliqueEngine = clique_env == NULL || std::string{clique_env} != "0";
 
-    AppConfig config;
-    config.exp_id = exp_id;
-    config.pattern_name = query_name;
-    config.pat = query_str;
     config.codegen = conf;
     config.data_name = graph_name;
     config.graph_dir = graph_dir;
+    config.embedding_out = embedding_out;
+    config.embedding_limit = embedding_limit;
+    config.local_out = local_out;
+    const char* pgo_env = getenv("MINIGRAPH_PGO");
+    if (pgo_env != NULL) {
+        config.pgo_sample = std::stoul(pgo_env);
+        CHECK(config.pgo_sample == 0 || runner_type == RunnerType::Benchmark)
+            << "Profile-guided builds only train counting plans";
+    }
+    const char* decompose_env = getenv("MINIGRAPH_DECOMPOSE");
+    if (decompose_env != NULL && std::string{decompose_env} != "0") {
+        PatternDecomposition dec;
+        if (config.pats.size() > 1 || runner_type != RunnerType::Benchmark || adjmat_type == AdjMatType::VertexInduced
+            || config.pgo_sample > 0) {
+            LOG(WARNING) << "Only single edge-induced counting queries are decomposed, enumerating " << query_name;
+        } else if (!decompose_pattern(config.pat, config.labels, dec)) {
+            LOG(WARNING) << query_name << " has no cut vertex to decompose at, enumerating it";
+        } else {
+            run_decomposed(config, dec);
+            return 0;
+        }
+    }
     compile_and_run(config);
 }
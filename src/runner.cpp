@@ -17,8 +17,10 @@
 #include "codegen_output/plan.h"
 #include "configure.h"
 #include "common.h"
+#include "root_sample.h"
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include <unistd.h>
 #include <fcntl.h>
 #include <iostream>
@@ -27,6 +29,9 @@
 #include <mutex>
 #include <math.h>
 #include <condition_variable>
+#include <memory>
+#include <csignal>
+#include <cctype>
 #include <cstdlib> // Required for getenv()
 #include <omp.h>   // Required for OpenMP functions
 #include "tbb/global_control.h"
@@ -71,11 +76,17 @@ namespace minigraph {
         out->max_offset = m_meta.max_offset;
         out->max_degree = m_meta.max_degree;
         out->max_triangle = m_meta.max_triangle;
+        out->num_label = m_meta.num_label;
 
         std::filesystem::path indicesFile = _in_dir;
-        if (sizeof(IdType) == sizeof(uint64_t)) indicesFile /= Constant::kIndicesU64File;
-        else if (sizeof(IdType) == sizeof(uint32_t)) indicesFile /= Constant::kIndicesU32File;
-        else exit(-1 && "unsupported IdType");
+        std::filesystem::path labelIndicesFile = _in_dir;
+        if (sizeof(IdType) == sizeof(uint64_t)) {
+            indicesFile /= Constant::kIndicesU64File;
+            labelIndicesFile /= Constant::kLabelIndicesU64File;
+        } else if (sizeof(IdType) == sizeof(uint32_t)) {
+            indicesFile /= Constant::kIndicesU32File;
+            labelIndicesFile /= Constant::kLabelIndicesU32File;
+        } else exit(-1 && "unsupported IdType");
 
         read_file<uint64_t>(std::filesystem::path{_in_dir} / Constant::kIndptrU64File, out->m_indptr,
                             m_meta.num_vertex + 1);
@@ -88,9 +99,172 @@ namespace minigraph {
         } else {
             read_file<IdType>(indicesFile, out->m_indices, m_meta.num_edge);
         }
+        if (m_meta.num_label > 0) {
+            read_file<uint32_t>(std::filesystem::path{_in_dir} / Constant::kLabelU32File, out->m_labels,
+                                m_meta.num_vertex);
+            read_file<uint32_t>(std::filesystem::path{_in_dir} / Constant::kLabelOffsetU32File, out->m_label_offset,
+                                m_meta.num_vertex * m_meta.num_label);
+            if (_mmap) {
+                mmap_file<IdType>(labelIndicesFile, out->m_label_indices, m_meta.num_edge);
+            } else {
+                read_file<IdType>(labelIndicesFile, out->m_label_indices, m_meta.num_edge);
+            }
+        }
         return out;
     }
 
+    template<typename T>
+    inline bool write_file(std::filesystem::path path, const T *pointer, uint64_t num_elements) {
+        std::ofstream file(path, std::ios::binary | std::ios::out);
+        file.write(reinterpret_cast<const char *>(pointer), sizeof(T) * num_elements);
+        if (file.good()) return true;
+        LOG(WARNING) << "Failed to write " << ToReadableSize(sizeof(T) * num_elements) << " to " << path;
+        return false;
+    };
+
+    // writes the files load_bin reads; false if out_dir cannot be created or a file cannot be written
+    inline bool save_bin(const GraphType *graph, const std::filesystem::path &out_dir) {
+        std::error_code ec;
+        std::filesystem::create_directories(out_dir, ec);
+        if (ec) {
+            LOG(WARNING) << "Failed to create " << out_dir << ": " << ec.message();
+            return false;
+        }
+        MetaData meta(graph->num_vertex, graph->num_edge, graph->num_triangle, graph->max_degree, graph->max_offset,
+                      graph->max_triangle);
+        meta.num_label = graph->num_label;
+        bool u64 = sizeof(IdType) == sizeof(uint64_t);
+        bool ok = write_file<uint64_t>(out_dir / Constant::kIndptrU64File, graph->m_indptr, graph->num_vertex + 1)
+                  && write_file<uint64_t>(out_dir / Constant::kOffsetU64File, graph->m_offset, graph->num_vertex)
+                  && write_file<uint64_t>(out_dir / Constant::kTriangleU64File, graph->m_triangles, graph->num_vertex)
+                  && write_file<IdType>(out_dir / (u64 ? Constant::kIndicesU64File : Constant::kIndicesU32File),
+                                        graph->m_indices, graph->num_edge);
+        if (ok && graph->num_label > 0) {
+            ok = write_file<uint32_t>(out_dir / Constant::kLabelU32File, graph->m_labels, graph->num_vertex)
+                 && write_file<uint32_t>(out_dir / Constant::kLabelOffsetU32File, graph->m_label_offset,
+                                         graph->num_vertex * graph->num_label)
+                 && write_file<IdType>(out_dir / (u64 ? Constant::kLabelIndicesU64File : Constant::kLabelIndicesU32File),
+                                       graph->m_label_indices, graph->num_edge);
+        }
+        if (!ok) return false;
+        // written last: a directory with a meta file is complete
+        meta.save(out_dir);
+        return std::filesystem::is_regular_file(out_dir / Constant::kMetaFile, ec);
+    }
+
+    /* brief Load the k-core of the graph in in_dir, its vertices renumbered in id order
+     * ids: the original id of every vertex of the core; left empty (and the whole graph returned) if every vertex
+     *      is in the core
+     * The core is cached in in_dir/core_<k> and rebuilt if the graph has been preprocessed again since.
+     * */
+    inline GraphType *load_core(const std::string &in_dir, uint64_t k, std::vector<IdType> &ids) {
+        std::filesystem::path core_dir = std::filesystem::path(in_dir) / (Constant::kCoreDirPrefix + std::to_string(k));
+        // a cache is valid if it is complete and was built after the graph was last preprocessed
+        auto cached = [&core_dir, &in_dir]() {
+            std::error_code ec;
+            std::filesystem::path core_meta = core_dir / Constant::kMetaFile;
+            std::filesystem::path graph_meta = std::filesystem::path(in_dir) / Constant::kMetaFile;
+            if (!std::filesystem::is_regular_file(core_meta, ec)) return false;
+            auto core_time = std::filesystem::last_write_time(core_meta, ec);
+            if (ec) return false;
+            auto graph_time = std::filesystem::last_write_time(graph_meta, ec);
+            return !ec && core_time >= graph_time;
+        };
+        if (cached()) {
+            GraphType *core = load_bin(core_dir, false);
+            uint64_t *core_ids = nullptr;
+            read_file<uint64_t>(core_dir / Constant::kCoreIdsU64File, core_ids, core->get_vnum());
+            ids.assign(core_ids, core_ids + core->get_vnum());
+            delete[] core_ids;
+            LOG(MSG) << "CoreCache=" << core_dir;
+            return core;
+        }
+        GraphType *graph = load_bin(in_dir, false);
+        Timer t;
+        ids = core_vertices(graph, k);
+        if (ids.size() == graph->get_vnum()) {
+            ids.clear();
+            return graph;
+        }
+        GraphType *core = induced_graph(graph, ids);
+        delete graph;
+        LOG(MSG) << "CoreTime(s)=" << t.Passed();
+        // the cache is best-effort: if it cannot be written (e.g. a read-only graph directory), run on the core as is
+        std::filesystem::path tmp_dir = core_dir.string() + ".tmp" + std::to_string(getpid());
+        std::vector<uint64_t> ids_u64(ids.begin(), ids.end());
+        std::error_code ec;
+        if (!save_bin(core, tmp_dir)
+            || !write_file<uint64_t>(tmp_dir / Constant::kCoreIdsU64File, ids_u64.data(), ids_u64.size())) {
+            LOG(WARNING) << "Running without caching the core in " << core_dir;
+            std::filesystem::remove_all(tmp_dir, ec);
+            return core;
+        }
+        // several runners may build the same core: each writes its own directory and the first rename wins, a
+        // valid cache is never replaced as other runners may be reading it
+        if (!cached()) {
+            // only a stale or incomplete cache is left in the way, which no runner reads
+            if (std::filesystem::exists(core_dir, ec)) std::filesystem::remove_all(core_dir, ec);
+            std::filesystem::rename(tmp_dir, core_dir, ec);
+            if (!ec) return core;
+        }
+        std::filesystem::remove_all(tmp_dir, ec);
+        return core;
+    }
+
+    // bytes with an optional K, M, G or T suffix (powers of 1024), e.g. 64G
+    inline uint64_t parse_bytes(const std::string &text) {
+        size_t end = 0;
+        double bytes = std::stod(text, &end);
+        if (end < text.size()) {
+            const std::string units = "KMGT";
+            size_t unit = units.find(std::toupper(text.at(end)));
+            CHECK(unit != std::string::npos) << "Unknown size suffix: " << text;
+            for (size_t i = 0; i <= unit; i++) bytes *= 1024;
+        }
+        return static_cast<uint64_t>(bytes);
+    }
+
+    /* brief Extrapolates the runtime and the count of the plan from strata of sampled roots
+     * Every stratum runs on its own and its time and count are scaled by its weight. Once the estimate so far
+     * exceeds cutoff seconds, the remaining strata are skipped and the estimate is reported as Cutoff.
+     * */
+    inline void run_sample(const GraphType *graph, int num_threads, const std::vector<RootStratum> &strata,
+                           double cutoff, const std::vector<IdType> &core_ids) {
+        double seconds = 0, estimated_seconds = 0, estimated_result = 0;
+        for (size_t s = 0; s < strata.size(); s++) {
+            const RootStratum &stratum = strata.at(s);
+            std::vector<IdType> roots;
+            for (uint64_t root: stratum.roots) {
+                if (core_ids.empty()) {
+                    roots.push_back(root);
+                    continue;
+                }
+                // roots outside the core match nothing
+                auto itr = std::lower_bound(core_ids.begin(), core_ids.end(), (IdType) root);
+                if (itr != core_ids.end() && *itr == root) roots.push_back(itr - core_ids.begin());
+            }
+            Context ctx(num_threads);
+            ctx.roots = &roots;
+            Timer t;
+            plan(graph, ctx);
+            double passed = t.Passed();
+            seconds += passed;
+            estimated_seconds += passed * stratum.weight;
+            estimated_result += ctx.get_result() * stratum.weight;
+            LOG(INFO) << "Stratum=" << s << " Roots=" << stratum.roots.size() << " Weight=" << stratum.weight
+                      << " Time(s)=" << passed << " Result=" << ctx.get_result();
+            if (estimated_seconds > cutoff && s + 1 < strata.size()) {
+                LOG(MSG) << "SAMPLE_EXECUTION_TIME(s)=" << seconds;
+                LOG(MSG) << "ESTIMATED_EXECUTION_TIME(s)=" << "Cutoff";
+                return;
+            }
+        }
+        LOG(MSG) << "SAMPLE_EXECUTION_TIME(s)=" << seconds;
+        LOG(MSG) << "ESTIMATED_EXECUTION_TIME(s)=" << estimated_seconds;
+        LOG(MSG) << "ESTIMATED_RESULT=" << static_cast<long long>(std::llround(estimated_result));
+        LOG(MSG) << "MiniGraphAllocated=" << ToReadableSize(MiniGraphPool::TOTAL_ALLOCATED);
+    }
+
     std::ostream &operator<<(std::ostream &os, const VertexSetType &dt) {
         if (dt.vid() == Constant::EmptyID<IdType>()) {
             os << "VertexSet(-1)\t=\t[";
@@ -112,8 +286,11 @@ namespace minigraph {
 void plan_2hrs(minigraph::GraphType* graph, minigraph::Context& ctx) {
     std::mutex m;
     std::condition_variable cv;
-    std::thread t([&cv, &graph, &ctx](){
+    bool finished = false;
+    std::thread t([&cv, &m, &finished, &graph, &ctx](){
         minigraph::plan(graph, ctx);
+        std::lock_guard<std::mutex> l(m);
+        finished = true;
         cv.notify_one();
     });
     t.detach();
@@ -121,15 +298,19 @@ void plan_2hrs(minigraph::GraphType* graph, minigraph::Context& ctx) {
         std::unique_lock<std::mutex> l(m);
         // timeout after 1 day = 24 * 3600s = 86400s
         // timeout after 2 hours = 2 * 3600s = 7200s
-        if (cv.wait_for(l, 7200s) == std::cv_status::timeout) throw std::runtime_error("Timeout");
+        // the predicate covers plans that return before we start waiting
+        if (!cv.wait_for(l, 7200s, [&finished](){ return finished; })) throw std::runtime_error("Timeout");
     }
 };
 
 void plan_24hrs(minigraph::GraphType* graph, minigraph::Context& ctx) {
     std::mutex m;
     std::condition_variable cv;
-    std::thread t([&cv, &graph, &ctx](){
+    bool finished = false;
+    std::thread t([&cv, &m, &finished, &graph, &ctx](){
         minigraph::plan(graph, ctx);
+        std::lock_guard<std::mutex> l(m);
+        finished = true;
         cv.notify_one();
     });
     t.detach();
@@ -137,12 +318,23 @@ void plan_24hrs(minigraph::GraphType* graph, minigraph::Context& ctx) {
         std::unique_lock<std::mutex> l(m);
         // timeout after 1 day = 24 * 3600s = 86400s
         // timeout after 2 hours = 2 * 3600s = 7200s
-        if (cv.wait_for(l, 86400s) == std::cv_status::timeout) throw std::runtime_error("Timeout");
+        // the predicate covers plans that return before we start waiting
+        if (!cv.wait_for(l, 86400s, [&finished](){ return finished; })) throw std::runtime_error("Timeout");
     }
 };
 
 int main(int argc, char *argv[]){
     using namespace minigraph;
+    if (argc < 3) {
+        std::cout << "./runner [exp_id] [graph_dir] [output (optional)] [embedding_limit=0 (optional)]\n";
+        std::cout << "output: required by plans generated for enumeration (a binary file or |cmd to pipe into cmd)\n"
+                     "        and by plans generated for local counts (a binary file)\n";
+        std::cout << "MINIGRAPH_ROOT_SAMPLE=<file>: only run the sampled roots (see root_sample.h) and extrapolate the runtime\n";
+        std::cout << "MINIGRAPH_ANALYZE=<file>: required by plans generated for analyze, saves the statistics of every op\n";
+        std::cout << "MINIGRAPH_CORE=0: run counting plans on the whole graph instead of the k-core the pattern can match in,\n"
+                     "                  k being the minimum degree of the pattern (cached in graph_dir/core_<k>)\n";
+        return 0;
+    }
     int expId = std::stoi(argv[1]);
     std::string in_dir{argv[2]};
     Timer t;
@@ -157,13 +349,61 @@ int main(int argc, char *argv[]){
     omp_set_num_threads(num_threads); // Set the number of threads for OpenMP
     LOG(MSG) << "Threads=" << num_threads; // Log the correct number of threads
 
+    // MiniGraph builds that would exceed the budget leave lists unpruned instead of allocating
+    const char* budget_env = getenv("MINIGRAPH_MEMORY_BUDGET");
+    if (budget_env != NULL) {
+        MiniGraphPool::BUDGET = parse_bytes(budget_env);
+        LOG(MSG) << "MiniGraphBudget=" << ToReadableSize(MiniGraphPool::BUDGET);
+    }
+
 
-    GraphType *graph = load_bin(in_dir, false);
+    // plans only match inside the min_core()-core; enumeration writes the ids of the graph it runs on, so it runs
+    // on the whole graph
+    const char* core_env = getenv("MINIGRAPH_CORE");
+    bool use_core = min_core() >= 2 && !(argc > 3 && num_orbits() == 0)
+                    && (core_env == NULL || std::string(core_env) != "0");
+    std::vector<IdType> core_ids; // original id of every vertex of the core; empty if the plan runs on the whole graph
+    GraphType *graph = use_core ? load_core(in_dir, min_core(), core_ids) : load_bin(in_dir, false);
     LOG(MSG) << "LoadTime(s)=" << t.Passed();
+    if (!core_ids.empty()) {
+        LOG(MSG) << "Core=" << min_core() << " CoreVertices=" << graph->get_vnum() << " CoreEdges=" << graph->get_enum();
+    }
+
+    // autotune and profile-guided builds run plans on a sample of the roots instead of all vertices
+    const char* sample_env = getenv("MINIGRAPH_ROOT_SAMPLE");
+    if (sample_env != NULL) {
+        CHECK(argc <= 3) << "Root samples only time counting plans";
+        const char* cutoff_env = getenv("MINIGRAPH_SAMPLE_CUTOFF");
+        double cutoff = cutoff_env != NULL ? std::stod(cutoff_env) : std::numeric_limits<double>::infinity();
+        run_sample(graph, num_threads, read_root_sample(sample_env), cutoff, core_ids);
+        return 0;
+    }
     bool time_out = false;
     double seconds = 24 * 3600;
     Context ctx(num_threads);
 
+    std::unique_ptr<EmbeddingSink> sink;
+    std::unique_ptr<LocalCounter> local_counts;
+    if (argc > 3 && num_orbits() > 0) {
+        local_counts = std::make_unique<LocalCounter>(graph->get_vnum(), num_orbits(), num_threads);
+        ctx.local_counts = local_counts.get();
+        LOG(MSG) << "LocalCountOut=" << argv[3] << " Orbits=" << num_orbits();
+    } else if (argc > 3) {
+        uint64_t limit = (argc > 4) ? std::stoull(argv[4]) : 0;
+        // a closed pipe is detected by the sink instead of killing the process
+        signal(SIGPIPE, SIG_IGN);
+        sink = std::make_unique<EmbeddingSink>(pattern_size(), std::string{argv[3]}, num_threads, limit);
+        ctx.embeddings = sink.get();
+        LOG(MSG) << "EmbeddingOut=" << argv[3] << " EmbeddingLimit=" << limit;
+    }
+    std::unique_ptr<PlanAnalyzer> analyzer;
+    const char* analyze_env = getenv("MINIGRAPH_ANALYZE");
+    if (analyze_env != NULL) {
+        analyzer = std::make_unique<PlanAnalyzer>(num_threads);
+        ctx.analyzer = analyzer.get();
+        LOG(MSG) << "AnalyzeOut=" << analyze_env;
+    }
+
     RunnerLog log;
     long long result{0};
 
@@ -192,6 +432,10 @@ int main(int argc, char *argv[]){
     }
 
     if (time_out) {
+        // the plan is still running and may keep writing to the sink
+        sink.release();
+        local_counts.release();
+        analyzer.release();
         result = ctx.get_result();
         seconds = t.Passed();
 
@@ -213,6 +457,7 @@ int main(int argc, char *argv[]){
         LOG(MSG) << "Throughput=" << result / seconds;
         LOG(MSG) << "VertexSetAllocated=" << ToReadableSize(VertexSetType::TOTAL_ALLOCATED);
         LOG(MSG) << "MiniGraphAllocated=" << ToReadableSize(MiniGraphPool::TOTAL_ALLOCATED);
+        LOG(MSG) << "MiniGraphDegradedBuilds=" << MiniGraphPool::DEGRADED_BUILDS;
     } else {
         result = ctx.get_result();
         seconds = t.Passed();
@@ -232,13 +477,36 @@ int main(int argc, char *argv[]){
 
         LOG(MSG) << "CODE_EXECUTION_TIME(s)=" << seconds;
         LOG(MSG) << "RESULT=" << ctx.get_result();
+        std::vector<long long> pattern_results = ctx.get_pattern_results();
+        for (size_t k = 0; k < pattern_results.size(); k++) {
+            LOG(MSG) << "RESULT_" << k << "=" << pattern_results.at(k);
+        }
         LOG(MSG) << "Throughput=" << ctx.get_result() / seconds;
+        if (sink) {
+            sink->close();
+            LOG(MSG) << "EMBEDDINGS=" << sink->written();
+        }
+        if (local_counts) {
+            if (core_ids.empty()) {
+                local_counts->save(argv[3]);
+            } else {
+                MetaData meta;
+                meta.read(in_dir);
+                local_counts->save(argv[3], &core_ids, meta.num_vertex);
+            }
+            LOG(MSG) << "LOCAL_COUNTS=" << argv[3];
+        }
+        if (analyzer) {
+            analyzer->save(analyze_env);
+            LOG(MSG) << "ANALYZE_OUT=" << analyze_env;
+        }
         // LOG(MSG) << "ThreadMeanTime=" << ctx.get_mean_time() << "s";
         // LOG(MSG) << "ThreadMinTime=" << ctx.get_min_time() << "s";
         // LOG(MSG) << "ThreadMaxTime=" << ctx.get_max_time() << "s";
         // LOG(MSG) << "TimeSTD=" << sqrt(ctx.get_var_time());
         LOG(MSG) << "VertexSetAllocated=" << ToReadableSize(VertexSetType::TOTAL_ALLOCATED);
         LOG(MSG) << "MiniGraphAllocated=" << ToReadableSize(MiniGraphPool::TOTAL_ALLOCATED);
+        LOG(MSG) << "MiniGraphDegradedBuilds=" << MiniGraphPool::DEGRADED_BUILDS;
     }
     log.save(PROJECT_LOG_DIR);
 }
\ No newline at end of file